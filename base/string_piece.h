@@ -0,0 +1,145 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//    * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//    * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef BASE_STRING_PIECE_H_
+#define BASE_STRING_PIECE_H_
+
+// A StringPiece points to part or all of a string that is owned by somebody
+// else. It never copies or allocates, so it is cheap to pass around by value,
+// but the caller must make sure the underlying characters outlive it.
+//
+// This is a stripped-down version of the class of the same name used in
+// Chrome, with only what the URL library needs.
+
+#include <string.h>
+
+#include <algorithm>
+#include <ostream>
+#include <string>
+
+namespace base {
+
+class StringPiece {
+ public:
+  typedef size_t size_type;
+  typedef const char* const_iterator;
+
+  StringPiece() : ptr_(NULL), length_(0) {}
+  StringPiece(const char* str)  // NOLINT: implicit by design.
+      : ptr_(str), length_(str ? strlen(str) : 0) {}
+  StringPiece(const std::string& str)  // NOLINT: implicit by design.
+      : ptr_(str.data()), length_(str.size()) {}
+  StringPiece(const char* str, size_type len) : ptr_(str), length_(len) {}
+
+  // data() may return a pointer to a buffer with embedded NULs, and the
+  // returned buffer may or may not be NULL terminated.
+  const char* data() const { return ptr_; }
+  size_type size() const { return length_; }
+  size_type length() const { return length_; }
+  bool empty() const { return length_ == 0; }
+
+  void clear() {
+    ptr_ = NULL;
+    length_ = 0;
+  }
+  void set(const char* data, size_type len) {
+    ptr_ = data;
+    length_ = len;
+  }
+
+  char operator[](size_type i) const { return ptr_[i]; }
+
+  const_iterator begin() const { return ptr_; }
+  const_iterator end() const { return ptr_ + length_; }
+
+  void remove_prefix(size_type n) {
+    ptr_ += n;
+    length_ -= n;
+  }
+  void remove_suffix(size_type n) {
+    length_ -= n;
+  }
+
+  int compare(const StringPiece& x) const {
+    int r = length_ == 0 && x.length_ == 0 ? 0 :
+        memcmp(ptr_, x.ptr_, std::min(length_, x.length_));
+    if (r == 0) {
+      if (length_ < x.length_) r = -1;
+      else if (length_ > x.length_) r = +1;
+    }
+    return r;
+  }
+
+  bool starts_with(const StringPiece& x) const {
+    return length_ >= x.length_ &&
+        (x.length_ == 0 || memcmp(ptr_, x.ptr_, x.length_) == 0);
+  }
+  bool ends_with(const StringPiece& x) const {
+    return length_ >= x.length_ &&
+        (x.length_ == 0 ||
+         memcmp(ptr_ + (length_ - x.length_), x.ptr_, x.length_) == 0);
+  }
+
+  std::string as_string() const {
+    // std::string doesn't like to take a NULL pointer even with a 0 size.
+    return empty() ? std::string() : std::string(ptr_, length_);
+  }
+  void CopyToString(std::string* target) const {
+    if (empty())
+      target->clear();
+    else
+      target->assign(ptr_, length_);
+  }
+
+ private:
+  const char* ptr_;
+  size_type length_;
+};
+
+inline bool operator==(const StringPiece& x, const StringPiece& y) {
+  if (x.size() != y.size())
+    return false;
+  return x.size() == 0 || memcmp(x.data(), y.data(), x.size()) == 0;
+}
+inline bool operator!=(const StringPiece& x, const StringPiece& y) {
+  return !(x == y);
+}
+inline bool operator<(const StringPiece& x, const StringPiece& y) {
+  return x.compare(y) < 0;
+}
+
+// Allows StringPiece to be logged and used in assertion statements.
+inline std::ostream& operator<<(std::ostream& o, const StringPiece& piece) {
+  o.write(piece.data(), static_cast<std::streamsize>(piece.size()));
+  return o;
+}
+
+}  // namespace base
+
+#endif  // BASE_STRING_PIECE_H_
@@ -4,6 +4,9 @@
 
 LIBRECOSET_GOOGLE_URL_SOURCES := \
 	src/gurl.cc \
+	src/gurl_view.cc \
+	src/lazy_gurl.cc \
+	src/url_c_api.cc \
 	src/url_canon_etc.cc \
 	src/url_parse_file.cc \
 	src/url_canon_mailtourl.cc \
@@ -11,15 +14,29 @@ LIBRECOSET_GOOGLE_URL_SOURCES := \
 	src/url_canon_fileurl.cc \
 	src/url_canon_pathurl.cc \
 	src/url_parse.cc \
+	src/url_query_index.cc \
+	src/url_domain_set.cc \
+	src/url_path_router.cc \
+	src/url_public_suffix.cc \
+	src/url_table.cc \
+	src/url_stream.cc \
+	src/url_rewrite.cc \
+	src/url_parallel.cc \
 	src/url_canon_host.cc \
 	src/url_canon_relative.cc \
 	src/url_canon_ip.cc \
 	src/url_util.cc \
 	src/url_canon_filesystemurl.cc \
 	src/url_canon_internal.cc \
+	src/url_canon_sampler.cc \
+	src/url_canon_simd.cc \
+	src/url_canon_arena.cc \
+	src/url_canon_stats.cc \
 	src/url_canon_stdurl.cc \
+	src/url_canon_unicode.cc \
 	src/url_canon_path.cc \
-	src/url_canon_query.cc
+	src/url_canon_query.cc \
+	src/url_canon_query_filter.cc
 
 
 #	src/gurl_test_main.cc \
@@ -28,8 +45,33 @@ LIBRECOSET_GOOGLE_URL_SOURCES := \
 #	src/url_parse_unittest.cc \
 #	src/url_canon_unittest.cc \
 
-$(eval $(call set_compile_option,$(LIBRECOSET_GOOGLE_URL_SOURCES),-Duint64=uint64_t -Wno-array-bounds))
+LIBRECOSET_GOOGLE_URL_FLAGS := -Duint64=uint64_t -Wno-array-bounds
+LIBRECOSET_GOOGLE_URL_LINK := icui18n icuuc icudata m pthread
 
-LIBRECOSET_GOOGLE_URL_LINK := icui18n icuuc icudata m
+# Set GOOGLEURL_NO_ICU=1 to build and link without ICU. IDN hosts then go
+# through the built-in Punycode backend, see url_canon_unicode.h, and the ICU
+# converters of url_canon_icu.h are not available.
+ifeq ($(GOOGLEURL_NO_ICU),1)
+LIBRECOSET_GOOGLE_URL_SOURCES := $(filter-out src/url_canon_icu.cc,$(LIBRECOSET_GOOGLE_URL_SOURCES))
+LIBRECOSET_GOOGLE_URL_FLAGS += -DGURL_NO_ICU
+LIBRECOSET_GOOGLE_URL_LINK := m pthread
+endif
+
+$(eval $(call set_compile_option,$(LIBRECOSET_GOOGLE_URL_SOURCES),$(LIBRECOSET_GOOGLE_URL_FLAGS)))
 
 $(eval $(call library,googleurl,$(LIBRECOSET_GOOGLE_URL_SOURCES),$(LIBRECOSET_GOOGLE_URL_LINK)))
+
+# Microbenchmarks for the parse and canonicalize hot paths. Not built by
+# default; run with "make googleurl_perftest" and then the binary, optionally
+# passing a name filter and a minimum time per benchmark in milliseconds.
+LIBRECOSET_GOOGLE_URL_PERFTEST_SOURCES := src/url_perftest.cc
+LIBRECOSET_GOOGLE_URL_PERFTEST_FLAGS := -Duint64=uint64_t
+
+# Without ICU the benchmark of the ICU converter is left out.
+ifeq ($(GOOGLEURL_NO_ICU),1)
+LIBRECOSET_GOOGLE_URL_PERFTEST_FLAGS += -DGURL_NO_ICU
+endif
+
+$(eval $(call set_compile_option,$(LIBRECOSET_GOOGLE_URL_PERFTEST_SOURCES),$(LIBRECOSET_GOOGLE_URL_PERFTEST_FLAGS)))
+
+$(eval $(call program,googleurl_perftest,googleurl,$(LIBRECOSET_GOOGLE_URL_PERFTEST_SOURCES)))
@@ -35,11 +35,14 @@
 
 #include <algorithm>
 #include <ostream>
+#include <utility>
 
 #include "googleurl/src/gurl.h"
 
 #include "googleurl/base/logging.h"
 #include "googleurl/src/url_canon_stdstring.h"
+#include "googleurl/src/url_domain_set.h"
+#include "googleurl/src/url_public_suffix.h"
 #include "googleurl/src/url_util.h"
 
 namespace {
@@ -63,6 +66,19 @@ bool InitCanonical(const STR& input_spec,
   return success;
 }
 
+// 8-bit input is often canonical already (for example when it was stored from
+// another GURL), in which case it can be copied as is.
+bool InitCanonical(const std::string& input_spec,
+                   std::string* canonical,
+                   url_parse::Parsed* parsed) {
+  if (url_util::IsCanonical(input_spec.data(),
+                            static_cast<int>(input_spec.length()), parsed)) {
+    *canonical = input_spec;
+    return true;
+  }
+  return InitCanonical<std::string>(input_spec, canonical, parsed);
+}
+
 static std::string* empty_string = NULL;
 static GURL* empty_gurl = NULL;
 
@@ -105,20 +121,46 @@ const std::string& EmptyStringForGURL() {
 
 } // namespace
 
-GURL::GURL() : is_valid_(false), inner_url_(NULL) {
+GURL::GURL()
+    : is_valid_(false),
+      scheme_id_(url_util::SCHEME_UNKNOWN),
+      spec_hash_(url_util::HashSpec("", 0)),
+      inner_url_(NULL) {
 }
 
 GURL::GURL(const GURL& other)
     : spec_(other.spec_),
       is_valid_(other.is_valid_),
       parsed_(other.parsed_),
+      scheme_id_(other.scheme_id_),
+      spec_hash_(other.spec_hash_),
       inner_url_(NULL) {
   if (other.inner_url_)
     inner_url_ = new GURL(*other.inner_url_);
 }
 
+GURL::GURL(GURL&& other) noexcept
+    : spec_(std::move(other.spec_)),
+      is_valid_(other.is_valid_),
+      parsed_(std::move(other.parsed_)),
+      scheme_id_(other.scheme_id_),
+      spec_hash_(other.spec_hash_),
+      inner_url_(other.inner_url_) {
+  other.spec_.clear();
+  other.is_valid_ = false;
+  other.parsed_ = url_parse::Parsed();
+  other.scheme_id_ = url_util::SCHEME_UNKNOWN;
+  other.spec_hash_ = url_util::HashSpec("", 0);
+  other.inner_url_ = NULL;
+}
+
+GURL::~GURL() {
+  delete inner_url_;
+}
+
 GURL::GURL(const std::string& url_string) : inner_url_(NULL) {
   is_valid_ = InitCanonical(url_string, &spec_, &parsed_);
+  InitCachedFields();
 #ifdef FULL_FILESYSTEM_URL_SUPPORT
   if (is_valid_ && SchemeIsFileSystem()) {
     inner_url_ =
@@ -129,6 +171,7 @@ GURL::GURL(const std::string& url_string) : inner_url_(NULL) {
 
 GURL::GURL(const string16& url_string) : inner_url_(NULL) {
   is_valid_ = InitCanonical(url_string, &spec_, &parsed_);
+  InitCachedFields();
 #ifdef FULL_FILESYSTEM_URL_SUPPORT
   if (is_valid_ && SchemeIsFileSystem()) {
     inner_url_ =
@@ -143,6 +186,7 @@ GURL::GURL(const char* canonical_spec, size_t canonical_spec_len,
       is_valid_(is_valid),
       parsed_(parsed),
       inner_url_(NULL) {
+  InitCachedFields();
 #ifdef FULL_FILESYSTEM_URL_SUPPORT
   if (is_valid_ && SchemeIsFileSystem()) {
     inner_url_ =
@@ -180,10 +224,17 @@ GURL::GURL(const char* canonical_spec, size_t canonical_spec_len,
 #endif
 }
 
+GURL::GURL(const char* canonical_spec, size_t canonical_spec_len,
+           const url_parse::CompactParsed& parsed, bool is_valid)
+    : GURL(canonical_spec, canonical_spec_len, parsed.ToParsed(), is_valid) {
+}
+
 GURL& GURL::operator=(const GURL& other) {
   spec_ = other.spec_;
   is_valid_ = other.is_valid_;
   parsed_ = other.parsed_;
+  scheme_id_ = other.scheme_id_;
+  spec_hash_ = other.spec_hash_;
   delete inner_url_;
   inner_url_ = NULL;
   if (other.inner_url_)
@@ -191,6 +242,26 @@ GURL& GURL::operator=(const GURL& other) {
   return *this;
 }
 
+GURL& GURL::operator=(GURL&& other) noexcept {
+  if (this != &other) {
+    spec_ = std::move(other.spec_);
+    is_valid_ = other.is_valid_;
+    parsed_ = std::move(other.parsed_);
+    scheme_id_ = other.scheme_id_;
+    spec_hash_ = other.spec_hash_;
+    delete inner_url_;
+    inner_url_ = other.inner_url_;
+
+    other.spec_.clear();
+    other.is_valid_ = false;
+    other.parsed_ = url_parse::Parsed();
+    other.scheme_id_ = url_util::SCHEME_UNKNOWN;
+    other.spec_hash_ = url_util::HashSpec("", 0);
+    other.inner_url_ = NULL;
+  }
+  return *this;
+}
+
 const std::string& GURL::spec() const {
   if (is_valid_ || spec_.empty())
     return spec_;
@@ -231,6 +302,7 @@ GURL GURL::ResolveWithCharsetConverter(
 
   output.Complete();
   result.is_valid_ = true;
+  result.InitCachedFields();
   return result;
 }
 
@@ -259,6 +331,45 @@ GURL GURL::ResolveWithCharsetConverter(
 
   output.Complete();
   result.is_valid_ = true;
+  result.InitCachedFields();
+  return result;
+}
+
+// Note: code duplicated below (it's inconvenient to use a template here).
+GURL GURL::ResolveWithBase(const url_util::ResolvedBase& base,
+                           const std::string& relative) {
+  GURL result;
+  result.spec_.reserve(base.base_spec_len() + relative.size() + 32);
+  url_canon::StdStringCanonOutput output(&result.spec_);
+
+  if (!base.Resolve(relative.data(), static_cast<int>(relative.length()),
+                    NULL, &output, &result.parsed_)) {
+    // Error resolving, return an empty URL.
+    return GURL();
+  }
+
+  output.Complete();
+  result.is_valid_ = true;
+  result.InitCachedFields();
+  return result;
+}
+
+// Note: code duplicated above (it's inconvenient to use a template here).
+GURL GURL::ResolveWithBase(const url_util::ResolvedBase& base,
+                           const string16& relative) {
+  GURL result;
+  result.spec_.reserve(base.base_spec_len() + relative.size() + 32);
+  url_canon::StdStringCanonOutput output(&result.spec_);
+
+  if (!base.Resolve(relative.data(), static_cast<int>(relative.length()),
+                    NULL, &output, &result.parsed_)) {
+    // Error resolving, return an empty URL.
+    return GURL();
+  }
+
+  output.Complete();
+  result.is_valid_ = true;
+  result.InitCachedFields();
   return result;
 }
 
@@ -281,6 +392,7 @@ GURL GURL::ReplaceComponents(
       NULL, &output, &result.parsed_);
 
   output.Complete();
+  result.InitCachedFields();
   return result;
 }
 
@@ -303,6 +415,7 @@ GURL GURL::ReplaceComponents(
       NULL, &output, &result.parsed_);
 
   output.Complete();
+  result.InitCachedFields();
   return result;
 }
 
@@ -327,6 +440,71 @@ GURL GURL::GetOrigin() const {
   return ReplaceComponents(replacements);
 }
 
+url_util::OriginKey GURL::origin_key() const {
+  // This must agree with GetOrigin, which returns the empty URL for these.
+  if (!is_valid_ || !IsStandard())
+    return url_util::OriginKey();
+
+#ifdef FULL_FILESYSTEM_URL_SUPPORT
+  if (SchemeIsFileSystem())
+    return inner_url_->origin_key();
+#endif
+
+  return url_util::OriginKey(scheme_id_, host_hash(), EffectiveIntPort());
+}
+
+bool GURL::GetOriginPiece(base::StringPiece* origin) const {
+  if (!is_valid_ || !IsStandard()) {
+    *origin = base::StringPiece();
+    return true;
+  }
+
+#ifdef FULL_FILESYSTEM_URL_SUPPORT
+  if (SchemeIsFileSystem())
+    return inner_url_->GetOriginPiece(origin);
+#endif
+
+  if (parsed_.username.is_valid() || parsed_.password.is_valid())
+    return false;
+  // The scheme begins after "filesystem:" when this is the inner URL of a
+  // filesystem URL, which shares the outer spec.
+  int begin = parsed_.scheme.begin;
+  int end = parsed_.CountCharactersBefore(url_parse::Parsed::PATH, false);
+  *origin = base::StringPiece(spec_.data() + begin, end - begin);
+  return true;
+}
+
+uint64_t GURL::host_hash() const {
+  if (parsed_.host.len <= 0)
+    return url_util::HashSpec("", 0);
+  return url_util::HashSpec(&spec_[parsed_.host.begin], parsed_.host.len);
+}
+
+uint64_t GURL::origin_hash() const {
+  // This must agree with GetOrigin, which returns the empty URL for these.
+  if (!is_valid_ || !IsStandard())
+    return url_util::HashSpec("", 0);
+
+#ifdef FULL_FILESYSTEM_URL_SUPPORT
+  if (SchemeIsFileSystem())
+    return inner_url_->origin_hash();
+#endif
+
+  // The origin of a canonical standard URL is its scheme, host and port
+  // followed by an empty path, which canonicalizes to "/".
+  url_canon::RawCanonOutputT<char, 256> origin;
+  origin.Append(spec_.data(), parsed_.scheme.end());
+  origin.Append("://", 3);
+  if (parsed_.host.len > 0)
+    origin.Append(&spec_[parsed_.host.begin], parsed_.host.len);
+  if (parsed_.port.is_valid()) {
+    origin.push_back(':');
+    origin.Append(&spec_[parsed_.port.begin], parsed_.port.len);
+  }
+  origin.push_back('/');
+  return url_util::HashSpec(origin.data(), origin.length());
+}
+
 GURL GURL::GetWithEmptyPath() const {
   // This doesn't make sense for invalid or nonstandard URLs, so return
   // the empty URL.
@@ -352,7 +530,7 @@ GURL GURL::GetWithEmptyPath() const {
 }
 
 bool GURL::IsStandard() const {
-  return url_util::IsStandard(spec_.data(), parsed_.scheme);
+  return url_util::IsStandardSchemeID(scheme_id_);
 }
 
 bool GURL::SchemeIs(const char* lower_ascii_scheme) const {
@@ -384,26 +562,35 @@ std::string GURL::ExtractFileName() const {
 }
 
 std::string GURL::PathForRequest() const {
+  return PathForRequestPiece().as_string();
+}
+
+base::StringPiece GURL::PathForRequestPiece() const {
   DCHECK(parsed_.path.len > 0) << "Canonical path for requests should be non-empty";
   if (parsed_.ref.len >= 0) {
     // Clip off the reference when it exists. The reference starts after the #
     // sign, so we have to subtract one to also remove it.
-    return std::string(spec_, parsed_.path.begin,
-                       parsed_.ref.begin - parsed_.path.begin - 1);
+    return base::StringPiece(spec_.data() + parsed_.path.begin,
+                             parsed_.ref.begin - parsed_.path.begin - 1);
   }
 
   // Use everything form the path to the end.
-  return std::string(spec_, parsed_.path.begin);
+  return base::StringPiece(spec_.data() + parsed_.path.begin,
+                           spec_.size() - parsed_.path.begin);
 }
 
 std::string GURL::HostNoBrackets() const {
+  return HostNoBracketsPiece().as_string();
+}
+
+base::StringPiece GURL::HostNoBracketsPiece() const {
   // If host looks like an IPv6 literal, strip the square brackets.
   url_parse::Component h(parsed_.host);
   if (h.len >= 2 && spec_[h.begin] == '[' && spec_[h.end() - 1] == ']') {
     h.begin++;
     h.len -= 2;
   }
-  return ComponentString(h);
+  return ComponentStringPiece(h);
 }
 
 bool GURL::HostIsIPAddress() const {
@@ -462,44 +649,58 @@ bool GURL::DomainIs(const char* lower_ascii_domain,
   if (!parsed_.host.is_nonempty())
     return false;
 
-  // Check whether the host name is end with a dot. If yes, treat it
-  // the same as no-dot unless the input comparison domain is end
-  // with dot.
-  const char* last_pos = spec_.data() + parsed_.host.end() - 1;
-  int host_len = parsed_.host.len;
-  if ('.' == *last_pos && '.' != lower_ascii_domain[domain_len - 1]) {
-    last_pos--;
-    host_len--;
-  }
+  return url_util::DomainIs(spec_.data() + parsed_.host.begin,
+                            parsed_.host.len,
+                            lower_ascii_domain, domain_len);
+}
 
-  // Return false if host's length is less than domain's length.
-  if (host_len < domain_len)
-    return false;
+base::StringPiece GURL::RegistrableDomainPiece() const {
+  if (!is_valid_)
+    return base::StringPiece();
 
-  // Compare this url whether belong specific domain.
-  const char* start_pos = spec_.data() + parsed_.host.begin +
-                          host_len - domain_len;
+  // FileSystem URLs have empty parsed_.host, so check this first.
+  if (SchemeIsFileSystem() && inner_url_)
+    return inner_url_->RegistrableDomainPiece();
 
-  if (!url_util::LowerCaseEqualsASCII(start_pos,
-                                      last_pos + 1,
-                                      lower_ascii_domain,
-                                      lower_ascii_domain + domain_len))
-    return false;
+  return ComponentStringPiece(
+      url_util::GetRegistrableDomain(spec_.data(), parsed_.host));
+}
+
+base::StringPiece GURL::PublicSuffixPiece() const {
+  if (!is_valid_)
+    return base::StringPiece();
 
-  // Check whether host has right domain start with dot, make sure we got
-  // right domain range. For example www.google.com has domain
-  // "google.com" but www.iamnotgoogle.com does not.
-  if ('.' != lower_ascii_domain[0] && host_len > domain_len &&
-      '.' != *(start_pos - 1))
+  // FileSystem URLs have empty parsed_.host, so check this first.
+  if (SchemeIsFileSystem() && inner_url_)
+    return inner_url_->PublicSuffixPiece();
+
+  return ComponentStringPiece(
+      url_util::GetPublicSuffix(spec_.data(), parsed_.host));
+}
+
+bool GURL::DomainIsAny(const url_util::DomainSet& domains) const {
+  if (!is_valid_)
     return false;
 
-  return true;
+  // FileSystem URLs have empty parsed_.host, so check this first.
+  if (SchemeIsFileSystem() && inner_url_)
+    return inner_url_->DomainIsAny(domains);
+
+  return domains.Matches(spec_.data(), parsed_.host);
+}
+
+void GURL::InitCachedFields() {
+  scheme_id_ = url_util::FindSchemeID(spec_.data(), parsed_.scheme);
+  spec_hash_ = url_util::HashSpec(spec_.data(),
+                                  static_cast<int>(spec_.length()));
 }
 
 void GURL::Swap(GURL* other) {
   spec_.swap(other->spec_);
   std::swap(is_valid_, other->is_valid_);
   std::swap(parsed_, other->parsed_);
+  std::swap(scheme_id_, other->scheme_id_);
+  std::swap(spec_hash_, other->spec_hash_);
   std::swap(inner_url_, other->inner_url_);
 }
 
@@ -30,14 +30,23 @@
 #ifndef GOOGLEURL_SRC_GURL_H__
 #define GOOGLEURL_SRC_GURL_H__
 
+#include <stdint.h>
+
+#include <functional>
 #include <iosfwd>
 #include <string>
 
 #include "googleurl/base/string16.h"
+#include "googleurl/base/string_piece.h"
 #include "googleurl/src/url_canon.h"
 #include "googleurl/src/url_canon_stdstring.h"
 #include "googleurl/src/url_common.h"
 #include "googleurl/src/url_parse.h"
+#include "googleurl/src/url_util.h"
+
+namespace url_util {
+class DomainSet;
+}
 
 class GURL {
  public:
@@ -51,6 +60,12 @@ class GURL {
   // to reallocating the string. It does not re-parse.
   GURL_API GURL(const GURL& other);
 
+  // Moving transfers the spec buffer and the inner URL without copying them.
+  // The moved-from URL is left empty and invalid.
+  GURL_API GURL(GURL&& other) noexcept;
+
+  GURL_API ~GURL();
+
   // The narrow version requires the input be UTF-8. Invalid UTF-8 input will
   // result in an invalid URL.
   //
@@ -68,8 +83,12 @@ class GURL {
   // information associated with the URL, which must be correct and consistent.
   GURL_API GURL(const char* canonical_spec, size_t canonical_spec_len,
                 const url_parse::Parsed& parsed, bool is_valid);
+  // Same as above, with the components unpacked from a CompactParsed.
+  GURL_API GURL(const char* canonical_spec, size_t canonical_spec_len,
+                const url_parse::CompactParsed& parsed, bool is_valid);
 
   GURL_API GURL& operator=(const GURL& other);
+  GURL_API GURL& operator=(GURL&& other) noexcept;
 
   // Returns true when this object represents a valid parsed URL. When not
   // valid, other functions will still succeed, but you will not get canonical
@@ -125,14 +144,51 @@ class GURL {
     return parsed_;
   }
 
-  // Defiant equality operator!
+  // Packs the parsed components for compact storage alongside the spec, from
+  // which the above constructor can later rebuild this URL without parsing.
+  // Returns false if they can't be packed (see url_parse::CompactParsed).
+  bool GetCompactParsed(url_parse::CompactParsed* compact) const {
+    return compact->Pack(parsed_);
+  }
+
+  // Defiant equality operator! Comparing the cached hashes first rejects
+  // most unequal URLs without looking at the specs.
   bool operator==(const GURL& other) const {
-    return spec_ == other.spec_;
+    return spec_hash_ == other.spec_hash_ && spec_ == other.spec_;
   }
   bool operator!=(const GURL& other) const {
-    return spec_ != other.spec_;
+    return !(*this == other);
+  }
+
+  // Returns a hash of possibly_invalid_spec(), computed once when the URL is
+  // built. This is url_util::HashSpec of the spec, so it is stable across
+  // processes and can be stored. std::hash<GURL> uses it.
+  uint64_t hash() const {
+    return spec_hash_;
   }
 
+  // Returns url_util::HashSpec of host(), for grouping URLs by host.
+  GURL_API uint64_t host_hash() const;
+
+  // Returns the same value as GetOrigin().hash(), without building the origin
+  // URL. URLs with the same origin have the same origin hash.
+  GURL_API uint64_t origin_hash() const;
+
+  // Returns the key of this URL's origin, which is equal for two URLs exactly
+  // when their GetOrigin() is (barring a host hash collision). Nothing is
+  // copied or canonicalized, so this is the cheap way to check whether two
+  // URLs are same-origin.
+  GURL_API url_util::OriginKey origin_key() const;
+
+  // Sets |*origin| to the "scheme://host:port" part of the spec, which is
+  // GetOrigin().spec() without its trailing slash, and returns true. The
+  // piece points into this URL's spec (or, for filesystem URLs, into the
+  // inner URL's) and is empty for URLs that have no origin. Returns false,
+  // leaving |*origin| unchanged, when the URL has a username or password:
+  // they sit between the scheme and the host, so the origin is not a
+  // contiguous part of the spec and GetOrigin() must be used instead.
+  GURL_API bool GetOriginPiece(base::StringPiece* origin) const;
+
   // Allows GURL to used as a key in STL (for example, a std::set or std::map).
   bool operator<(const GURL& other) const {
     return spec_ < other.spec_;
@@ -170,6 +226,20 @@ class GURL {
       const string16& relative,
       url_canon::CharsetConverter* charset_converter) const;
 
+  // Like Resolve() on the URL that |base| was initialized from, whose spec
+  // and parsed components it refers to, but without redoing the work
+  // ResolvedBase saves for every call. To resolve all the links of a page:
+  //
+  //   url_util::ResolvedBase base(page.spec().data(), page.spec().length(),
+  //                               page.parsed_for_possibly_invalid_spec());
+  //   GURL link = GURL::ResolveWithBase(base, href);
+  //
+  // The page URL must be valid.
+  GURL_API static GURL ResolveWithBase(const url_util::ResolvedBase& base,
+                                       const std::string& relative);
+  GURL_API static GURL ResolveWithBase(const url_util::ResolvedBase& base,
+                                       const string16& relative);
+
   // Creates a new GURL by replacing the current URL's components with the
   // supplied versions. See the Replacements class in url_canon.h for more.
   //
@@ -220,20 +290,32 @@ class GURL {
   // object constructions are done.
   GURL_API bool SchemeIs(const char* lower_ascii_scheme) const;
 
+  // Like the above but compares against an interned scheme ID, which is a
+  // single integer comparison. The ID is looked up once when the URL is built.
+  bool SchemeIs(url_util::SchemeID scheme_id) const {
+    return scheme_id_ == scheme_id && scheme_id != url_util::SCHEME_UNKNOWN;
+  }
+
+  // Returns the interned ID of this URL's scheme, or SCHEME_UNKNOWN if the
+  // scheme is not registered.
+  url_util::SchemeID scheme_id() const {
+    return scheme_id_;
+  }
+
   // We often need to know if this is a file URL. File URLs are "standard", but
   // are often treated separately by some programs.
   bool SchemeIsFile() const {
-    return SchemeIs("file");
+    return scheme_id_ == url_util::SCHEME_FILE;
   }
 
   // FileSystem URLs need to be treated differently in some cases.
   bool SchemeIsFileSystem() const {
-    return SchemeIs("filesystem");
+    return scheme_id_ == url_util::SCHEME_FILESYSTEM;
   }
 
   // If the scheme indicates a secure connection
   bool SchemeIsSecure() const {
-    return SchemeIs("https") ||
+    return scheme_id_ == url_util::SCHEME_HTTPS ||
         (SchemeIsFileSystem() && inner_url() && inner_url()->SchemeIsSecure());
   }
 
@@ -272,6 +354,34 @@ class GURL {
     return ComponentString(parsed_.ref);
   }
 
+  // Non-allocating versions of the getters above. The returned StringPiece
+  // points into this object's spec, so it is only valid as long as this GURL
+  // is not destroyed or modified.
+  base::StringPiece scheme_piece() const {
+    return ComponentStringPiece(parsed_.scheme);
+  }
+  base::StringPiece username_piece() const {
+    return ComponentStringPiece(parsed_.username);
+  }
+  base::StringPiece password_piece() const {
+    return ComponentStringPiece(parsed_.password);
+  }
+  base::StringPiece host_piece() const {
+    return ComponentStringPiece(parsed_.host);
+  }
+  base::StringPiece port_piece() const {
+    return ComponentStringPiece(parsed_.port);
+  }
+  base::StringPiece path_piece() const {
+    return ComponentStringPiece(parsed_.path);
+  }
+  base::StringPiece query_piece() const {
+    return ComponentStringPiece(parsed_.query);
+  }
+  base::StringPiece ref_piece() const {
+    return ComponentStringPiece(parsed_.ref);
+  }
+
   // Existance querying. These functions will return true if the corresponding
   // URL component exists in this URL. Note that existance is different than
   // being nonempty. http://www.google.com/? has a query that just happens to
@@ -321,10 +431,24 @@ class GURL {
   // parameter, and query portions of the URL. It is guaranteed to be ASCII.
   GURL_API std::string PathForRequest() const;
 
+  // Non-allocating version of PathForRequest(), see the *_piece() getters.
+  GURL_API base::StringPiece PathForRequestPiece() const;
+
   // Returns the host, excluding the square brackets surrounding IPv6 address
   // literals.  This can be useful for passing to getaddrinfo().
   GURL_API std::string HostNoBrackets() const;
 
+  // Non-allocating version of HostNoBrackets(), see the *_piece() getters.
+  GURL_API base::StringPiece HostNoBracketsPiece() const;
+
+  // Returns the registrable domain (the "eTLD+1", such as "example.co.uk")
+  // and the public suffix (such as "co.uk") of the host, as found by the
+  // functions in url_public_suffix.h. These are empty when the URL is invalid
+  // or the host has none, for example when it is an IP address. See the
+  // *_piece() getters for the lifetime of the result.
+  GURL_API base::StringPiece RegistrableDomainPiece() const;
+  GURL_API base::StringPiece PublicSuffixPiece() const;
+
   // Returns true if this URL's host matches or is in the same domain as
   // the given input string. For example if this URL was "www.google.com",
   // this would match "com", "google.com", and "www.google.com
@@ -344,6 +468,11 @@ class GURL {
                     static_cast<int>(strlen(lower_ascii_domain)));
   }
 
+  // Returns true if the host is equal to or a subdomain of any domain in the
+  // given set, like calling DomainIs for each of them but in time that only
+  // depends on the length of the host.
+  GURL_API bool DomainIsAny(const url_util::DomainSet& domains) const;
+
   // Swaps the contents of this GURL object with the argument without doing
   // any memory allocations.
   GURL_API void Swap(GURL* other);
@@ -367,6 +496,19 @@ class GURL {
     return std::string(spec_, comp.begin, comp.len);
   }
 
+  // Looks up scheme_id_ from the scheme of the current spec and computes
+  // spec_hash_. This must be called whenever spec_ and parsed_ are filled in
+  // from scratch.
+  void InitCachedFields();
+
+  // Like ComponentString, but without copying.
+  base::StringPiece ComponentStringPiece(
+      const url_parse::Component& comp) const {
+    if (comp.len <= 0)
+      return base::StringPiece();
+    return base::StringPiece(spec_.data() + comp.begin, comp.len);
+  }
+
   // The actual text of the URL, in canonical ASCII form.
   std::string spec_;
 
@@ -378,6 +520,14 @@ class GURL {
   // Identified components of the canonical spec.
   url_parse::Parsed parsed_;
 
+  // Interned ID of the scheme in parsed_, so that scheme checks don't need to
+  // compare strings. Schemes registered after this URL was built are not
+  // picked up.
+  url_util::SchemeID scheme_id_;
+
+  // url_util::HashSpec of spec_.
+  uint64_t spec_hash_;
+
   // Used for nested schemes [currently only filesystem:].
   GURL* inner_url_;
 
@@ -387,4 +537,30 @@ class GURL {
 // Stream operator so GURL can be used in assertion statements.
 GURL_API std::ostream& operator<<(std::ostream& out, const GURL& url);
 
+// Allows GURL to be used as a key in hashed containers, using the cached hash
+// of the spec.
+namespace std {
+template<> struct hash<GURL> {
+  size_t operator()(const GURL& url) const {
+    return static_cast<size_t>(url.hash());
+  }
+};
+template<> struct hash<url_util::OriginKey> {
+  size_t operator()(const url_util::OriginKey& key) const {
+    return static_cast<size_t>(key.hash());
+  }
+};
+}  // namespace std
+
+#if defined(__GLIBCXX__)
+#include <backward/hash_fun.h>
+namespace __gnu_cxx {
+template<> struct hash<GURL> {
+  size_t operator()(const GURL& url) const {
+    return static_cast<size_t>(url.hash());
+  }
+};
+}  // namespace __gnu_cxx
+#endif
+
 #endif  // GOOGLEURL_SRC_GURL_H__
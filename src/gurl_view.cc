@@ -0,0 +1,207 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <ostream>
+
+#include "googleurl/src/gurl_view.h"
+
+#include "googleurl/base/logging.h"
+#include "googleurl/src/gurl.h"
+#include "googleurl/src/url_util.h"
+
+namespace {
+
+template<typename CHAR>
+GURLView DoCanonicalize(const CHAR* spec, int spec_len,
+                        url_canon::CanonOutput* output) {
+  int begin = output->length();
+  url_parse::Parsed parsed;
+  bool is_valid = url_util::Canonicalize(spec, spec_len, NULL,
+                                         output, &parsed);
+  if (begin != 0)
+    url_parse::OffsetParsed(-begin, &parsed);
+
+  // The output may have been reallocated while canonicalizing, so the spec
+  // pointer can only be computed now.
+  return GURLView(output->data() + begin, output->length() - begin,
+                  parsed, is_valid);
+}
+
+}  // namespace
+
+GURLView::GURLView() : spec_(NULL), spec_len_(0), is_valid_(false) {
+}
+
+GURLView::GURLView(const char* canonical_spec, int canonical_spec_len,
+                   const url_parse::Parsed& parsed, bool is_valid)
+    : spec_(canonical_spec),
+      spec_len_(canonical_spec_len),
+      is_valid_(is_valid),
+      parsed_(parsed) {
+}
+
+GURLView::GURLView(const char* canonical_spec, int canonical_spec_len,
+                   const url_parse::CompactParsed& parsed, bool is_valid)
+    : spec_(canonical_spec),
+      spec_len_(canonical_spec_len),
+      is_valid_(is_valid),
+      parsed_(parsed.ToParsed()) {
+}
+
+GURLView::GURLView(const GURL& url)
+    : spec_(url.possibly_invalid_spec().data()),
+      spec_len_(static_cast<int>(url.possibly_invalid_spec().length())),
+      is_valid_(url.is_valid()),
+      parsed_(url.parsed_for_possibly_invalid_spec()) {
+}
+
+// static
+GURLView GURLView::Canonicalize(const char* spec, int spec_len,
+                                url_canon::CanonOutput* output) {
+  return DoCanonicalize(spec, spec_len, output);
+}
+
+// static
+GURLView GURLView::Canonicalize(const char16* spec, int spec_len,
+                                url_canon::CanonOutput* output) {
+  return DoCanonicalize(spec, spec_len, output);
+}
+
+GURL GURLView::ToGURL() const {
+  if (is_empty())
+    return GURL();
+  return GURL(spec_, spec_len_, parsed_, is_valid_);
+}
+
+base::StringPiece GURLView::spec() const {
+  if (is_valid_ || is_empty())
+    return possibly_invalid_spec();
+
+  DCHECK(false) << "Trying to get the spec of an invalid URL!";
+  return base::StringPiece();
+}
+
+bool GURLView::IsStandard() const {
+  return url_util::IsStandard(spec_, parsed_.scheme);
+}
+
+bool GURLView::SchemeIs(const char* lower_ascii_scheme) const {
+  if (parsed_.scheme.len <= 0)
+    return lower_ascii_scheme == NULL;
+  return url_util::LowerCaseEqualsASCII(spec_ + parsed_.scheme.begin,
+                                        spec_ + parsed_.scheme.end(),
+                                        lower_ascii_scheme);
+}
+
+bool GURLView::SchemeIsSecure() const {
+  if (SchemeIs("https"))
+    return true;
+  const url_parse::Parsed* inner = parsed_.inner_parsed();
+  return is_valid_ && inner && SchemeIsFileSystem() &&
+      inner->scheme.is_nonempty() &&
+      url_util::LowerCaseEqualsASCII(spec_ + inner->scheme.begin,
+                                     spec_ + inner->scheme.end(),
+                                     "https");
+}
+
+bool GURLView::HostIsIPAddress() const {
+  if (!is_valid_ || is_empty())
+     return false;
+
+  url_canon::RawCanonOutputT<char, 128> ignored_output;
+  url_canon::CanonHostInfo host_info;
+  url_canon::CanonicalizeIPAddress(spec_, parsed_.host,
+                                   &ignored_output, &host_info);
+  return host_info.IsIPAddress();
+}
+
+int GURLView::IntPort() const {
+  if (parsed_.port.is_nonempty())
+    return url_parse::ParsePort(spec_, parsed_.port);
+  return url_parse::PORT_UNSPECIFIED;
+}
+
+int GURLView::EffectiveIntPort() const {
+  int int_port = IntPort();
+  if (int_port == url_parse::PORT_UNSPECIFIED && IsStandard())
+    return url_canon::DefaultPortForScheme(spec_ + parsed_.scheme.begin,
+                                           parsed_.scheme.len);
+  return int_port;
+}
+
+base::StringPiece GURLView::ExtractFileName() const {
+  url_parse::Component file_component;
+  url_parse::ExtractFileName(spec_, parsed_.path, &file_component);
+  return ComponentString(file_component);
+}
+
+base::StringPiece GURLView::PathForRequest() const {
+  DCHECK(parsed_.path.len > 0) << "Canonical path for requests should be non-empty";
+  if (parsed_.ref.len >= 0) {
+    // Clip off the reference when it exists. The reference starts after the #
+    // sign, so we have to subtract one to also remove it.
+    return base::StringPiece(spec_ + parsed_.path.begin,
+                             parsed_.ref.begin - parsed_.path.begin - 1);
+  }
+
+  // Use everything form the path to the end.
+  return base::StringPiece(spec_ + parsed_.path.begin,
+                           spec_len_ - parsed_.path.begin);
+}
+
+base::StringPiece GURLView::HostNoBrackets() const {
+  // If host looks like an IPv6 literal, strip the square brackets.
+  url_parse::Component h(parsed_.host);
+  if (h.len >= 2 && spec_[h.begin] == '[' && spec_[h.end() - 1] == ']') {
+    h.begin++;
+    h.len -= 2;
+  }
+  return ComponentString(h);
+}
+
+bool GURLView::DomainIs(const char* lower_ascii_domain,
+                        int domain_len) const {
+  // Return false if this URL is not valid or domain is empty.
+  if (!is_valid_ || !domain_len)
+    return false;
+
+  // FileSystem URLs have an empty host, the domain is that of the inner URL.
+  url_parse::Component host = parsed_.host;
+  if (SchemeIsFileSystem() && parsed_.inner_parsed())
+    host = parsed_.inner_parsed()->host;
+
+  if (!host.is_nonempty())
+    return false;
+  return url_util::DomainIs(spec_ + host.begin, host.len,
+                            lower_ascii_domain, domain_len);
+}
+
+std::ostream& operator<<(std::ostream& out, const GURLView& url) {
+  return out << url.possibly_invalid_spec();
+}
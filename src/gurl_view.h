@@ -0,0 +1,212 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef GOOGLEURL_SRC_GURL_VIEW_H__
+#define GOOGLEURL_SRC_GURL_VIEW_H__
+
+#include <string.h>
+
+#include "googleurl/base/string16.h"
+#include "googleurl/base/string_piece.h"
+#include "googleurl/src/url_canon.h"
+#include "googleurl/src/url_common.h"
+#include "googleurl/src/url_parse.h"
+
+class GURL;
+
+// A GURLView is a read-only canonical URL whose spec is stored in a buffer
+// owned by somebody else: a caller's stack buffer, an arena shared by many
+// URLs, or another GURL. Creating, copying and destroying one never touches
+// the heap, and all of the component getters return StringPieces into the
+// underlying buffer rather than copies.
+//
+// The caller is responsible for keeping the buffer alive, and not resizing
+// it, for as long as any view refers to it. When canonicalizing many URLs
+// into one output, either reserve enough capacity up front or canonicalize
+// them all first (see url_util::CanonicalizeBatch) and create the views from
+// the final buffer.
+//
+// The accessors mirror the ones on GURL, see gurl.h for their documentation.
+// Nested URLs are not expanded into a second object: for filesystem: URLs the
+// inner URL is only available via parsed_for_possibly_invalid_spec().
+class GURLView {
+ public:
+  // Creates an empty, invalid view.
+  GURL_API GURLView();
+
+  // Refers to a URL that has already been parsed and canonicalized. The
+  // components of |parsed| must be relative to |canonical_spec|, which is not
+  // copied and must outlive the view.
+  GURL_API GURLView(const char* canonical_spec, int canonical_spec_len,
+                    const url_parse::Parsed& parsed, bool is_valid);
+
+  // Same as above, with the components unpacked from a CompactParsed, as
+  // when the view is over a spec in a table that stores the packed form.
+  GURL_API GURLView(const char* canonical_spec, int canonical_spec_len,
+                    const url_parse::CompactParsed& parsed, bool is_valid);
+
+  // Refers to the spec owned by the given GURL. The GURL must outlive the
+  // view and must not be modified while the view is in use.
+  GURL_API explicit GURLView(const GURL& url);
+
+  // Canonicalizes the given input, appending the result to |output|, and
+  // returns a view of it. The input need not be NULL terminated. The view is
+  // only usable as long as |output| is not destroyed or resized.
+  GURL_API static GURLView Canonicalize(const char* spec, int spec_len,
+                                        url_canon::CanonOutput* output);
+  GURL_API static GURLView Canonicalize(const char16* spec, int spec_len,
+                                        url_canon::CanonOutput* output);
+
+  // Makes a GURL holding its own copy of the spec.
+  GURL_API GURL ToGURL() const;
+
+  bool is_valid() const {
+    return is_valid_;
+  }
+  bool is_empty() const {
+    return spec_len_ == 0;
+  }
+
+  // Returns the spec if the URL is valid. Like GURL::spec(), this asserts and
+  // returns an empty string for invalid, nonempty URLs.
+  GURL_API base::StringPiece spec() const;
+
+  base::StringPiece possibly_invalid_spec() const {
+    return base::StringPiece(spec_, spec_len_);
+  }
+
+  const url_parse::Parsed& parsed_for_possibly_invalid_spec() const {
+    return parsed_;
+  }
+
+  bool operator==(const GURLView& other) const {
+    return possibly_invalid_spec() == other.possibly_invalid_spec();
+  }
+  bool operator!=(const GURLView& other) const {
+    return possibly_invalid_spec() != other.possibly_invalid_spec();
+  }
+  bool operator<(const GURLView& other) const {
+    return possibly_invalid_spec() < other.possibly_invalid_spec();
+  }
+
+  GURL_API bool IsStandard() const;
+  GURL_API bool SchemeIs(const char* lower_ascii_scheme) const;
+  bool SchemeIsFile() const {
+    return SchemeIs("file");
+  }
+  bool SchemeIsFileSystem() const {
+    return SchemeIs("filesystem");
+  }
+  GURL_API bool SchemeIsSecure() const;
+  GURL_API bool HostIsIPAddress() const;
+
+  base::StringPiece scheme() const {
+    return ComponentString(parsed_.scheme);
+  }
+  base::StringPiece username() const {
+    return ComponentString(parsed_.username);
+  }
+  base::StringPiece password() const {
+    return ComponentString(parsed_.password);
+  }
+  base::StringPiece host() const {
+    return ComponentString(parsed_.host);
+  }
+  base::StringPiece port() const {
+    return ComponentString(parsed_.port);
+  }
+  base::StringPiece path() const {
+    return ComponentString(parsed_.path);
+  }
+  base::StringPiece query() const {
+    return ComponentString(parsed_.query);
+  }
+  base::StringPiece ref() const {
+    return ComponentString(parsed_.ref);
+  }
+
+  bool has_scheme() const {
+    return parsed_.scheme.len >= 0;
+  }
+  bool has_username() const {
+    return parsed_.username.len >= 0;
+  }
+  bool has_password() const {
+    return parsed_.password.len >= 0;
+  }
+  bool has_host() const {
+    // Note that hosts are special, absense of host means length 0.
+    return parsed_.host.len > 0;
+  }
+  bool has_port() const {
+    return parsed_.port.len >= 0;
+  }
+  bool has_path() const {
+    return parsed_.path.len >= 0;
+  }
+  bool has_query() const {
+    return parsed_.query.len >= 0;
+  }
+  bool has_ref() const {
+    return parsed_.ref.len >= 0;
+  }
+
+  GURL_API int IntPort() const;
+  GURL_API int EffectiveIntPort() const;
+  GURL_API base::StringPiece ExtractFileName() const;
+  GURL_API base::StringPiece PathForRequest() const;
+  GURL_API base::StringPiece HostNoBrackets() const;
+
+  GURL_API bool DomainIs(const char* lower_ascii_domain, int domain_len) const;
+  bool DomainIs(const char* lower_ascii_domain) const {
+    return DomainIs(lower_ascii_domain,
+                    static_cast<int>(strlen(lower_ascii_domain)));
+  }
+
+ private:
+  base::StringPiece ComponentString(const url_parse::Component& comp) const {
+    if (comp.len <= 0)
+      return base::StringPiece();
+    return base::StringPiece(spec_ + comp.begin, comp.len);
+  }
+
+  // The canonical spec, not owned by this object.
+  const char* spec_;
+  int spec_len_;
+
+  bool is_valid_;
+
+  // Identified components of the canonical spec, relative to |spec_|.
+  url_parse::Parsed parsed_;
+};
+
+// Stream operator so GURLView can be used in assertion statements.
+GURL_API std::ostream& operator<<(std::ostream& out, const GURLView& url);
+
+#endif  // GOOGLEURL_SRC_GURL_VIEW_H__
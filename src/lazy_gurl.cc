@@ -0,0 +1,313 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "googleurl/src/lazy_gurl.h"
+
+#include "googleurl/base/logging.h"
+#include "googleurl/src/url_canon.h"
+#include "googleurl/src/url_file.h"
+
+namespace {
+
+const url_parse::Component& GetParsedComponent(
+    const url_parse::Parsed& parsed,
+    url_parse::Parsed::ComponentType type) {
+  switch (type) {
+    case url_parse::Parsed::SCHEME:
+      return parsed.scheme;
+    case url_parse::Parsed::USERNAME:
+      return parsed.username;
+    case url_parse::Parsed::PASSWORD:
+      return parsed.password;
+    case url_parse::Parsed::HOST:
+      return parsed.host;
+    case url_parse::Parsed::PORT:
+      return parsed.port;
+    case url_parse::Parsed::PATH:
+      return parsed.path;
+    case url_parse::Parsed::QUERY:
+      return parsed.query;
+    default:
+      DCHECK(type == url_parse::Parsed::REF);
+      return parsed.ref;
+  }
+}
+
+// The components that decide whether a standard URL is valid. Failures
+// canonicalizing the query and the ref are ignored, as in
+// url_canon::CanonicalizeStandardURL.
+const int kValidityMask = (1 << url_parse::Parsed::SCHEME) |
+                          (1 << url_parse::Parsed::USERNAME) |
+                          (1 << url_parse::Parsed::PASSWORD) |
+                          (1 << url_parse::Parsed::HOST) |
+                          (1 << url_parse::Parsed::PORT) |
+                          (1 << url_parse::Parsed::PATH);
+
+}  // namespace
+
+const int LazyGURL::kNumComponents;
+
+LazyGURL::LazyGURL()
+    : scheme_id_(url_util::SCHEME_UNKNOWN),
+      lazy_(false),
+      done_mask_(0),
+      present_mask_(0),
+      failed_mask_(0),
+      have_url_(true) {
+}
+
+LazyGURL::LazyGURL(const std::string& url_string)
+    : scheme_id_(url_util::SCHEME_UNKNOWN),
+      lazy_(false),
+      done_mask_(0),
+      present_mask_(0),
+      failed_mask_(0),
+      have_url_(false) {
+  // This follows url_util::Canonicalize up to the point where it would
+  // canonicalize a standard URL.
+  url_canon::RawCanonOutputT<char> whitespace_buffer;
+  int spec_len;
+  const char* spec = url_canon::RemoveURLWhitespace(
+      url_string.data(), static_cast<int>(url_string.length()),
+      &whitespace_buffer, &spec_len);
+
+  url_parse::Component scheme;
+  bool is_standard = false;
+#ifdef WIN32
+  // Windows paths become file URLs, see url_util::Canonicalize.
+  if (!url_parse::DoesBeginUNCPath(spec, 0, spec_len, false) &&
+      !url_parse::DoesBeginWindowsDriveSpec(spec, 0, spec_len))
+#endif
+  if (url_parse::ExtractScheme(spec, spec_len, &scheme)) {
+    scheme_id_ = url_util::FindSchemeID(spec, scheme);
+    is_standard = url_util::IsStandardSchemeID(scheme_id_) &&
+#ifdef FULL_FILESYSTEM_URL_SUPPORT
+                  scheme_id_ != url_util::SCHEME_FILESYSTEM &&
+#endif
+                  scheme_id_ != url_util::SCHEME_FILE;
+  }
+
+  if (is_standard) {
+    lazy_ = true;
+    input_.assign(spec, spec_len);
+    url_parse::ParseStandardURL(input_.data(), spec_len, &parsed_);
+  } else {
+    url_ = GURL(url_string);
+    have_url_ = true;
+    scheme_id_ = url_.scheme_id();
+  }
+}
+
+LazyGURL::~LazyGURL() {
+}
+
+const GURL& LazyGURL::ToGURL() const {
+  if (!have_url_) {
+    url_ = GURL(input_);
+    have_url_ = true;
+  }
+  return url_;
+}
+
+bool LazyGURL::is_valid() const {
+  if (!lazy_)
+    return url_.is_valid();
+  for (int i = 0; i < kNumComponents; i++) {
+    if (kValidityMask & (1 << i))
+      GetComponent(static_cast<url_parse::Parsed::ComponentType>(i));
+  }
+  return (failed_mask_ & kValidityMask) == 0;
+}
+
+bool LazyGURL::SchemeIs(const char* lower_ascii_scheme) const {
+  if (!lazy_)
+    return url_.SchemeIs(lower_ascii_scheme);
+  // Standard schemes are made of valid scheme characters, so comparing the
+  // input gives the same answer as comparing the canonical scheme.
+  return url_util::LowerCaseEqualsASCII(
+      input_.data() + parsed_.scheme.begin,
+      input_.data() + parsed_.scheme.end(),
+      lower_ascii_scheme);
+}
+
+bool LazyGURL::SchemeIsSecure() const {
+  if (!lazy_)
+    return url_.SchemeIsSecure();
+  return scheme_id_ == url_util::SCHEME_HTTPS;
+}
+
+int LazyGURL::IntPort() const {
+  const std::string& canon_port = port();
+  if (canon_port.empty())
+    return url_parse::PORT_UNSPECIFIED;
+  return url_parse::ParsePort(
+      canon_port.data(),
+      url_parse::Component(0, static_cast<int>(canon_port.length())));
+}
+
+int LazyGURL::EffectiveIntPort() const {
+  if (!lazy_)
+    return url_.EffectiveIntPort();
+  int int_port = IntPort();
+  if (int_port == url_parse::PORT_UNSPECIFIED) {
+    const std::string& canon_scheme = scheme();
+    return url_canon::DefaultPortForScheme(
+        canon_scheme.data(), static_cast<int>(canon_scheme.length()));
+  }
+  return int_port;
+}
+
+bool LazyGURL::DomainIs(const char* lower_ascii_domain,
+                        int domain_len) const {
+  if (!lazy_)
+    return url_.DomainIs(lower_ascii_domain, domain_len);
+  if (!domain_len || !is_valid())
+    return false;
+  const std::string& canon_host = host();
+  if (canon_host.empty())
+    return false;
+  return url_util::DomainIs(canon_host.data(),
+                            static_cast<int>(canon_host.length()),
+                            lower_ascii_domain, domain_len);
+}
+
+const std::string& LazyGURL::GetComponent(
+    url_parse::Parsed::ComponentType type) const {
+  if (!(done_mask_ & (1 << type)))
+    CanonicalizeComponent(type);
+  return components_[type];
+}
+
+void LazyGURL::CanonicalizeComponent(
+    url_parse::Parsed::ComponentType type) const {
+  int bit = 1 << type;
+  if (!lazy_) {
+    // Copy the component out of the canonical URL.
+    const url_parse::Component& comp =
+        GetParsedComponent(url_.parsed_for_possibly_invalid_spec(), type);
+    if (comp.len > 0)
+      components_[type].assign(url_.possibly_invalid_spec(), comp.begin,
+                               comp.len);
+    if (comp.is_valid())
+      present_mask_ |= bit;
+    done_mask_ |= bit;
+    return;
+  }
+
+  // Each component is canonicalized on its own, as
+  // url_canon::CanonicalizeStandardURL would.
+  const char* spec = input_.data();
+  url_canon::RawCanonOutput<256> output;
+  url_parse::Component out;
+  bool success = true;
+
+  bool have_authority = parsed_.username.is_valid() ||
+                        parsed_.password.is_valid() ||
+                        parsed_.host.is_nonempty() ||
+                        parsed_.port.is_valid();
+  switch (type) {
+    case url_parse::Parsed::SCHEME:
+      success = url_canon::CanonicalizeScheme(spec, parsed_.scheme,
+                                              &output, &out);
+      break;
+    case url_parse::Parsed::USERNAME:
+    case url_parse::Parsed::PASSWORD: {
+      // These are written together, so do both at once.
+      url_parse::Component out_username, out_password;
+      if (have_authority) {
+        success = url_canon::CanonicalizeUserInfo(spec, parsed_.username,
+                                                  spec, parsed_.password,
+                                                  &output, &out_username,
+                                                  &out_password);
+      }
+      int user_bits = (1 << url_parse::Parsed::USERNAME) |
+                      (1 << url_parse::Parsed::PASSWORD);
+      if (out_username.len > 0) {
+        components_[url_parse::Parsed::USERNAME].assign(
+            output.data() + out_username.begin, out_username.len);
+      }
+      if (out_password.len > 0) {
+        components_[url_parse::Parsed::PASSWORD].assign(
+            output.data() + out_password.begin, out_password.len);
+      }
+      if (out_username.is_valid())
+        present_mask_ |= 1 << url_parse::Parsed::USERNAME;
+      if (out_password.is_valid())
+        present_mask_ |= 1 << url_parse::Parsed::PASSWORD;
+      if (!success)
+        failed_mask_ |= user_bits;
+      done_mask_ |= user_bits;
+      return;
+    }
+    case url_parse::Parsed::HOST:
+      if (have_authority) {
+        success = url_canon::CanonicalizeHost(spec, parsed_.host,
+                                              &output, &out);
+      }
+      // Standard URLs must have a nonempty host, which also implies an
+      // authority.
+      if (!parsed_.host.is_nonempty())
+        success = false;
+      break;
+    case url_parse::Parsed::PORT:
+      if (have_authority) {
+        const std::string& canon_scheme = scheme();
+        int default_port = url_canon::DefaultPortForScheme(
+            canon_scheme.data(), static_cast<int>(canon_scheme.length()));
+        success = url_canon::CanonicalizePort(spec, parsed_.port,
+                                              default_port, &output, &out);
+      }
+      break;
+    case url_parse::Parsed::PATH:
+      if (parsed_.path.is_valid()) {
+        success = url_canon::CanonicalizePath(spec, parsed_.path,
+                                              &output, &out);
+      } else if (have_authority ||
+                 parsed_.query.is_valid() || parsed_.ref.is_valid()) {
+        // Standard URLs get a "/" path if they have anything else.
+        out = url_parse::Component(0, 1);
+        output.push_back('/');
+      }
+      break;
+    case url_parse::Parsed::QUERY:
+      url_canon::CanonicalizeQuery(spec, parsed_.query, NULL, &output, &out);
+      break;
+    case url_parse::Parsed::REF:
+      url_canon::CanonicalizeRef(spec, parsed_.ref, &output, &out);
+      break;
+  }
+
+  if (out.len > 0)
+    components_[type].assign(output.data() + out.begin, out.len);
+  if (out.is_valid())
+    present_mask_ |= bit;
+  if (!success)
+    failed_mask_ |= bit;
+  done_mask_ |= bit;
+}
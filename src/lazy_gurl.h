@@ -0,0 +1,201 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef GOOGLEURL_SRC_LAZY_GURL_H__
+#define GOOGLEURL_SRC_LAZY_GURL_H__
+
+#include <string.h>
+
+#include <string>
+
+#include "googleurl/base/basictypes.h"
+#include "googleurl/src/gurl.h"
+#include "googleurl/src/url_common.h"
+#include "googleurl/src/url_parse.h"
+#include "googleurl/src/url_util.h"
+
+// A LazyGURL is a URL that is only parsed when it is created, and whose
+// components are canonicalized one at a time, the first time each one is
+// asked for. Code that only looks at the scheme and the host of each URL, as
+// filters usually do, then never pays for canonicalizing long paths and
+// queries. The full canonical spec is only built by spec() and ToGURL().
+//
+// Every accessor returns exactly what the same accessor on GURL(url_string)
+// would, see gurl.h for their documentation. Only URLs with a standard scheme
+// other than file: are handled lazily; everything else is canonicalized up
+// front, as GURL does.
+//
+// The canonicalized components are cached in the object, so unlike GURL even
+// the const accessors modify it: a LazyGURL must not be used from several
+// threads at once without locking.
+class LazyGURL {
+ public:
+  // Creates an empty, invalid URL.
+  GURL_API LazyGURL();
+
+  // Parses the given input. Like GURL, this removes any tabs and newlines.
+  GURL_API explicit LazyGURL(const std::string& url_string);
+
+  GURL_API ~LazyGURL();
+
+  // Returns the fully canonicalized URL, canonicalizing the rest of the
+  // components if needed. The result is cached.
+  GURL_API const GURL& ToGURL() const;
+
+  // Same as GURL::is_valid. Since this depends on every component before the
+  // query, it canonicalizes all of them.
+  GURL_API bool is_valid() const;
+  bool is_empty() const {
+    return ToGURL().is_empty();
+  }
+  const std::string& spec() const {
+    return ToGURL().spec();
+  }
+  const std::string& possibly_invalid_spec() const {
+    return ToGURL().possibly_invalid_spec();
+  }
+
+  // These only look at the parsed scheme, so never canonicalize anything.
+  GURL_API bool SchemeIs(const char* lower_ascii_scheme) const;
+  bool SchemeIs(url_util::SchemeID scheme_id) const {
+    return scheme_id_ == scheme_id && scheme_id != url_util::SCHEME_UNKNOWN;
+  }
+  url_util::SchemeID scheme_id() const {
+    return scheme_id_;
+  }
+  GURL_API bool SchemeIsSecure() const;
+
+  // Each of these canonicalizes only the component it returns the first time
+  // it is called (the username and password are done together). The returned
+  // reference is valid for as long as this object is.
+  const std::string& scheme() const {
+    return GetComponent(url_parse::Parsed::SCHEME);
+  }
+  const std::string& username() const {
+    return GetComponent(url_parse::Parsed::USERNAME);
+  }
+  const std::string& password() const {
+    return GetComponent(url_parse::Parsed::PASSWORD);
+  }
+  const std::string& host() const {
+    return GetComponent(url_parse::Parsed::HOST);
+  }
+  const std::string& port() const {
+    return GetComponent(url_parse::Parsed::PORT);
+  }
+  const std::string& path() const {
+    return GetComponent(url_parse::Parsed::PATH);
+  }
+  const std::string& query() const {
+    return GetComponent(url_parse::Parsed::QUERY);
+  }
+  const std::string& ref() const {
+    return GetComponent(url_parse::Parsed::REF);
+  }
+
+  bool has_scheme() const {
+    return HasComponent(url_parse::Parsed::SCHEME);
+  }
+  bool has_username() const {
+    return HasComponent(url_parse::Parsed::USERNAME);
+  }
+  bool has_password() const {
+    return HasComponent(url_parse::Parsed::PASSWORD);
+  }
+  bool has_host() const {
+    // Note that hosts are special, absense of host means length 0.
+    return !host().empty();
+  }
+  bool has_port() const {
+    return HasComponent(url_parse::Parsed::PORT);
+  }
+  bool has_path() const {
+    return HasComponent(url_parse::Parsed::PATH);
+  }
+  bool has_query() const {
+    return HasComponent(url_parse::Parsed::QUERY);
+  }
+  bool has_ref() const {
+    return HasComponent(url_parse::Parsed::REF);
+  }
+
+  GURL_API int IntPort() const;
+  GURL_API int EffectiveIntPort() const;
+
+  // Needs the host and, since invalid URLs never match, everything that
+  // is_valid() needs.
+  GURL_API bool DomainIs(const char* lower_ascii_domain, int domain_len) const;
+  bool DomainIs(const char* lower_ascii_domain) const {
+    return DomainIs(lower_ascii_domain,
+                    static_cast<int>(strlen(lower_ascii_domain)));
+  }
+
+ private:
+  // Returns the canonical form of the given component, canonicalizing it if
+  // this hasn't been done yet.
+  GURL_API const std::string& GetComponent(
+      url_parse::Parsed::ComponentType type) const;
+
+  // Whether the canonical URL has the given component, even if empty.
+  bool HasComponent(url_parse::Parsed::ComponentType type) const {
+    GetComponent(type);
+    return (present_mask_ & (1 << type)) != 0;
+  }
+
+  // Canonicalizes the given component of input_ into components_, setting
+  // the bits for it in the masks below.
+  void CanonicalizeComponent(url_parse::Parsed::ComponentType type) const;
+
+  static const int kNumComponents = url_parse::Parsed::REF + 1;
+
+  // The input with tabs and newlines removed, and its components.
+  std::string input_;
+  url_parse::Parsed parsed_;
+
+  url_util::SchemeID scheme_id_;
+
+  // True when the URL is canonicalized one component at a time. When false,
+  // url_ is always filled in and the components come from it.
+  bool lazy_;
+
+  // The canonical components that have been computed so far. For each
+  // component, bit (1 << type) is set in done_mask_ once it has been
+  // canonicalized, in present_mask_ if the canonical URL has it, and in
+  // failed_mask_ if canonicalizing it failed.
+  mutable std::string components_[kNumComponents];
+  mutable uint8 done_mask_;
+  mutable uint8 present_mask_;
+  mutable uint8 failed_mask_;
+
+  // The full canonical URL, once somebody asks for it.
+  mutable GURL url_;
+  mutable bool have_url_;
+};
+
+#endif  // GOOGLEURL_SRC_LAZY_GURL_H__
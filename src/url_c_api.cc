@@ -0,0 +1,109 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "googleurl/src/url_c_api.h"
+
+#include "googleurl/src/url_canon.h"
+#include "googleurl/src/url_parse.h"
+#include "googleurl/src/url_util.h"
+
+namespace {
+
+void ToComponent(const gurl_component& in, url_parse::Component* out) {
+  out->begin = in.begin;
+  out->len = in.len;
+}
+
+void FromComponent(const url_parse::Component& in, gurl_component* out) {
+  out->begin = in.begin;
+  out->len = in.len;
+}
+
+void ToParsed(const gurl_parsed& in, url_parse::Parsed* out) {
+  ToComponent(in.scheme, &out->scheme);
+  ToComponent(in.username, &out->username);
+  ToComponent(in.password, &out->password);
+  ToComponent(in.host, &out->host);
+  ToComponent(in.port, &out->port);
+  ToComponent(in.path, &out->path);
+  ToComponent(in.query, &out->query);
+  ToComponent(in.ref, &out->ref);
+}
+
+void FromParsed(const url_parse::Parsed& in, gurl_parsed* out) {
+  FromComponent(in.scheme, &out->scheme);
+  FromComponent(in.username, &out->username);
+  FromComponent(in.password, &out->password);
+  FromComponent(in.host, &out->host);
+  FromComponent(in.port, &out->port);
+  FromComponent(in.path, &out->path);
+  FromComponent(in.query, &out->query);
+  FromComponent(in.ref, &out->ref);
+}
+
+// Fills in the results of a call whose output has the given length.
+int Finish(int length, char* buffer, int capacity, bool success,
+           const url_parse::Parsed& new_parsed, gurl_parsed* parsed,
+           int* is_valid) {
+  if (length < capacity)
+    buffer[length] = 0;
+  FromParsed(new_parsed, parsed);
+  *is_valid = success;
+  return length;
+}
+
+}  // namespace
+
+int gurl_canonicalize(const char* spec, int spec_len,
+                      char* buffer, int capacity,
+                      gurl_parsed* parsed, int* is_valid) {
+  url_canon::FixedBufferCanonOutput output(buffer, capacity);
+  url_parse::Parsed new_parsed;
+  bool success = url_util::Canonicalize(spec, spec_len, NULL, &output,
+                                        &new_parsed);
+  output.Complete();
+  return Finish(output.length(), buffer, capacity, success, new_parsed,
+                parsed, is_valid);
+}
+
+int gurl_resolve_relative(const char* base_spec, int base_spec_len,
+                          const gurl_parsed* base_parsed,
+                          const char* relative, int relative_len,
+                          char* buffer, int capacity,
+                          gurl_parsed* parsed, int* is_valid) {
+  url_parse::Parsed base;
+  ToParsed(*base_parsed, &base);
+  url_canon::FixedBufferCanonOutput output(buffer, capacity);
+  url_parse::Parsed new_parsed;
+  bool success = url_util::ResolveRelative(base_spec, base_spec_len, base,
+                                           relative, relative_len, NULL,
+                                           &output, &new_parsed);
+  output.Complete();
+  return Finish(output.length(), buffer, capacity, success, new_parsed,
+                parsed, is_valid);
+}
@@ -0,0 +1,98 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// A C interface to canonicalization and relative resolution, for foreign
+// function bindings and for callers that keep URLs in fixed size records.
+// Everything is written straight into a buffer supplied by the caller, with
+// no C++ types crossing the interface.
+//
+// Each call returns the length of its output. When that is larger than the
+// capacity of the buffer, the buffer contents are unspecified but the
+// components are still filled in, so the caller can retry once with a buffer
+// of the returned size:
+//
+//   int len = gurl_canonicalize(spec, spec_len, buf, cap, &parsed, &valid);
+//   if (len > cap) {
+//     buf = realloc(buf, len);
+//     gurl_canonicalize(spec, spec_len, buf, len, &parsed, &valid);
+//   }
+//
+// The output is not NUL terminated, but a NUL is written after it when there
+// is room for one.
+
+#ifndef GOOGLEURL_SRC_URL_C_API_H__
+#define GOOGLEURL_SRC_URL_C_API_H__
+
+#include "googleurl/src/url_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A range of the output, the same as a url_parse::Component: |len| is -1 for
+// a component that is not present, and 0 for one that is present but empty.
+typedef struct gurl_component {
+  int begin;
+  int len;
+} gurl_component;
+
+// The components of a URL, the same as a url_parse::Parsed without the inner
+// URL of filesystem: URLs.
+typedef struct gurl_parsed {
+  gurl_component scheme;
+  gurl_component username;
+  gurl_component password;
+  gurl_component host;
+  gurl_component port;
+  gurl_component path;
+  gurl_component query;
+  gurl_component ref;
+} gurl_parsed;
+
+// Canonicalizes the |spec_len| bytes of UTF-8 at |spec| into the |capacity|
+// bytes at |buffer|, like url_util::Canonicalize, and fills in |parsed|. Sets
+// |*is_valid| to nonzero if the URL is valid; invalid URLs give output too.
+// Returns the length of the canonical URL.
+GURL_API int gurl_canonicalize(const char* spec, int spec_len,
+                               char* buffer, int capacity,
+                               gurl_parsed* parsed, int* is_valid);
+
+// Resolves |relative| against the canonical URL at |base_spec|, whose
+// components are |base_parsed| (usually from a previous gurl_canonicalize),
+// like url_util::ResolveRelative. The output works as for gurl_canonicalize.
+GURL_API int gurl_resolve_relative(const char* base_spec, int base_spec_len,
+                                   const gurl_parsed* base_parsed,
+                                   const char* relative, int relative_len,
+                                   char* buffer, int capacity,
+                                   gurl_parsed* parsed, int* is_valid);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // GOOGLEURL_SRC_URL_C_API_H__
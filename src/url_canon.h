@@ -33,6 +33,7 @@
 #include <stdlib.h>
 
 #include "googleurl/base/string16.h"
+#include "googleurl/src/url_canon_stats.h"
 #include "googleurl/src/url_common.h"
 #include "googleurl/src/url_parse.h"
 
@@ -51,7 +52,9 @@ namespace url_canon {
 template<typename T>
 class CanonOutputT {
  public:
-  CanonOutputT() : buffer_(NULL), buffer_len_(0), cur_len_(0) {
+  CanonOutputT()
+      : buffer_(NULL), buffer_len_(0), cur_len_(0),
+        max_capacity_(1 << 30), truncated_(false) {
   }
   virtual ~CanonOutputT() {
   }
@@ -136,22 +139,78 @@ class CanonOutputT {
       if (!Grow(cur_len_ + str_len - buffer_len_))
         return;
     }
-    for (int i = 0; i < str_len; i++)
-      buffer_[cur_len_ + i] = str[i];
+    if (str_len > 0)
+      memcpy(&buffer_[cur_len_], str, str_len * sizeof(T));
     cur_len_ += str_len;
   }
 
+  // Makes sure there is room for |count| more items past the end of the
+  // output and returns a pointer to them, or NULL on OOM. The caller can then
+  // write up to |count| items there directly, and must call CommitSpan()
+  // with the number actually written before calling any other function that
+  // modifies the output. This does the capacity check once for the whole
+  // block rather than once per item as push_back does.
+  T* ReserveSpan(int count) {
+    if (cur_len_ + count > buffer_len_) {
+      if (!Grow(cur_len_ + count - buffer_len_))
+        return NULL;
+    }
+    return &buffer_[cur_len_];
+  }
+
+  // Declares that |count| items were written to the span returned by the
+  // last call to ReserveSpan().
+  void CommitSpan(int count) {
+    cur_len_ += count;
+  }
+
+  // Limits the capacity the buffer may grow to. Once it is reached, appends
+  // that would need more room are dropped, as on OOM, and truncated() starts
+  // returning true. This is only checked when growing, so it costs nothing
+  // on the common path; it does not shrink a buffer that is already larger,
+  // and does not apply to code calling Resize() directly. Canonicalizers that
+  // read back what they wrote check truncated() first, so the output is only
+  // meant to be discarded once it is set.
+  void set_max_capacity(int max_capacity) {
+    max_capacity_ = max_capacity;
+    truncated_ = false;
+  }
+  int max_capacity() const {
+    return max_capacity_;
+  }
+
+  // Returns true if any output was dropped because the buffer could not grow
+  // since the last call to set_max_capacity().
+  bool truncated() const {
+    return truncated_;
+  }
+
+  // Marks output as dropped, for code that builds part of the output in a
+  // buffer of its own and finds that it would not fit.
+  void set_truncated() {
+    truncated_ = true;
+  }
+
  protected:
   // Grows the given buffer so that it can fit at least |min_additional|
   // characters. Returns true if the buffer could be resized, false on OOM.
   bool Grow(int min_additional) {
     static const int kMinBufferLen = 16;
+    if (min_additional > max_capacity_ - buffer_len_) {
+      truncated_ = true;
+      return false;
+    }
     int new_len = (buffer_len_ == 0) ? kMinBufferLen : buffer_len_;
     do {
-      if (new_len >= (1 << 30))  // Prevent overflow below.
+      if (new_len >= (1 << 30)) {  // Prevent overflow below.
+        truncated_ = true;
         return false;
+      }
       new_len *= 2;
     } while (new_len < buffer_len_ + min_additional);
+    if (new_len > max_capacity_)
+      new_len = max_capacity_;
+    CANON_STAT_INCREMENT(output_grows);
     Resize(new_len);
     return true;
   }
@@ -161,6 +220,10 @@ class CanonOutputT {
 
   // Used characters in the buffer.
   int cur_len_;
+
+  // See set_max_capacity().
+  int max_capacity_;
+  bool truncated_;
 };
 
 // Simple implementation of the CanonOutput using new[]. This class
@@ -184,6 +247,8 @@ class RawCanonOutputT : public CanonOutputT<T> {
            sizeof(T) * (this->cur_len_ < sz ? this->cur_len_ : sz));
     if (this->buffer_ != fixed_buffer_)
       delete[] this->buffer_;
+    else
+      CANON_STAT_INCREMENT(fixed_buffer_spills);
     this->buffer_ = new_buf;
     this->buffer_len_ = sz;
   }
@@ -203,6 +268,68 @@ class RawCanonOutput : public RawCanonOutputT<char, fixed_capacity> {};
 template<int fixed_capacity>
 class RawCanonOutputW : public RawCanonOutputT<char16, fixed_capacity> {};
 
+// Writes into a buffer supplied by the caller, such as a slot in shared
+// memory, without owning it. Output that fits is written there directly with
+// no copy. If it doesn't fit, canonicalization carries on in a heap buffer so
+// that the full length and components are still known: overflowed() then
+// returns true and length() is the capacity the caller needs to retry with.
+// The contents of the caller's buffer are unspecified in that case.
+//
+// The output can spill and then shrink back to fit, for example when ".."
+// segments remove part of a long path. Complete() must be called once
+// canonicalization is done so that such output ends up in the caller's
+// buffer.
+class FixedBufferCanonOutput : public CanonOutput {
+ public:
+  FixedBufferCanonOutput(char* buffer, int capacity)
+      : CanonOutput(),
+        fixed_buffer_(buffer),
+        fixed_capacity_(capacity) {
+    this->buffer_ = buffer;
+    this->buffer_len_ = capacity;
+  }
+  virtual ~FixedBufferCanonOutput() {
+    if (overflowed())
+      delete[] this->buffer_;
+  }
+
+  // Returns true if the output did not fit in the caller's buffer.
+  bool overflowed() const {
+    return this->buffer_ != fixed_buffer_;
+  }
+
+  // Moves output that spilled to the heap but fits the caller's buffer again
+  // back there, after which overflowed() returns false.
+  void Complete() {
+    if (!overflowed() || this->cur_len_ > fixed_capacity_)
+      return;
+    memcpy(fixed_buffer_, this->buffer_, this->cur_len_);
+    delete[] this->buffer_;
+    this->buffer_ = fixed_buffer_;
+    this->buffer_len_ = fixed_capacity_;
+  }
+
+  virtual void Resize(int sz) {
+    char* new_buf = new char[sz];
+    // A probing output made with no buffer has nothing to copy yet.
+    if (this->cur_len_ > 0) {
+      memcpy(new_buf, this->buffer_,
+             this->cur_len_ < sz ? this->cur_len_ : sz);
+    }
+    if (overflowed())
+      delete[] this->buffer_;
+    this->buffer_ = new_buf;
+    this->buffer_len_ = sz;
+  }
+
+ private:
+  char* fixed_buffer_;
+  int fixed_capacity_;
+
+  FixedBufferCanonOutput(const FixedBufferCanonOutput&);
+  void operator=(const FixedBufferCanonOutput&);
+};
+
 // Character set converter ----------------------------------------------------
 //
 // Converts query strings into a custom encoding. The embedder can supply an
@@ -230,6 +357,15 @@ class CharsetConverter {
   virtual void ConvertFromUTF16(const char16* input,
                                 int input_len,
                                 CanonOutput* output) = 0;
+
+  // Same as ConvertFromUTF16 for UTF-8 input, which is what the query of an
+  // 8-bit spec is in. Invalid UTF-8 is replaced with "invalid character"
+  // characters. The default implementation converts the input to UTF-16 and
+  // calls ConvertFromUTF16; converters that can read UTF-8 directly should
+  // override it to skip the intermediate buffer.
+  GURL_API virtual void ConvertFromUTF8(const char* input,
+                                        int input_len,
+                                        CanonOutput* output);
 };
 
 // Whitespace -----------------------------------------------------------------
@@ -258,7 +394,8 @@ GURL_API const char16* RemoveURLWhitespace(const char16* input, int input_len,
 
 // IDN ------------------------------------------------------------------------
 
-// Converts the Unicode input representing a hostname to ASCII using IDN rules.
+// Converts the Unicode input representing a hostname to ASCII using IDN rules,
+// as implemented by the Unicode backend in use (see url_canon_unicode.h).
 // The output must fall in the ASCII range, but will be encoded in UTF-16.
 //
 // On success, the output will be filled with the ASCII host name and it will
@@ -400,6 +537,26 @@ GURL_API void CanonicalizeHostVerbose(const char16* spec,
                                       CanonOutput* output,
                                       CanonHostInfo* host_info);
 
+// Hosts that need unescaping or IDN conversion are expensive to canonicalize,
+// and real traffic tends to reuse a small set of them. Setting a nonzero
+// capacity enables a bounded cache, kept separately by each thread, from the
+// raw input host to its canonical form and host info. The capacity applies to
+// every thread; each thread's cache is (re)built the next time it
+// canonicalizes such a host. A capacity of 0, the default, disables caching.
+// Plain ASCII hosts are never cached since they are cheaper to canonicalize
+// than to look up.
+GURL_API void SetIDNHostCacheCapacity(int max_entries);
+
+// Hit and miss counts of the host cache, summed over all threads since the
+// last reset. These are meant for sizing the cache.
+struct IDNHostCacheStats {
+  IDNHostCacheStats() : hits(0), misses(0) {}
+
+  unsigned long long hits;
+  unsigned long long misses;
+};
+GURL_API IDNHostCacheStats GetIDNHostCacheStats();
+GURL_API void ResetIDNHostCacheStats();
 
 // IP addresses.
 //
@@ -496,6 +653,25 @@ GURL_API void CanonicalizeQuery(const char16* spec,
                                 CanonOutput* output,
                                 url_parse::Component* out_query);
 
+class QueryFilter;
+
+// Like CanonicalizeQuery, but also removes the parameters that |filter|
+// rejects as the query is written, see QueryFilter (url_canon_query_filter.h)
+// and its Apply function. When no parameter is left the '?' is not written
+// and |*out_query| is reset. The filter can be NULL to keep everything.
+GURL_API void CanonicalizeQuery(const char* spec,
+                                const url_parse::Component& query,
+                                CharsetConverter* converter,
+                                const QueryFilter* filter,
+                                CanonOutput* output,
+                                url_parse::Component* out_query);
+GURL_API void CanonicalizeQuery(const char16* spec,
+                                const url_parse::Component& query,
+                                CharsetConverter* converter,
+                                const QueryFilter* filter,
+                                CanonOutput* output,
+                                url_parse::Component* out_query);
+
 // Ref: Prepends the # if needed. The output will be UTF-8 (this is the only
 // canonicalizer that does not produce ASCII output). The output is
 // guaranteed to be valid UTF-8.
@@ -535,6 +711,38 @@ GURL_API bool CanonicalizeStandardURL(const char16* spec,
                                       CanonOutput* output,
                                       url_parse::Parsed* new_parsed);
 
+// Canonicalizes a standard URL in a single pass, writing each component as it
+// finds where the component ends rather than parsing the URL first. |scheme|
+// is the scheme found by url_parse::ExtractScheme, which must be a standard
+// one. This handles the URLs most traffic is made of: when it meets something
+// it leaves to the general code (user info, IPv6 literals, invalid
+// components), it leaves |output| as it was and returns false, and the caller
+// should parse the URL and use CanonicalizeStandardURL. When it returns true,
+// the output and |new_parsed| are exactly what that would have produced, for a
+// valid URL.
+GURL_API bool FusedCanonicalizeStandardURL(const char* spec,
+                                           int spec_len,
+                                           const url_parse::Component& scheme,
+                                           CharsetConverter* query_converter,
+                                           CanonOutput* output,
+                                           url_parse::Parsed* new_parsed);
+GURL_API bool FusedCanonicalizeStandardURL(const char16* spec,
+                                           int spec_len,
+                                           const url_parse::Component& scheme,
+                                           CharsetConverter* query_converter,
+                                           CanonOutput* output,
+                                           url_parse::Parsed* new_parsed);
+
+// Returns true if CanonicalizeStandardURL would succeed and write exactly
+// |spec| with |parsed| unchanged, that is, the URL is already canonical and
+// |parsed| (as produced by ParseStandardURL) can be used with |spec| directly.
+// This does no writing, so checking a stored canonical URL costs about as much
+// as parsing it. The check is conservative: a few unusual canonical URLs (IPv6
+// hosts, non-ASCII references) return false and need the full canonicalizer.
+GURL_API bool IsCanonicalStandardURL(const char* spec,
+                                     int spec_len,
+                                     const url_parse::Parsed& parsed);
+
 // Use for file URLs.
 GURL_API bool CanonicalizeFileURL(const char* spec,
                                   int spec_len,
@@ -549,6 +757,11 @@ GURL_API bool CanonicalizeFileURL(const char16* spec,
                                   CanonOutput* output,
                                   url_parse::Parsed* new_parsed);
 
+// The CanonicalizeFileURL equivalent of IsCanonicalStandardURL above.
+GURL_API bool IsCanonicalFileURL(const char* spec,
+                                 int spec_len,
+                                 const url_parse::Parsed& parsed);
+
 #ifdef FULL_FILESYSTEM_URL_SUPPORT
 // Use for filesystem URLs.
 GURL_API bool CanonicalizeFileSystemURL(const char* spec,
@@ -578,6 +791,11 @@ GURL_API bool CanonicalizePathURL(const char16* spec,
                                   CanonOutput* output,
                                   url_parse::Parsed* new_parsed);
 
+// The CanonicalizePathURL equivalent of IsCanonicalStandardURL above.
+GURL_API bool IsCanonicalPathURL(const char* spec,
+                                 int spec_len,
+                                 const url_parse::Parsed& parsed);
+
 // Use for mailto URLs. This "canonicalizes" the url into a path and query
 // component. It does not attempt to merge "to" fields. It uses UTF-8 for
 // the query encoding if there is a query. This is because a mailto URL is
@@ -850,6 +1068,35 @@ GURL_API bool ReplaceMailtoURL(const char* base,
 
 // Relative URL ---------------------------------------------------------------
 
+// A canonical base URL together with the things relative resolution needs to
+// know about it. Filling one in with InitRelativeBase and resolving many
+// relative URLs against it avoids recomputing these for every one of them.
+struct RelativeBase {
+  // The canonical spec of the base URL and its parsed components. The spec is
+  // not copied and must outlive this structure.
+  const char* spec;
+  url_parse::Parsed parsed;
+
+  // Whether the base URL is hierarchical (has a standard scheme), is a file:
+  // URL or is a filesystem: URL.
+  bool is_hierarchical;
+  bool is_file;
+  bool is_filesystem;
+
+  // Offset in |spec| just past the last slash of the path. Relative paths
+  // are appended to the base spec up to here. -1 if the path has no slash.
+  int path_prefix_end;
+};
+
+// Fills in |*relative_base| for the given canonical base URL. The flags have
+// the same meaning as the corresponding arguments to IsRelativeURL and
+// ResolveRelativeURL.
+GURL_API void InitRelativeBase(const char* base,
+                               const url_parse::Parsed& base_parsed,
+                               bool is_base_hierarchical,
+                               bool base_is_file,
+                               RelativeBase* relative_base);
+
 // Given an input URL or URL fragment |fragment|, determines if it is a
 // relative or absolute URL and places the result into |*is_relative|. If it is
 // relative, the relevant portion of the URL will be placed into
@@ -876,6 +1123,18 @@ GURL_API bool IsRelativeURL(const char* base,
                             bool* is_relative,
                             url_parse::Component* relative_component);
 
+// Same as above for a base prepared with InitRelativeBase.
+GURL_API bool IsRelativeURL(const RelativeBase& base,
+                            const char* fragment,
+                            int fragment_len,
+                            bool* is_relative,
+                            url_parse::Component* relative_component);
+GURL_API bool IsRelativeURL(const RelativeBase& base,
+                            const char16* fragment,
+                            int fragment_len,
+                            bool* is_relative,
+                            url_parse::Component* relative_component);
+
 // Given a canonical parsed source URL, a URL fragment known to be relative,
 // and the identified relevant portion of the relative URL (computed by
 // IsRelativeURL), this produces a new parsed canonical URL in |output| and
@@ -911,6 +1170,20 @@ GURL_API bool ResolveRelativeURL(const char* base_url,
                                  CanonOutput* output,
                                  url_parse::Parsed* out_parsed);
 
+// Same as above for a base prepared with InitRelativeBase.
+GURL_API bool ResolveRelativeURL(const RelativeBase& base,
+                                 const char* relative_url,
+                                 const url_parse::Component& relative_component,
+                                 CharsetConverter* query_converter,
+                                 CanonOutput* output,
+                                 url_parse::Parsed* out_parsed);
+GURL_API bool ResolveRelativeURL(const RelativeBase& base,
+                                 const char16* relative_url,
+                                 const url_parse::Component& relative_component,
+                                 CharsetConverter* query_converter,
+                                 CanonOutput* output,
+                                 url_parse::Parsed* out_parsed);
+
 }  // namespace url_canon
 
 #endif  // GOOGLEURL_SRC_URL_CANON_H__
@@ -0,0 +1,127 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "googleurl/src/url_canon_arena.h"
+
+namespace url_canon {
+
+namespace {
+
+// Alignment of every allocation, enough for char16 and wider types.
+const size_t kArenaAlignment = 8;
+
+inline size_t AlignUp(size_t bytes) {
+  return (bytes + kArenaAlignment - 1) & ~(kArenaAlignment - 1);
+}
+
+}  // namespace
+
+CanonArena::CanonArena(size_t block_size)
+    : blocks_(NULL),
+      pos_(NULL),
+      end_(NULL),
+      last_(NULL),
+      block_size_(block_size > 0 ? block_size : 1),
+      bytes_allocated_(0) {
+}
+
+CanonArena::~CanonArena() {
+  while (blocks_) {
+    Block* next = blocks_->next;
+    delete[] reinterpret_cast<char*>(blocks_);
+    blocks_ = next;
+  }
+}
+
+void* CanonArena::Allocate(size_t bytes) {
+  bytes = AlignUp(bytes);
+  if (bytes > static_cast<size_t>(end_ - pos_))
+    AddBlock(bytes);
+  last_ = pos_;
+  pos_ += bytes;
+  bytes_allocated_ += bytes;
+  return last_;
+}
+
+bool CanonArena::Extend(void* ptr, size_t old_bytes, size_t new_bytes) {
+  old_bytes = AlignUp(old_bytes);
+  new_bytes = AlignUp(new_bytes);
+  if (ptr == NULL || ptr != last_ || last_ + old_bytes != pos_)
+    return false;
+  if (new_bytes > old_bytes &&
+      new_bytes - old_bytes > static_cast<size_t>(end_ - pos_))
+    return false;
+  pos_ = last_ + new_bytes;
+  bytes_allocated_ = bytes_allocated_ - old_bytes + new_bytes;
+  return true;
+}
+
+void CanonArena::Reset() {
+  // Keep only the largest block. Since blocks at least double, it holds about
+  // half of what was used, and the next block added will hold the rest.
+  Block* largest = blocks_;
+  for (Block* block = blocks_; block; block = block->next) {
+    if (block->size > largest->size)
+      largest = block;
+  }
+  while (blocks_) {
+    Block* next = blocks_->next;
+    if (blocks_ != largest)
+      delete[] reinterpret_cast<char*>(blocks_);
+    blocks_ = next;
+  }
+
+  blocks_ = largest;
+  if (blocks_) {
+    blocks_->next = NULL;
+    pos_ = reinterpret_cast<char*>(blocks_) + AlignUp(sizeof(Block));
+    end_ = pos_ + blocks_->size;
+  } else {
+    pos_ = end_ = NULL;
+  }
+  last_ = NULL;
+  bytes_allocated_ = 0;
+}
+
+void CanonArena::AddBlock(size_t bytes) {
+  size_t size = blocks_ ? blocks_->size * 2 : block_size_;
+  if (size < bytes)
+    size = bytes;
+  size = AlignUp(size);
+
+  Block* block = reinterpret_cast<Block*>(
+      new char[AlignUp(sizeof(Block)) + size]);
+  block->next = blocks_;
+  block->size = size;
+  blocks_ = block;
+  pos_ = reinterpret_cast<char*>(block) + AlignUp(sizeof(Block));
+  end_ = pos_ + size;
+}
+
+}  // namespace url_canon
@@ -0,0 +1,155 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// A canonicalizer output that spills into a caller-owned bump arena rather
+// than the global heap, for servers that canonicalize many long URLs per
+// request and can free the memory all at once when the request is done.
+
+#ifndef GOOGLEURL_SRC_URL_CANON_ARENA_H__
+#define GOOGLEURL_SRC_URL_CANON_ARENA_H__
+
+#include <stddef.h>
+#include <string.h>
+
+#include "googleurl/src/url_canon.h"
+#include "googleurl/src/url_common.h"
+
+namespace url_canon {
+
+// Hands out memory from large blocks, freeing nothing until Reset(). Not
+// thread safe: use one arena per request or per thread.
+//
+// Blocks are taken from the heap as needed, each at least twice the size of
+// the one before. Reset() keeps the largest of them for reuse, so once an
+// arena has seen a typical request it no longer touches the heap.
+class GURL_API CanonArena {
+ public:
+  // |block_size| is the size of the first block, allocated lazily.
+  explicit CanonArena(size_t block_size = 16384);
+  ~CanonArena();
+
+  // Returns |bytes| of memory aligned for any of the canonicalizer's
+  // character types, valid until the next Reset() or destruction.
+  void* Allocate(size_t bytes);
+
+  // Grows or shrinks the allocation at |ptr| of |old_bytes| to |new_bytes|
+  // without moving it. This is only possible for the most recent allocation
+  // and when the current block has room; returns false otherwise, in which
+  // case nothing has changed.
+  bool Extend(void* ptr, size_t old_bytes, size_t new_bytes);
+
+  // Releases everything allocated from the arena at once.
+  void Reset();
+
+  // Bytes handed out since the last Reset().
+  size_t bytes_allocated() const { return bytes_allocated_; }
+
+ private:
+  struct Block {
+    Block* next;
+    size_t size;  // Usable bytes following the header.
+  };
+
+  // Starts a new block with room for at least |bytes|.
+  void AddBlock(size_t bytes);
+
+  // Most recently added block first.
+  Block* blocks_;
+
+  // Free space in the first block.
+  char* pos_;
+  char* end_;
+
+  // The allocation that Extend() can grow, NULL if none.
+  char* last_;
+
+  size_t block_size_;
+  size_t bytes_allocated_;
+
+  // Not copyable, the blocks are owned.
+  CanonArena(const CanonArena&);
+  void operator=(const CanonArena&);
+};
+
+// Like RawCanonOutputT, an output with a fixed buffer that avoids allocating
+// for most URLs, but whose spills come from |arena|. The arena must outlive
+// the output; the spilled memory is only given back by resetting the arena.
+template<typename T, int fixed_capacity = 1024>
+class ArenaCanonOutputT : public CanonOutputT<T> {
+ public:
+  explicit ArenaCanonOutputT(CanonArena* arena)
+      : CanonOutputT<T>(),
+        arena_(arena) {
+    this->buffer_ = fixed_buffer_;
+    this->buffer_len_ = fixed_capacity;
+  }
+  virtual ~ArenaCanonOutputT() {
+    // Nothing to do, the arena owns any spilled buffer.
+  }
+
+  virtual void Resize(int sz) {
+    if (this->buffer_ != fixed_buffer_ &&
+        arena_->Extend(this->buffer_, sizeof(T) * this->buffer_len_,
+                       sizeof(T) * sz)) {
+      this->buffer_len_ = sz;
+      return;
+    }
+
+    if (this->buffer_ == fixed_buffer_)
+      CANON_STAT_INCREMENT(fixed_buffer_spills);
+    T* new_buf = static_cast<T*>(arena_->Allocate(sizeof(T) * sz));
+    memcpy(new_buf, this->buffer_,
+           sizeof(T) * (this->cur_len_ < sz ? this->cur_len_ : sz));
+    this->buffer_ = new_buf;
+    this->buffer_len_ = sz;
+  }
+
+ protected:
+  CanonArena* arena_;
+  T fixed_buffer_[fixed_capacity];
+};
+
+template<int fixed_capacity>
+class ArenaCanonOutput : public ArenaCanonOutputT<char, fixed_capacity> {
+ public:
+  explicit ArenaCanonOutput(CanonArena* arena)
+      : ArenaCanonOutputT<char, fixed_capacity>(arena) {
+  }
+};
+template<int fixed_capacity>
+class ArenaCanonOutputW : public ArenaCanonOutputT<char16, fixed_capacity> {
+ public:
+  explicit ArenaCanonOutputW(CanonArena* arena)
+      : ArenaCanonOutputT<char16, fixed_capacity>(arena) {
+  }
+};
+
+}  // namespace url_canon
+
+#endif  // GOOGLEURL_SRC_URL_CANON_ARENA_H__
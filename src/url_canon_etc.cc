@@ -33,6 +33,7 @@
 
 #include "googleurl/src/url_canon.h"
 #include "googleurl/src/url_canon_internal.h"
+#include "googleurl/src/url_canon_simd.h"
 
 namespace url_canon {
 
@@ -53,24 +54,20 @@ const CHAR* DoRemoveURLWhitespace(const CHAR* input, int input_len,
                                   int* output_len) {
   // Fast verification that there's nothing that needs removal. This is the 99%
   // case, so we want it to be fast and don't care about impacting the speed
-  // when we do find whitespace.
-  int found_whitespace = false;
-  for (int i = 0; i < input_len; i++) {
-    if (!IsRemovableURLWhitespace(input[i]))
-      continue;
-    found_whitespace = true;
-    break;
-  }
-
-  if (!found_whitespace) {
+  // when we do find whitespace. The scan is vectorized where possible.
+  int first_whitespace = FindRemovableURLWhitespace(input, input_len);
+  if (first_whitespace == input_len) {
     // Didn't find any whitespace, we don't need to do anything. We can just
     // return the input as the output.
     *output_len = input_len;
     return input;
   }
 
-  // Remove the whitespace into the new buffer and return it.
-  for (int i = 0; i < input_len; i++) {
+  // Everything before the first whitespace can be copied as a block. Remove
+  // the rest of the whitespace into the new buffer and return it.
+  CANON_STAT_INCREMENT(whitespace_copies);
+  buffer->Append(input, first_whitespace);
+  for (int i = first_whitespace + 1; i < input_len; i++) {
     if (!IsRemovableURLWhitespace(input[i]))
       buffer->push_back(input[i]);
   }
@@ -282,8 +279,14 @@ void DoCanonicalizeRef(const CHAR* spec,
       // shouldn't be using control characters in their anchor names.
       AppendEscapedChar(static_cast<unsigned char>(spec[i]), output);
     } else if (static_cast<UCHAR>(spec[i]) < 0x80) {
-      // Normal ASCII characters are just appended.
-      output->push_back(static_cast<char>(spec[i]));
+      // Normal ASCII characters are just appended, as one block for a run of
+      // them.
+      int run_end = i + 1;
+      while (run_end < end && static_cast<UCHAR>(spec[run_end]) >= 0x20 &&
+             static_cast<UCHAR>(spec[run_end]) < 0x80)
+        run_end++;
+      AppendASCIIRun(&spec[i], run_end - i, output);
+      i = run_end - 1;
     } else {
       // Non-ASCII characters are appended unescaped, but only when they are
       // valid. Invalid Unicode characters are replaced with the "invalid
@@ -389,4 +392,67 @@ void CanonicalizeRef(const char16* spec,
   DoCanonicalizeRef<char16, char16>(spec, ref, output, out_ref);
 }
 
+bool IsCanonicalScheme(const char* spec, const url_parse::Component& scheme) {
+  if (scheme.len <= 0)
+    return false;
+  if (!IsSchemeFirstChar(static_cast<unsigned char>(spec[scheme.begin])))
+    return false;
+  int end = scheme.end();
+  for (int i = scheme.begin; i < end; i++) {
+    unsigned char ch = static_cast<unsigned char>(spec[i]);
+    if (ch >= 0x80 || kSchemeCanonical[ch] != ch)
+      return false;
+  }
+  return true;
+}
+
+bool IsCanonicalUserInfo(const char* spec,
+                         const url_parse::Component& username,
+                         const url_parse::Component& password) {
+  // An empty but present password loses its colon, and user info that is
+  // empty altogether loses its "@".
+  if (password.is_valid() && password.len == 0)
+    return false;
+  if (username.len <= 0 && password.len <= 0)
+    return false;
+
+  const url_parse::Component* components[2] = { &username, &password };
+  for (int c = 0; c < 2; c++) {
+    int end = components[c]->end();
+    for (int i = components[c]->begin; i < end; i++) {
+      unsigned char ch = static_cast<unsigned char>(spec[i]);
+      if (ch >= 0x80 || !IsCharOfType(ch, CHAR_USERINFO))
+        return false;
+    }
+  }
+  return true;
+}
+
+bool IsCanonicalPort(const char* spec,
+                     const url_parse::Component& port,
+                     int default_port) {
+  int port_num = url_parse::ParsePort(spec, port);
+  if (port_num == url_parse::PORT_UNSPECIFIED ||
+      port_num == url_parse::PORT_INVALID ||
+      port_num == default_port)
+    return false;
+
+  // The canonical form has no leading zeros, which is the only way a valid
+  // port's digits can differ from what DoPort writes.
+  return port.len == 1 || spec[port.begin] != '0';
+}
+
+bool IsCanonicalRef(const char* spec, const url_parse::Component& ref) {
+  // Control characters are escaped or stripped. Non-ASCII characters are
+  // only copied when they are valid UTF-8, which we leave to the
+  // canonicalizer to decide.
+  int end = ref.end();
+  for (int i = ref.begin; i < end; i++) {
+    unsigned char ch = static_cast<unsigned char>(spec[i]);
+    if (ch < 0x20 || ch >= 0x80)
+      return false;
+  }
+  return true;
+}
+
 }  // namespace url_canon
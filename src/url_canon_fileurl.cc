@@ -169,6 +169,54 @@ bool CanonicalizeFileURL(const char16* spec,
       output, new_parsed);
 }
 
+bool IsCanonicalFileURL(const char* spec,
+                        int spec_len,
+                        const url_parse::Parsed& parsed) {
+  // DoCanonicalizeFileURL writes the scheme as "file://" and drops any user
+  // info or port.
+  if (parsed.scheme.begin != 0 || parsed.scheme.len != 4 ||
+      spec_len < 7 || strncmp(spec, "file://", 7) != 0 ||
+      parsed.username.is_valid() || parsed.password.is_valid() ||
+      parsed.port.is_valid())
+    return false;
+  int cur = 7;
+
+  if (parsed.host.is_valid()) {
+    if (parsed.host.begin != cur || !IsCanonicalHost(spec, parsed.host))
+      return false;
+    cur = parsed.host.end();
+  }
+
+  if (parsed.path.begin != cur || !IsCanonicalPath(spec, parsed.path))
+    return false;
+#ifdef WIN32
+  // Leave drive letter normalization to FileDoDriveSpec.
+  if (url_parse::DoesBeginWindowsDriveSpec(
+          spec, cur + url_parse::CountConsecutiveSlashes(spec, cur,
+                                                         parsed.path.end()),
+          parsed.path.end()))
+    return false;
+#endif
+  cur = parsed.path.end();
+
+  if (parsed.query.is_valid()) {
+    if (parsed.query.begin != cur + 1 || spec[cur] != '?' ||
+        !IsCanonicalQuery(spec, parsed.query))
+      return false;
+    cur = parsed.query.end();
+  }
+
+  if (parsed.ref.is_valid()) {
+    if (parsed.ref.begin != cur + 1 || spec[cur] != '#' ||
+        !IsCanonicalRef(spec, parsed.ref))
+      return false;
+    cur = parsed.ref.end();
+  }
+
+  // Anything left over was trimmed by the parser.
+  return cur == spec_len;
+}
+
 bool FileCanonicalizePath(const char* spec,
                           const url_parse::Component& path,
                           CanonOutput* output,
@@ -27,9 +27,16 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <atomic>
+#include <string>
+#include <vector>
+
 #include "googleurl/base/logging.h"
 #include "googleurl/src/url_canon.h"
 #include "googleurl/src/url_canon_internal.h"
+#include "googleurl/src/url_canon_ip.h"
+#include "googleurl/src/url_canon_sampler.h"
+#include "googleurl/src/url_canon_simd.h"
 
 namespace url_canon {
 
@@ -144,6 +151,29 @@ bool DoSimpleHost(const INCHAR* host,
   bool success = true;
   for (int i = 0; i < host_len; ++i) {
     unsigned int source = host[i];
+    if (source < 0x80 && kHostCharLookup[source] &&
+        kHostCharLookup[source] != kEsc) {
+      // Common case, the given character is valid in a hostname. Write it
+      // and the rest of the run of such characters straight into the output
+      // with their canonical representation (lower cased) from the lookup
+      // table. Note that percent signs stop the run since their entry is 0.
+      OUTCHAR* dest = output->ReserveSpan(host_len - i);
+      if (!dest)
+        return false;
+      int run_len = 0;
+      do {
+        dest[run_len] = kHostCharLookup[source];
+        run_len++;
+        if (i + run_len == host_len)
+          break;
+        source = host[i + run_len];
+      } while (source < 0x80 && kHostCharLookup[source] &&
+               kHostCharLookup[source] != kEsc);
+      output->CommitSpan(run_len);
+      i += run_len - 1;
+      continue;
+    }
+
     if (source == '%') {
       // Unescape first, if possible.
       // Source will be used only if decode operation was successful.
@@ -195,9 +225,14 @@ bool DoIDNHost(const char16* src, int src_len, CanonOutput* output) {
   DoSimpleHost(src, src_len, &url_escaped_host, &has_non_ascii);
 
   StackBufferW wide_output;
-  if (!IDNToASCII(url_escaped_host.data(),
-                  url_escaped_host.length(),
-                  &wide_output)) {
+  bool converted;
+  {
+    CANON_STAT_INCREMENT(idn_conversions);
+    CANON_STAT_SCOPED_TIMER(idn_ns);
+    converted = IDNToASCII(url_escaped_host.data(), url_escaped_host.length(),
+                           &wide_output);
+  }
+  if (!converted) {
     // Some error, give up. This will write some reasonable looking
     // representation of the string to the output.
     AppendInvalidNarrowString(src, 0, src_len, output);
@@ -310,6 +345,130 @@ bool DoComplexHost(const char16* host, int host_len,
   return DoIDNHost(host, host_len, output);
 }
 
+// IDN host cache --------------------------------------------------------------
+
+// Capacity requested with SetIDNHostCacheCapacity, 0 meaning disabled.
+std::atomic<int> idn_host_cache_capacity(0);
+
+std::atomic<unsigned long long> idn_host_cache_hits(0);
+std::atomic<unsigned long long> idn_host_cache_misses(0);
+
+// A set-associative cache: the hash of a host selects a set of kWays entries,
+// and within a set the least recently used entry is replaced. This bounds the
+// work per lookup and, once the entries' strings have grown to size, avoids
+// any allocation on either hits or replacements.
+class IDNHostCache {
+ public:
+  static const int kWays = 4;
+
+  explicit IDNHostCache(int capacity) : capacity_(capacity), clock_(0) {
+    int num_sets = 1;
+    while (num_sets * kWays < capacity)
+      num_sets *= 2;
+    set_mask_ = num_sets - 1;
+    entries_.resize(num_sets * kWays);
+  }
+
+  int capacity() const { return capacity_; }
+
+  // Appends the cached canonical form of |host| to |output| and fills in
+  // |host_info| (with out_host relative to the start of the appended text).
+  // Returns false if the host isn't cached.
+  template<typename CHAR>
+  bool Lookup(const CHAR* host, int host_len, CanonOutput* output,
+              CanonHostInfo* host_info) {
+    const char* key = reinterpret_cast<const char*>(host);
+    size_t key_len = host_len * sizeof(CHAR);
+    unsigned hash = Hash(key, key_len, sizeof(CHAR));
+    Entry* set = &entries_[(hash & set_mask_) * kWays];
+    for (int i = 0; i < kWays; i++) {
+      Entry& entry = set[i];
+      if (entry.last_used && entry.hash == hash &&
+          entry.char_size == sizeof(CHAR) && entry.key.size() == key_len &&
+          memcmp(entry.key.data(), key, key_len) == 0) {
+        entry.last_used = ++clock_;
+        int begin = output->length();
+        output->Append(entry.canonical.data(),
+                       static_cast<int>(entry.canonical.size()));
+        *host_info = entry.info;
+        host_info->out_host = url_parse::MakeRange(begin, output->length());
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Remembers that |host| canonicalizes to |canonical| with |host_info|.
+  template<typename CHAR>
+  void Store(const CHAR* host, int host_len,
+             const char* canonical, int canonical_len,
+             const CanonHostInfo& host_info) {
+    const char* key = reinterpret_cast<const char*>(host);
+    size_t key_len = host_len * sizeof(CHAR);
+    unsigned hash = Hash(key, key_len, sizeof(CHAR));
+    Entry* set = &entries_[(hash & set_mask_) * kWays];
+    Entry* victim = &set[0];
+    for (int i = 1; i < kWays; i++) {
+      if (set[i].last_used < victim->last_used)
+        victim = &set[i];
+    }
+
+    victim->hash = hash;
+    victim->char_size = sizeof(CHAR);
+    victim->key.assign(key, key_len);
+    victim->canonical.assign(canonical, canonical_len);
+    victim->info = host_info;
+    victim->last_used = ++clock_;
+  }
+
+ private:
+  struct Entry {
+    Entry() : hash(0), char_size(0), last_used(0) {}
+
+    unsigned hash;
+    unsigned char char_size;  // sizeof the input characters.
+    std::string key;  // The raw input characters, as bytes.
+    std::string canonical;
+    CanonHostInfo info;
+    unsigned long long last_used;  // 0 for an empty entry.
+  };
+
+  // FNV-1a over the key bytes, seeded with the character size so the 8-bit
+  // and 16-bit versions of a host land in different places.
+  static unsigned Hash(const char* key, size_t key_len, size_t char_size) {
+    unsigned hash = 2166136261u ^ static_cast<unsigned>(char_size);
+    for (size_t i = 0; i < key_len; i++)
+      hash = (hash ^ static_cast<unsigned char>(key[i])) * 16777619u;
+    return hash;
+  }
+
+  int capacity_;
+  unsigned set_mask_;
+  unsigned long long clock_;
+  std::vector<Entry> entries_;
+};
+
+// Owns a thread's host cache so it is freed when the thread exits.
+struct IDNHostCacheHolder {
+  IDNHostCacheHolder() : cache(NULL) {}
+  ~IDNHostCacheHolder() { delete cache; }
+
+  IDNHostCache* cache;
+};
+thread_local IDNHostCacheHolder idn_host_cache;
+
+// Returns the calling thread's host cache, or NULL if caching is disabled.
+IDNHostCache* GetIDNHostCache() {
+  int capacity = idn_host_cache_capacity.load(std::memory_order_relaxed);
+  IDNHostCache* cache = idn_host_cache.cache;
+  if (cache ? cache->capacity() != capacity : capacity > 0) {
+    delete cache;
+    cache = capacity > 0 ? new IDNHostCache(capacity) : NULL;
+    idn_host_cache.cache = cache;
+  }
+  return cache;
+}
+
 template<typename CHAR, typename UCHAR>
 void DoHost(const CHAR* spec,
             const url_parse::Component& host,
@@ -322,18 +481,50 @@ void DoHost(const CHAR* spec,
     return;
   }
 
-  bool has_non_ascii, has_escaped;
-  ScanHostname<CHAR, UCHAR>(spec, host, &has_non_ascii, &has_escaped);
-
   // Keep track of output's initial length, so we can rewind later.
   const int output_begin = output->length();
 
-  bool success;
+  // Most hosts are entirely made of characters that only need lowercasing.
+  // Copy the leading run of them in one vectorized pass, so that only what
+  // follows it, usually nothing, has to be scanned and canonicalized.
+  int simple_len = 0;
+  if (char* dest = output->ReserveSpan(host.len)) {
+    simple_len = LowerSimpleHostChars(&spec[host.begin], host.len, dest);
+    output->CommitSpan(simple_len);
+  }
+  url_parse::Component rest(host.begin + simple_len, host.len - simple_len);
+
+  bool has_non_ascii = false, has_escaped = false;
+  if (rest.len > 0)
+    ScanHostname<CHAR, UCHAR>(spec, rest, &has_non_ascii, &has_escaped);
+
+  // Only the hosts that need unescaping or IDN are worth caching. Those are
+  // canonicalized from their beginning again.
+  IDNHostCache* cache = NULL;
+  if (has_non_ascii || has_escaped) {
+    output->set_length(output_begin);
+    if (has_non_ascii)
+      NoteSlowURLPath(SLOW_URL_IDN);
+    cache = GetIDNHostCache();
+    if (cache) {
+      if (cache->Lookup(&spec[host.begin], host.len, output, host_info)) {
+        idn_host_cache_hits.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      idn_host_cache_misses.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  bool success = true;
   if (!has_non_ascii && !has_escaped) {
-    success = DoSimpleHost(&spec[host.begin], host.len,
-                           output, &has_non_ascii);
-    DCHECK(!has_non_ascii);
+    if (rest.len > 0) {
+      success = DoSimpleHost(&spec[rest.begin], rest.len,
+                             output, &has_non_ascii);
+      DCHECK(!has_non_ascii);
+    }
   } else {
+    CANON_STAT_INCREMENT(complex_hosts);
+    CANON_STAT_SCOPED_TIMER(complex_host_ns);
     success = DoComplexHost(&spec[host.begin], host.len,
                             has_non_ascii, has_escaped, output);
   }
@@ -360,6 +551,11 @@ void DoHost(const CHAR* spec,
   }
 
   host_info->out_host = url_parse::MakeRange(output_begin, output->length());
+
+  if (cache) {
+    cache->Store(&spec[host.begin], host.len, &output->data()[output_begin],
+                 output->length() - output_begin, *host_info);
+  }
 }
 
 }  // namespace
@@ -398,4 +594,71 @@ void CanonicalizeHostVerbose(const char16* spec,
   DoHost<char16, char16>(spec, host, output, host_info);
 }
 
+bool IsCanonicalHost(const char* spec, const url_parse::Component& host) {
+  if (host.len <= 0)
+    return false;
+
+  // Every character must map to itself in DoSimpleHost. That rules out the
+  // disallowed and escaped characters, whose entries are 0 and kEsc, and
+  // which must be checked explicitly since a NUL would otherwise match its 0
+  // entry. The brackets and colon only appear in IPv6 literals, which we
+  // don't try to validate.
+  bool all_ipv4_chars = true;
+  int end = host.end();
+  for (int i = host.begin; i < end; i++) {
+    unsigned char ch = static_cast<unsigned char>(spec[i]);
+    if (ch >= 0x80 || kHostCharLookup[ch] == 0 ||
+        kHostCharLookup[ch] == kEsc || kHostCharLookup[ch] != ch ||
+        ch == '[' || ch == ']' || ch == ':')
+      return false;
+    all_ipv4_chars &= IsIPv4Char(ch);
+  }
+
+  // A host made of only IPv4 characters may be rewritten as an IPv4 address
+  // (or rejected as a broken one). The canonical form of an address is four
+  // decimal components without leading zeros, which is the only way to write
+  // one with four components containing nothing but digits.
+  if (!all_ipv4_chars)
+    return true;
+  unsigned char address[4];
+  int num_ipv4_components;
+  switch (IPv4AddressToNumber(spec, host, address, &num_ipv4_components)) {
+    case CanonHostInfo::NEUTRAL:
+      return true;
+    case CanonHostInfo::IPV4:
+      break;
+    default:
+      return false;
+  }
+  if (num_ipv4_components != 4 || spec[end - 1] == '.')
+    return false;
+  for (int i = host.begin; i < end; i++) {
+    if (spec[i] == '.')
+      continue;
+    if (spec[i] < '0' || spec[i] > '9')
+      return false;  // Hex.
+    if (spec[i] == '0' && (i == host.begin || spec[i - 1] == '.') &&
+        i + 1 < end && spec[i + 1] != '.')
+      return false;  // Leading zero, meaning octal.
+  }
+  return true;
+}
+
+void SetIDNHostCacheCapacity(int max_entries) {
+  idn_host_cache_capacity.store(max_entries > 0 ? max_entries : 0,
+                                std::memory_order_relaxed);
+}
+
+IDNHostCacheStats GetIDNHostCacheStats() {
+  IDNHostCacheStats stats;
+  stats.hits = idn_host_cache_hits.load(std::memory_order_relaxed);
+  stats.misses = idn_host_cache_misses.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void ResetIDNHostCacheStats() {
+  idn_host_cache_hits.store(0, std::memory_order_relaxed);
+  idn_host_cache_misses.store(0, std::memory_order_relaxed);
+}
+
 }  // namespace url_canon
@@ -31,6 +31,8 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <string>
+#include <vector>
 #include <unicode/ucnv.h>
 #include <unicode/ucnv_cb.h>
 #include <unicode/uidna.h>
@@ -58,19 +60,22 @@ void appendURLEscapedChar(const void* context,
   if (reason == UCNV_UNASSIGNED) {
     *err = U_ZERO_ERROR;
 
+    // The escape is written in one call. When the output is full, ICU saves
+    // what is written in its overflow buffer and reports the overflow, after
+    // which further writes from the callback would be dropped.
     const static int prefix_len = 6;
     const static char prefix[prefix_len + 1] = "%26%23";  // "&#" percent-escaped
-    ucnv_cbFromUWriteBytes(from_args, prefix, prefix_len, 0, err);
-
-    DCHECK(code_point < 0x110000);
-    char number[8];  // Max Unicode code point is 7 digits.
-    _itoa_s(code_point, number, 10);
-    int number_len = static_cast<int>(strlen(number));
-    ucnv_cbFromUWriteBytes(from_args, number, number_len, 0, err);
-
     const static int postfix_len = 3;
     const static char postfix[postfix_len + 1] = "%3B";   // ";" percent-escaped
-    ucnv_cbFromUWriteBytes(from_args, postfix, postfix_len, 0, err);
+
+    DCHECK(code_point < 0x110000);
+    char escape[prefix_len + 8 + postfix_len];  // Max code point is 7 digits.
+    memcpy(escape, prefix, prefix_len);
+    _itoa_s(code_point, &escape[prefix_len], 8, 10);
+    int escape_len = prefix_len + static_cast<int>(strlen(&escape[prefix_len]));
+    memcpy(&escape[escape_len], postfix, postfix_len);
+    escape_len += postfix_len;
+    ucnv_cbFromUWriteBytes(from_args, escape, escape_len, 0, err);
   }
 }
 
@@ -97,114 +102,243 @@ class AppendHandlerInstaller {
   const void* old_context_;
 };
 
-}  // namespace
-
-ICUCharsetConverter::ICUCharsetConverter(UConverter* converter)
-    : converter_(converter) {
-}
-
-ICUCharsetConverter::~ICUCharsetConverter() {
-}
-
-void ICUCharsetConverter::ConvertFromUTF16(const char16* input,
-                                           int input_len,
-                                           CanonOutput* output) {
-  // Install our error handler. It will be called for character that can not
-  // be represented in the destination character set.
-  AppendHandlerInstaller handler(converter_);
-
+// Converts UTF-16 input with the given converter, which must already have the
+// appendURLEscapedChar callback installed.
+void ConvertFromUTF16WithICU(UConverter* converter,
+                             const char16* input,
+                             int input_len,
+                             CanonOutput* output) {
   int begin_offset = output->length();
   int dest_capacity = output->capacity() - begin_offset;
-  output->set_length(output->length());
 
   do {
     UErrorCode err = U_ZERO_ERROR;
     char* dest = &output->data()[begin_offset];
-    int required_capacity = ucnv_fromUChars(converter_, dest, dest_capacity,
+    int required_capacity = ucnv_fromUChars(converter, dest, dest_capacity,
                                             input, input_len, &err);
     if (err != U_BUFFER_OVERFLOW_ERROR) {
       output->set_length(begin_offset + required_capacity);
       return;
     }
 
-    // Output didn't fit, expand
-    dest_capacity = required_capacity;
-    output->Resize(begin_offset + dest_capacity);
+    // Output didn't fit, expand. This fails once the output is at its
+    // max_capacity(), which marks it truncated.
+    if (!output->ReserveSpan(required_capacity))
+      return;
+    dest_capacity = output->capacity() - begin_offset;
   } while (true);
 }
 
-// Converts the Unicode input representing a hostname to ASCII using IDN rules.
-// The output must be ASCII, but is represented as wide characters.
-//
-// On success, the output will be filled with the ASCII host name and it will
-// return true. Unlike most other canonicalization functions, this assumes that
-// the output is empty. The beginning of the host will be at offset 0, and
-// the length of the output will be set to the length of the new host name.
-//
-// On error, this will return false. The output in this case is undefined.
-bool IDNToASCII(const char16* src, int src_len, CanonOutputW* output) {
-  DCHECK(output->length() == 0);  // Output buffer is assumed empty.
-  while (true) {
-    // Use ALLOW_UNASSIGNED to be more tolerant of hostnames that violate
-    // the spec (which do exist). This does not present any risk and is a
-    // little more future proof.
+// The same for UTF-8 input, read by |utf8_converter|. ICU converts through a
+// UTF-16 pivot; a stack buffer is enough for it since it is refilled as the
+// input is consumed.
+void ConvertFromUTF8WithICU(UConverter* utf8_converter,
+                            UConverter* converter,
+                            const char* input,
+                            int input_len,
+                            CanonOutput* output) {
+  UChar pivot[256];
+  UChar* pivot_source = pivot;
+  UChar* pivot_target = pivot;
+  const char* source = input;
+  bool reset = true;
+
+  do {
+    // Growing fails once the output is at its max_capacity(), which marks it
+    // truncated.
+    if (output->length() == output->capacity() && !output->ReserveSpan(1))
+      return;
+
     UErrorCode err = U_ZERO_ERROR;
-    int num_converted = uidna_IDNToASCII(src, src_len, output->data(),
-                                         output->capacity(),
-                                         UIDNA_ALLOW_UNASSIGNED, NULL, &err);
-    if (err == U_ZERO_ERROR) {
-      output->set_length(num_converted);
-      return true;
-    }
+    char* dest_begin = &output->data()[output->length()];
+    char* dest = dest_begin;
+    ucnv_convertEx(converter, utf8_converter,
+                   &dest, &output->data()[output->capacity()],
+                   &source, input + input_len,
+                   pivot, &pivot_source, &pivot_target,
+                   pivot + arraysize(pivot), reset, true, &err);
+    output->set_length(output->length() + static_cast<int>(dest - dest_begin));
     if (err != U_BUFFER_OVERFLOW_ERROR)
-      return false;  // Unknown error, give up.
+      return;
+
+    // Output didn't fit; expand and carry on from where the conversion stopped.
+    reset = false;
+    if (!output->ReserveSpan(output->capacity() - output->length() + 1))
+      return;
+  } while (true);
+}
+
+// A converter from a thread's pool, see GetThreadCharsetConverter.
+class PooledCharsetConverter : public CharsetConverter {
+ public:
+  // Takes ownership of |converter| and installs the escaping callback on it.
+  PooledCharsetConverter(const char* charset_name, UConverter* converter,
+                         UConverter* utf8_converter)
+      : charset_name_(charset_name),
+        converter_(converter),
+        utf8_converter_(utf8_converter) {
+    UErrorCode err = U_ZERO_ERROR;
+    ucnv_setFromUCallBack(converter_, appendURLEscapedChar, 0, NULL, NULL,
+                          &err);
+  }
+
+  virtual ~PooledCharsetConverter() {
+    ucnv_close(converter_);
+  }
+
+  const std::string& charset_name() const {
+    return charset_name_;
+  }
+
+  virtual void ConvertFromUTF16(const char16* input, int input_len,
+                                CanonOutput* output) {
+    ConvertFromUTF16WithICU(converter_, input, input_len, output);
+  }
 
-    // Not enough room in our buffer, expand.
-    output->Resize(output->capacity() * 2);
+  virtual void ConvertFromUTF8(const char* input, int input_len,
+                               CanonOutput* output) {
+    ConvertFromUTF8WithICU(utf8_converter_, converter_, input, input_len,
+                           output);
   }
+
+ private:
+  std::string charset_name_;  // As passed to GetThreadCharsetConverter.
+  UConverter* converter_;
+  UConverter* utf8_converter_;  // Owned by the pool.
+};
+
+// The converters of one thread. The UTF-8 converter reads the input of every
+// direct UTF-8 conversion on the thread.
+struct ConverterPool {
+  ConverterPool() : utf8_converter(NULL) {}
+  ~ConverterPool() {
+    for (size_t i = 0; i < converters.size(); i++)
+      delete converters[i];
+    if (utf8_converter)
+      ucnv_close(utf8_converter);
+  }
+
+  UConverter* GetUTF8Converter() {
+    if (!utf8_converter) {
+      UErrorCode err = U_ZERO_ERROR;
+      utf8_converter = ucnv_open("UTF-8", &err);
+      DCHECK(U_SUCCESS(err));
+    }
+    return utf8_converter;
+  }
+
+  UConverter* utf8_converter;
+
+  // Few threads use more than a couple of encodings, so a linear search is
+  // the fastest lookup.
+  std::vector<PooledCharsetConverter*> converters;
+};
+thread_local ConverterPool converter_pool;
+
+// UTS #46 processing reports some problems that the IDNA 2003 conversion we
+// used previously accepted (we never turned on its STD3 rules). These are only
+// validity checks on the result, which is well-formed regardless, so tolerate
+// them to keep accepting the same hosts.
+const uint32_t kIgnoredIDNAErrors = UIDNA_ERROR_LEADING_HYPHEN |
+                                    UIDNA_ERROR_TRAILING_HYPHEN |
+                                    UIDNA_ERROR_HYPHEN_3_4 |
+                                    UIDNA_ERROR_DOMAIN_NAME_TOO_LONG;
+
+// Returns the process-wide UTS #46 converter. It is opened on first use and
+// intentionally never closed. ICU allows one UIDNA to be used from any number
+// of threads at once.
+const UIDNA* GetUIDNA() {
+  static const UIDNA* uidna = []() {
+    UErrorCode err = U_ZERO_ERROR;
+    UIDNA* result = uidna_openUTS46(UIDNA_CHECK_BIDI, &err);
+    DCHECK(U_SUCCESS(err));
+    return result;
+  }();
+  return uidna;
+}
+
+}  // namespace
+
+ICUCharsetConverter::ICUCharsetConverter(UConverter* converter)
+    : converter_(converter) {
+}
+
+ICUCharsetConverter::~ICUCharsetConverter() {
 }
 
-bool ReadUTFChar(const char* str, int* begin, int length,
-                 unsigned* code_point_out) {
-  int code_point;  // Avoids warning when U8_NEXT writes -1 to it.
-  U8_NEXT(str, *begin, length, code_point);
-  *code_point_out = static_cast<unsigned>(code_point);
-
-  // The ICU macro above moves to the next char, we want to point to the last
-  // char consumed.
-  (*begin)--;
-
-  // Validate the decoded value.
-  if (U_IS_UNICODE_CHAR(code_point))
-    return true;
-  *code_point_out = kUnicodeReplacementCharacter;
-  return false;
+void ICUCharsetConverter::ConvertFromUTF16(const char16* input,
+                                           int input_len,
+                                           CanonOutput* output) {
+  // Install our error handler. It will be called for character that can not
+  // be represented in the destination character set.
+  AppendHandlerInstaller handler(converter_);
+  ConvertFromUTF16WithICU(converter_, input, input_len, output);
+}
+
+void ICUCharsetConverter::ConvertFromUTF8(const char* input,
+                                          int input_len,
+                                          CanonOutput* output) {
+  AppendHandlerInstaller handler(converter_);
+  ConvertFromUTF8WithICU(converter_pool.GetUTF8Converter(), converter_,
+                         input, input_len, output);
 }
 
-bool ReadUTFChar(const char16* str, int* begin, int length,
-                 unsigned* code_point) {
-  if (U16_IS_SURROGATE(str[*begin])) {
-    if (!U16_IS_SURROGATE_LEAD(str[*begin]) || *begin + 1 >= length ||
-        !U16_IS_TRAIL(str[*begin + 1])) {
-      // Invalid surrogate pair.
-      *code_point = kUnicodeReplacementCharacter;
-      return false;
-    } else {
-      // Valid surrogate pair.
-      *code_point = U16_GET_SUPPLEMENTARY(str[*begin], str[*begin + 1]);
-      (*begin)++;
+namespace {
+
+// UTS #46 IDNA and converters from ICU. ICU itself is only reached, and its
+// data only loaded, by the first host or converter lookup that needs it.
+class ICUUnicodeBackend : public UnicodeBackend {
+ public:
+  virtual bool NameToASCII(const char16* src, int src_len,
+                           CanonOutputW* output) {
+    int prefix_len = output->length();
+    while (true) {
+      UErrorCode err = U_ZERO_ERROR;
+      UIDNAInfo info = UIDNA_INFO_INITIALIZER;
+      int num_converted = uidna_nameToASCII(
+          GetUIDNA(), src, src_len, &output->data()[prefix_len],
+          output->capacity() - prefix_len, &info, &err);
+      if (U_SUCCESS(err)) {
+        if (info.errors & ~kIgnoredIDNAErrors)
+          return false;
+        output->set_length(prefix_len + num_converted);
+        return true;
+      }
+      if (err != U_BUFFER_OVERFLOW_ERROR)
+        return false;  // Unknown error, give up.
+
+      // Not enough room in our buffer, expand.
+      if (!output->ReserveSpan(num_converted))
+        return false;
     }
-  } else {
-    // Not a surrogate, just one 16-bit word.
-    *code_point = str[*begin];
   }
 
-  if (U_IS_UNICODE_CHAR(*code_point))
-    return true;
+  virtual CharsetConverter* GetThreadCharsetConverter(
+      const char* charset_name) {
+    if (!charset_name)
+      return NULL;  // ucnv_open would give the default converter.
+    ConverterPool& pool = converter_pool;
+    for (size_t i = 0; i < pool.converters.size(); i++) {
+      if (pool.converters[i]->charset_name() == charset_name)
+        return pool.converters[i];
+    }
+
+    UErrorCode err = U_ZERO_ERROR;
+    UConverter* converter = ucnv_open(charset_name, &err);
+    if (U_FAILURE(err))
+      return NULL;
+    PooledCharsetConverter* pooled = new PooledCharsetConverter(
+        charset_name, converter, pool.GetUTF8Converter());
+    pool.converters.push_back(pooled);
+    return pooled;
+  }
+};
+
+}  // namespace
 
-  // Invalid code point.
-  *code_point = kUnicodeReplacementCharacter;
-  return false;
+UnicodeBackend* GetICUUnicodeBackend() {
+  static ICUUnicodeBackend backend;
+  return &backend;
 }
 
 }  // namespace url_canon
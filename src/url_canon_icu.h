@@ -33,6 +33,7 @@
 #define GOOGLEURL_SRC_URL_CANON_ICU_H__
 
 #include "googleurl/src/url_canon.h"
+#include "googleurl/src/url_canon_unicode.h"
 
 typedef struct UConverter UConverter;
 
@@ -53,11 +54,30 @@ class ICUCharsetConverter : public CharsetConverter {
                                          int input_len,
                                          CanonOutput* output);
 
+  // Converts straight from UTF-8 with ucnv_convertEx, which keeps the UTF-16
+  // pivot in a small stack buffer rather than converting the whole input.
+  GURL_API virtual void ConvertFromUTF8(const char* input,
+                                        int input_len,
+                                        CanonOutput* output);
+
  private:
   // The ICU converter, not owned by this class.
   UConverter* converter_;
 };
 
+// Returns the ICU backend, which is the default one unless GURL_NO_ICU is
+// defined. Its IDNA is UTS #46 processing with the IDNA 2003 compatible
+// transitional mapping, and its GetThreadCharsetConverter knows any name or
+// alias ICU knows.
+//
+// Unlike ICUCharsetConverter, which borrows a UConverter and so has to install
+// and remove its callback for unrepresentable characters around every
+// conversion, its converters own their UConverter and install the callback
+// once, so canonicalizing many URLs in a legacy encoding only pays for the
+// conversion itself. Looking up a name already used on the thread does not
+// allocate.
+GURL_API UnicodeBackend* GetICUUnicodeBackend();
+
 }  // namespace url_canon
 
 #endif  // GOOGLEURL_SRC_URL_CANON_ICU_H__
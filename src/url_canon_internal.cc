@@ -38,6 +38,17 @@ namespace url_canon {
 
 namespace {
 
+// Returns true if the given code point is a Unicode character: it is at most
+// U+10FFFF and is neither a surrogate nor one of the noncharacters.
+inline bool IsUnicodeChar(unsigned code_point) {
+  if (code_point < 0xd800)
+    return true;
+  if (code_point <= 0xdfff || code_point > 0x10ffff)
+    return false;
+  return !(code_point >= 0xfdd0 &&
+           (code_point <= 0xfdef || (code_point & 0xfffe) == 0xfffe));
+}
+
 template<typename CHAR, typename UCHAR>
 void DoAppendStringOfType(const CHAR* source, int length,
                           SharedCharTypes type,
@@ -52,10 +63,20 @@ void DoAppendStringOfType(const CHAR* source, int length,
     } else {
       // Just append the 7-bit character, possibly escaping it.
       unsigned char uch = static_cast<unsigned char>(source[i]);
-      if (!IsCharOfType(uch, type))
+      if (!IsCharOfType(uch, type)) {
         AppendEscapedChar(uch, output);
-      else
-        output->push_back(uch);
+      } else {
+        // Copy this character and any following ones that also don't need
+        // escaping as one block.
+        int run_end = i + 1;
+        while (run_end < length &&
+               static_cast<UCHAR>(source[run_end]) < 0x80 &&
+               IsCharOfType(static_cast<unsigned char>(source[run_end]),
+                            type))
+          run_end++;
+        AppendASCIIRun(&source[i], run_end - i, output);
+        i = run_end - 1;
+      }
     }
   }
 }
@@ -279,6 +300,91 @@ void AppendInvalidNarrowString(const char16* spec, int begin, int end,
   DoAppendInvalidNarrowString<char16, char16>(spec, begin, end, output);
 }
 
+bool ReadUTFChar(const char* str, int* begin, int length,
+                 unsigned* code_point_out) {
+  // This decodes exactly like ICU's U8_NEXT, which this used to be built on:
+  // an ill-formed sequence is consumed up to the first byte that can't
+  // continue it, and gives a single replacement character.
+  int i = *begin;
+  unsigned code_point = static_cast<unsigned char>(str[i++]);
+  if (code_point >= 0x80) {
+    // The range of the first trail byte excludes the overlong forms, the
+    // surrogates and everything above U+10FFFF.
+    unsigned trail_min = 0x80, trail_max = 0xbf;
+    int trail_count = 0;  // Stays 0 for bytes that can't start a sequence.
+    if (code_point >= 0xc2 && code_point <= 0xdf) {
+      trail_count = 1;
+      code_point &= 0x1f;
+    } else if (code_point >= 0xe0 && code_point <= 0xef) {
+      trail_count = 2;
+      if (code_point == 0xe0)
+        trail_min = 0xa0;
+      else if (code_point == 0xed)
+        trail_max = 0x9f;
+      code_point &= 0x0f;
+    } else if (code_point >= 0xf0 && code_point <= 0xf4) {
+      trail_count = 3;
+      if (code_point == 0xf0)
+        trail_min = 0x90;
+      else if (code_point == 0xf4)
+        trail_max = 0x8f;
+      code_point &= 0x07;
+    }
+
+    bool valid = trail_count > 0;
+    for (int n = 0; valid && n < trail_count; n++) {
+      unsigned trail = i < length ? static_cast<unsigned char>(str[i]) : 0;
+      if (trail < trail_min || trail > trail_max) {
+        valid = false;
+      } else {
+        code_point = (code_point << 6) | (trail & 0x3f);
+        trail_min = 0x80;
+        trail_max = 0xbf;
+        i++;
+      }
+    }
+    if (!valid)
+      code_point = kUnicodeReplacementCharacter;
+    else if (!IsUnicodeChar(code_point))
+      valid = false;
+
+    // Point to the last byte consumed.
+    *begin = i - 1;
+    if (!valid) {
+      *code_point_out = kUnicodeReplacementCharacter;
+      return false;
+    }
+  }
+  *code_point_out = code_point;
+  return true;
+}
+
+bool ReadUTFChar(const char16* str, int* begin, int length,
+                 unsigned* code_point) {
+  unsigned ch = str[*begin];
+  if ((ch & 0xf800) == 0xd800) {
+    if ((ch & 0x400) != 0 || *begin + 1 >= length ||
+        (str[*begin + 1] & 0xfc00) != 0xdc00) {
+      // Invalid surrogate pair.
+      *code_point = kUnicodeReplacementCharacter;
+      return false;
+    }
+    // Valid surrogate pair.
+    *code_point = 0x10000 + ((ch - 0xd800) << 10) + (str[*begin + 1] - 0xdc00);
+    (*begin)++;
+  } else {
+    // Not a surrogate, just one 16-bit word.
+    *code_point = ch;
+  }
+
+  if (IsUnicodeChar(*code_point))
+    return true;
+
+  // Invalid code point.
+  *code_point = kUnicodeReplacementCharacter;
+  return false;
+}
+
 bool ConvertUTF16ToUTF8(const char16* input, int input_len,
                         CanonOutput* output) {
   bool success = true;
@@ -301,6 +407,16 @@ bool ConvertUTF8ToUTF16(const char* input, int input_len,
   return success;
 }
 
+void CharsetConverter::ConvertFromUTF8(const char* input,
+                                       int input_len,
+                                       CanonOutput* output) {
+  // This will replace any misencoded values with the invalid character. This
+  // is what we want so we don't have to check for error.
+  RawCanonOutputW<1024> utf16;
+  ConvertUTF8ToUTF16(input, input_len, &utf16);
+  ConvertFromUTF16(utf16.data(), utf16.length(), output);
+}
+
 void SetupOverrideComponents(const char* base,
                              const Replacements<char>& repl,
                              URLComponentSource<char>* source,
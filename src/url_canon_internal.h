@@ -106,6 +106,23 @@ void AppendStringOfType(const char16* source, int length,
                         SharedCharTypes type,
                         CanonOutput* output);
 
+// Appends a block of 7-bit characters that are known to need no escaping or
+// other conversion, narrowing them to 8 bits if necessary. This does a single
+// capacity check for the block, and an 8-bit input is copied with memcpy.
+inline void AppendASCIIRun(const char* source, int length,
+                           CanonOutput* output) {
+  output->Append(source, length);
+}
+inline void AppendASCIIRun(const char16* source, int length,
+                           CanonOutput* output) {
+  char* dest = output->ReserveSpan(length);
+  if (!dest)
+    return;
+  for (int i = 0; i < length; i++)
+    dest[i] = static_cast<char>(source[i]);
+  output->CommitSpan(length);
+}
+
 // Maps the hex numerical values 0x0 to 0xf to the corresponding ASCII digit
 // that will be used to represent it.
 GURL_API extern const char kHexCharLookup[0x10];
@@ -174,7 +191,7 @@ extern const char16 kUnicodeReplacementCharacter;
 // can be incremented in a loop and will be ready for the next character.
 // (for a single-byte ASCII character, it will not be changed).
 //
-// Implementation is in url_canon_icu.cc.
+// Ill-formed sequences are consumed the same way as by ICU's U8_NEXT.
 GURL_API bool ReadUTFChar(const char* str, int* begin, int length,
                           unsigned* code_point_out);
 
@@ -250,8 +267,6 @@ inline void AppendUTF8EscapedValue(unsigned char_value, CanonOutput* output) {
 // |*begin| will be updated to point to the last character consumed so it
 // can be incremented in a loop and will be ready for the next character.
 // (for a single-16-bit-word character, it will not be changed).
-//
-// Implementation is in url_canon_icu.cc.
 GURL_API bool ReadUTFChar(const char16* str, int* begin, int length,
                           unsigned* code_point);
 
@@ -430,6 +445,40 @@ bool CanonicalizePartialPath(const char16* spec,
                              int path_begin_in_output,
                              CanonOutput* output);
 
+// Canonical form checks ------------------------------------------------------
+//
+// Each of these returns true when the corresponding component canonicalizer
+// would copy the (8-bit) input component to the output unchanged and report
+// success. They only look at the component contents; the delimiters around
+// them are checked by IsCanonicalStandardURL and friends. They are allowed to
+// be conservative, so a false return only means the component must go through
+// the canonicalizer to find out.
+
+// Implemented in url_canon_etc.cc. The scheme must be non-empty. For the user
+// info, either component may be invalid; an empty but present component is
+// never canonical since the canonicalizer strips it along with its separator.
+// |default_port| is the default port for the (canonical) scheme.
+bool IsCanonicalScheme(const char* spec, const url_parse::Component& scheme);
+bool IsCanonicalUserInfo(const char* spec,
+                         const url_parse::Component& username,
+                         const url_parse::Component& password);
+bool IsCanonicalPort(const char* spec,
+                     const url_parse::Component& port,
+                     int default_port);
+bool IsCanonicalRef(const char* spec, const url_parse::Component& ref);
+
+// Implemented in url_canon_host.cc. Only plain ASCII host names and IPv4
+// addresses are accepted; anything needing unescaping, IDN or IPv6 handling is
+// left to the canonicalizer.
+bool IsCanonicalHost(const char* spec, const url_parse::Component& host);
+
+// Implemented in url_canon_path.cc. The path must begin with a slash.
+bool IsCanonicalPath(const char* spec, const url_parse::Component& path);
+
+// Implemented in url_canon_query.cc. Only ASCII queries are accepted, since
+// non-ASCII ones depend on the charset converter.
+bool IsCanonicalQuery(const char* spec, const url_parse::Component& query);
+
 #ifndef WIN32
 
 // Implementations of Windows' int-to-string conversions
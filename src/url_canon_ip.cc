@@ -39,21 +39,6 @@ namespace url_canon {
 
 namespace {
 
-// Converts one of the character types that represent a numerical base to the
-// corresponding base.
-int BaseForType(SharedCharTypes type) {
-  switch (type) {
-    case CHAR_HEX:
-      return 16;
-    case CHAR_DEC:
-      return 10;
-    case CHAR_OCT:
-      return 8;
-    default:
-      return 0;
-  }
-}
-
 template<typename CHAR, typename UCHAR>
 bool DoFindIPv4Components(const CHAR* spec,
                           const url_parse::Component& host,
@@ -105,80 +90,13 @@ bool DoFindIPv4Components(const CHAR* spec,
   return true;
 }
 
-// Converts an IPv4 component to a 32-bit number, while checking for overflow.
-//
-// Possible return values:
-// - IPV4    - The number was valid, and did not overflow.
-// - BROKEN  - The input was numeric, but too large for a 32-bit field.
-// - NEUTRAL - Input was not numeric.
-//
-// The input is assumed to be ASCII. FindIPv4Components should have stripped
-// out any input that is greater than 7 bits. The components are assumed
-// to be non-empty.
-template<typename CHAR>
-CanonHostInfo::Family IPv4ComponentToNumber(
-    const CHAR* spec,
-    const url_parse::Component& component,
-    uint32* number) {
-  // Figure out the base
-  SharedCharTypes base;
-  int base_prefix_len = 0;  // Size of the prefix for this base.
-  if (spec[component.begin] == '0') {
-    // Either hex or dec, or a standalone zero.
-    if (component.len == 1) {
-      base = CHAR_DEC;
-    } else if (spec[component.begin + 1] == 'X' ||
-               spec[component.begin + 1] == 'x') {
-      base = CHAR_HEX;
-      base_prefix_len = 2;
-    } else {
-      base = CHAR_OCT;
-      base_prefix_len = 1;
-    }
-  } else {
-    base = CHAR_DEC;
-  }
-
-  // Extend the prefix to consume all leading zeros.
-  while (base_prefix_len < component.len &&
-         spec[component.begin + base_prefix_len] == '0')
-    base_prefix_len++;
-
-  // Put the component, minus any base prefix, into a NULL-terminated buffer so
-  // we can call the standard library.  Because leading zeros have already been
-  // discarded, filling the entire buffer is guaranteed to trigger the 32-bit
-  // overflow check.
-  const int kMaxComponentLen = 16;
-  char buf[kMaxComponentLen + 1];  // digits + '\0'
-  int dest_i = 0;
-  for (int i = component.begin + base_prefix_len; i < component.end(); i++) {
-    // We know the input is 7-bit, so convert to narrow (if this is the wide
-    // version of the template) by casting.
-    char input = static_cast<char>(spec[i]);
-
-    // Validate that this character is OK for the given base.
-    if (!IsCharOfType(input, base))
-      return CanonHostInfo::NEUTRAL;
-
-    // Fill the buffer, if there's space remaining.  This check allows us to
-    // verify that all characters are numeric, even those that don't fit.
-    if (dest_i < kMaxComponentLen)
-      buf[dest_i++] = input;
-  }
-
-  buf[dest_i] = '\0';
-
-  // Use the 64-bit strtoi so we get a big number (no hex, decimal, or octal
-  // number can overflow a 64-bit number in <= 16 characters).
-  uint64 num = _strtoui64(buf, NULL, BaseForType(base));
-
-  // Check for 32-bit overflow.
-  if (num > kuint32max)
-    return CanonHostInfo::BROKEN;
-
-  // No overflow.  Success!
-  *number = static_cast<uint32>(num);
-  return CanonHostInfo::IPV4;
+// Returns the numerical value of |ch| as a digit of the number base given by
+// |type| (CHAR_HEX, CHAR_DEC or CHAR_OCT), or -1 if it is not such a digit.
+template<typename UCHAR>
+inline int IPDigitValue(UCHAR ch, SharedCharTypes type) {
+  if (ch >= 0x80 || !IsCharOfType(static_cast<unsigned char>(ch), type))
+    return -1;
+  return HexCharToValue(static_cast<unsigned char>(ch));
 }
 
 // Writes the given address (with each character representing one dotted
@@ -202,14 +120,17 @@ void AppendIPv4Address(const unsigned char address[4],
 }
 
 // See declaration of IPv4AddressToNumber for documentation.
-template<typename CHAR>
+//
+// This finds the components and converts them in a single scan of the input,
+// accumulating each value as we go. Every malformed input is NEUTRAL wherever
+// the problem is found, so the result is the same as first splitting the host
+// with FindIPv4Components and then converting each component separately.
+template<typename CHAR, typename UCHAR>
 CanonHostInfo::Family DoIPv4AddressToNumber(const CHAR* spec,
                                             const url_parse::Component& host,
                                             unsigned char address[4],
                                             int* num_ipv4_components) {
-  // The identified components. Not all may exist.
-  url_parse::Component components[4];
-  if (!FindIPv4Components(spec, host, components))
+  if (!host.is_nonempty())
     return CanonHostInfo::NEUTRAL;
 
   // Convert existing components to digits. Values up to
@@ -217,24 +138,57 @@ CanonHostInfo::Family DoIPv4AddressToNumber(const CHAR* spec,
   uint32 component_values[4];
   int existing_components = 0;
 
-  // Set to true if one or more components are BROKEN.  BROKEN is only
-  // returned if all components are IPV4 or BROKEN, so, for example,
+  // Set to true if one or more components are too large. BROKEN is only
+  // returned if all components are numbers, so, for example,
   // 12345678912345.de returns NEUTRAL rather than broken.
   bool broken = false;
-  for (int i = 0; i < 4; i++) {
-    if (components[i].len <= 0)
-      continue;
-    CanonHostInfo::Family family = IPv4ComponentToNumber(
-        spec, components[i], &component_values[existing_components]);
-
-    if (family == CanonHostInfo::BROKEN) {
-      broken = true;
-    } else if (family != CanonHostInfo::IPV4) {
-      // Stop if we hit a non-BROKEN invalid non-empty component.
-      return family;
+
+  int end = host.end();
+  int cur = host.begin;
+  while (true) {
+    if (cur == end || spec[cur] == '.') {
+      // Empty component. This is only allowed at the end, indicating that the
+      // input ends in a dot, and only when it isn't the only component.
+      if (cur == end && existing_components > 0)
+        break;
+      return CanonHostInfo::NEUTRAL;
     }
+    if (existing_components == 4)
+      return CanonHostInfo::NEUTRAL;  // Too many components.
+
+    // Figure out the base from the prefix: "0x" for hex, "0" for octal. A
+    // standalone zero is the same in octal and decimal.
+    SharedCharTypes base = CHAR_DEC;
+    if (spec[cur] == '0') {
+      if (cur + 1 < end && (spec[cur + 1] == 'x' || spec[cur + 1] == 'X')) {
+        base = CHAR_HEX;
+        cur += 2;
+      } else {
+        base = CHAR_OCT;
+        cur++;
+      }
+    }
+    uint64 radix = base == CHAR_HEX ? 16 : (base == CHAR_DEC ? 10 : 8);
+
+    // Accumulate the digits. Once the value no longer fits in 32 bits we stop
+    // accumulating, but keep going to check that the rest is numeric.
+    uint64 value = 0;
+    bool overflow = false;
+    for (; cur < end && spec[cur] != '.'; cur++) {
+      int digit = IPDigitValue(static_cast<UCHAR>(spec[cur]), base);
+      if (digit < 0)
+        return CanonHostInfo::NEUTRAL;
+      if (!overflow) {
+        value = value * radix + digit;
+        overflow = value > kuint32max;
+      }
+    }
+    broken |= overflow;
+    component_values[existing_components++] = static_cast<uint32>(value);
 
-    existing_components++;
+    if (cur == end)
+      break;
+    cur++;  // Skip the dot.
   }
 
   if (broken)
@@ -340,6 +294,9 @@ struct IPv6Parsed {
   // There can be up to 8 hex components (colon separated) in the literal.
   url_parse::Component hex_components[8];
 
+  // The 16-bit value of each of the hex components, computed while parsing.
+  uint16 hex_values[8];
+
   // The count of hex components present. Ranges from [0,8].
   int num_hex_components;
 
@@ -369,6 +326,7 @@ bool DoParseIPv6(const CHAR* spec,
   int end = host.end();
 
   int cur_component_begin = begin;  // Start of the current component.
+  uint16 cur_component_value = 0;  // Value of the hex digits seen so far.
 
   // Scan through the input, searching for hex components, "::" contractions,
   // and IPv4 components.
@@ -401,8 +359,10 @@ bool DoParseIPv6(const CHAR* spec,
         if (parsed->num_hex_components >= 8)
           return false;
 
-        parsed->hex_components[parsed->num_hex_components++] =
+        parsed->hex_components[parsed->num_hex_components] =
             url_parse::Component(cur_component_begin, component_len);
+        parsed->hex_values[parsed->num_hex_components++] =
+            cur_component_value;
       }
     }
 
@@ -422,6 +382,7 @@ bool DoParseIPv6(const CHAR* spec,
       // Colons are separators between components, keep track of where the
       // current component started (after this colon).
       cur_component_begin = i + 1;
+      cur_component_value = 0;
     } else {
       if (static_cast<UCHAR>(spec[i]) >= 0x80)
         return false;  // Not ASCII.
@@ -441,6 +402,12 @@ bool DoParseIPv6(const CHAR* spec,
           return false;
         }
       }
+
+      // Components longer than 4 digits are rejected when they end, so the
+      // value doesn't matter if this overflows.
+      cur_component_value = static_cast<uint16>(
+          (cur_component_value << 4) |
+          HexCharToValue(static_cast<unsigned char>(spec[i])));
     }
   }
 
@@ -479,25 +446,6 @@ bool CheckIPv6ComponentsSize(const IPv6Parsed& parsed,
   return true;
 }
 
-// Converts a hex comonent into a number. This cannot fail since the caller has
-// already verified that each character in the string was a hex digit, and
-// that there were no more than 4 characters.
-template<typename CHAR>
-uint16 IPv6HexComponentToNumber(const CHAR* spec,
-                                const url_parse::Component& component) {
-  DCHECK(component.len <= 4);
-
-  // Copy the hex string into a C-string.
-  char buf[5];
-  for (int i = 0; i < component.len; ++i)
-    buf[i] = static_cast<char>(spec[component.begin + i]);
-  buf[component.len] = '\0';
-
-  // Convert it to a number (overflow is not possible, since with 4 hex
-  // characters we can at most have a 16 bit number).
-  return static_cast<uint16>(_strtoui64(buf, NULL, 16));
-}
-
 // Converts an IPv6 address to a 128-bit number (network byte order), returning
 // true on success. False means that the input was not a valid IPv6 address.
 template<typename CHAR, typename UCHAR>
@@ -536,9 +484,7 @@ bool DoIPv6AddressToNumber(const CHAR* spec,
     }
     // Append the hex component's value.
     if (i != ipv6_parsed.num_hex_components) {
-      // Get the 16-bit value for this hex component.
-      uint16 number = IPv6HexComponentToNumber<CHAR>(
-          spec, ipv6_parsed.hex_components[i]);
+      uint16 number = ipv6_parsed.hex_values[i];
       // Append to |address|, in network byte order.
       address[cur_index_in_address++] = (number & 0xFF00) >> 8;
       address[cur_index_in_address++] = (number & 0x00FF);
@@ -683,7 +629,10 @@ void CanonicalizeIPAddress(const char* spec,
                            const url_parse::Component& host,
                            CanonOutput* output,
                            CanonHostInfo* host_info) {
-  if (DoCanonicalizeIPv4Address<char, unsigned char>(
+  // A bracketed host can only be IPv6, the IPv4 parser would reject the
+  // bracket anyway.
+  if (!(host.is_nonempty() && spec[host.begin] == '[') &&
+      DoCanonicalizeIPv4Address<char, unsigned char>(
           spec, host, output, host_info))
     return;
   if (DoCanonicalizeIPv6Address<char, unsigned char>(
@@ -695,7 +644,10 @@ void CanonicalizeIPAddress(const char16* spec,
                            const url_parse::Component& host,
                            CanonOutput* output,
                            CanonHostInfo* host_info) {
-  if (DoCanonicalizeIPv4Address<char16, char16>(
+  // A bracketed host can only be IPv6, the IPv4 parser would reject the
+  // bracket anyway.
+  if (!(host.is_nonempty() && spec[host.begin] == '[') &&
+      DoCanonicalizeIPv4Address<char16, char16>(
           spec, host, output, host_info))
     return;
   if (DoCanonicalizeIPv6Address<char16, char16>(
@@ -707,14 +659,15 @@ CanonHostInfo::Family IPv4AddressToNumber(const char* spec,
                                           const url_parse::Component& host,
                                           unsigned char address[4],
                                           int* num_ipv4_components) {
-  return DoIPv4AddressToNumber<char>(spec, host, address, num_ipv4_components);
+  return DoIPv4AddressToNumber<char, unsigned char>(
+      spec, host, address, num_ipv4_components);
 }
 
 CanonHostInfo::Family IPv4AddressToNumber(const char16* spec,
                                           const url_parse::Component& host,
                                           unsigned char address[4],
                                           int* num_ipv4_components) {
-  return DoIPv4AddressToNumber<char16>(
+  return DoIPv4AddressToNumber<char16, char16>(
       spec, host, address, num_ipv4_components);
 }
 
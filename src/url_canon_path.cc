@@ -31,6 +31,7 @@
 #include "googleurl/base/logging.h"
 #include "googleurl/src/url_canon.h"
 #include "googleurl/src/url_canon_internal.h"
+#include "googleurl/src/url_canon_simd.h"
 #include "googleurl/src/url_parse_internal.h"
 
 namespace url_canon {
@@ -169,6 +170,10 @@ DotDisposition ClassifyAfterDot(const CHAR* spec, int after_dot,
 // It searches for a literal slash rather than including a backslash as well
 // because it is run only on the canonical output.
 //
+// Every character this scans is removed from the output, and each one was
+// written there once, so the time spent backing up over a whole path is
+// linear in its length however its segments are arranged.
+//
 // The output is guaranteed to end in a slash when this function completes.
 void BackUpToPreviousSlash(int path_begin_in_output,
                            CanonOutput* output) {
@@ -178,6 +183,7 @@ void BackUpToPreviousSlash(int path_begin_in_output,
   DCHECK(output->at(i) == '/');
   if (i == path_begin_in_output)
     return;  // We're at the first slash, nothing to do.
+  CANON_STAT_INCREMENT(path_backtracks);
 
   // Now back up (skipping the trailing slash) until we find another slash.
   i--;
@@ -211,6 +217,17 @@ bool DoPartialPath(const CHAR* spec,
   bool success = true;
   for (int i = path.begin; i < end; i++) {
     UCHAR uch = static_cast<UCHAR>(spec[i]);
+    if ((sizeof(CHAR) == sizeof(char) || uch < 0x80) &&
+        !(kPathCharLookup[static_cast<unsigned char>(uch)] & SPECIAL)) {
+      // Most of a typical path needs no special handling. Find the end of
+      // this run of such characters (vectorized where possible) and copy it
+      // as a block, so the code below only sees the interesting characters.
+      int run_end = i + 1 + FindSpecialPathChar(&spec[i + 1], end - i - 1);
+      AppendASCIIRun(&spec[i], run_end - i, output);
+      i = run_end - 1;
+      continue;
+    }
+
     if (sizeof(CHAR) > sizeof(char) && uch >= 0x80) {
       // We only need to test wide input for having non-ASCII characters. For
       // narrow input, we'll always just use the lookup table. We don't try to
@@ -223,7 +240,11 @@ bool DoPartialPath(const CHAR* spec,
       unsigned char out_ch = static_cast<unsigned char>(uch);
       unsigned char flags = kPathCharLookup[out_ch];
       if (flags & SPECIAL) {
-        // Needs special handling of some sort.
+        // Needs special handling of some sort. The handling of dots looks at
+        // what was written before, so stop if the output is full and has
+        // been dropping writes; see CanonOutputT::set_max_capacity().
+        if (output->truncated())
+          return false;
         int dotlen;
         if ((dotlen = IsDot(spec, i, end)) > 0) {
           // See if this dot was preceeded by a slash in the output. We
@@ -361,6 +382,44 @@ bool CanonicalizePath(const char16* spec,
   return DoPath<char16, char16>(spec, path, output, out_path);
 }
 
+bool IsCanonicalPath(const char* spec, const url_parse::Component& path) {
+  if (path.len <= 0 || spec[path.begin] != '/')
+    return false;
+
+  // This mirrors DoPartialPath: only the special characters can be changed,
+  // and since the output matches the input up to any point we reach, a dot
+  // follows a slash in the output exactly when it does in the input.
+  int end = path.end();
+  for (int i = path.begin + 1; i < end; i++) {
+    unsigned char ch = static_cast<unsigned char>(spec[i]);
+    if (!(kPathCharLookup[ch] & SPECIAL)) {
+      i += FindSpecialPathChar(&spec[i + 1], end - i - 1);
+      continue;
+    }
+
+    if (ch == '.') {
+      int consumed_len;
+      if (spec[i - 1] == '/' &&
+          ClassifyAfterDot<char>(spec, i + 1, end, &consumed_len) !=
+              NOT_A_DIRECTORY)
+        return false;
+    } else if (ch == '%') {
+      // Escaped dots are always unescaped, as are escaped characters that
+      // don't need it. Other escapes, and lone percents, are copied.
+      if (IsDot(spec, i, end))
+        return false;
+      unsigned char unescaped_value;
+      if (DecodeEscaped(spec, &i, end, &unescaped_value) &&
+          (kPathCharLookup[unescaped_value] & (UNESCAPE | INVALID_BIT)))
+        return false;
+    } else {
+      // Backslashes and characters that must be escaped.
+      return false;
+    }
+  }
+  return true;
+}
+
 bool CanonicalizePartialPath(const char* spec,
                              const url_parse::Component& path,
                              int path_begin_in_output,
@@ -100,6 +100,33 @@ bool CanonicalizePathURL(const char16* spec,
       URLComponentSource<char16>(spec), parsed, output, new_parsed);
 }
 
+bool IsCanonicalPathURL(const char* spec,
+                        int spec_len,
+                        const url_parse::Parsed& parsed) {
+  if (parsed.scheme.begin != 0 || !IsCanonicalScheme(spec, parsed.scheme))
+    return false;
+  int cur = parsed.scheme.end();
+  if (cur >= spec_len || spec[cur] != ':')
+    return false;
+  cur++;
+
+  // DoCanonicalizePathURL only escapes control and non-ASCII characters.
+  if (parsed.path.is_valid()) {
+    if (parsed.path.begin != cur)
+      return false;
+    int end = parsed.path.end();
+    for (int i = parsed.path.begin; i < end; i++) {
+      unsigned char ch = static_cast<unsigned char>(spec[i]);
+      if (ch < 0x20 || ch >= 0x80)
+        return false;
+    }
+    cur = end;
+  }
+
+  // Anything left over was trimmed by the parser.
+  return cur == spec_len;
+}
+
 bool ReplacePathURL(const char* base,
                     const url_parse::Parsed& base_parsed,
                     const Replacements<char>& replacements,
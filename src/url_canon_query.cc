@@ -29,6 +29,8 @@
 
 #include "googleurl/src/url_canon.h"
 #include "googleurl/src/url_canon_internal.h"
+#include "googleurl/src/url_canon_query_filter.h"
+#include "googleurl/src/url_canon_sampler.h"
 
 // Query canonicalization in IE
 // ----------------------------
@@ -84,29 +86,31 @@ template<typename CHAR>
 void AppendRaw8BitQueryString(const CHAR* source, int length,
                               CanonOutput* output) {
   for (int i = 0; i < length; i++) {
-    if (!IsQueryChar(static_cast<unsigned char>(source[i])))
+    if (!IsQueryChar(static_cast<unsigned char>(source[i]))) {
       AppendEscapedChar(static_cast<unsigned char>(source[i]), output);
-    else  // Doesn't need escaping.
-      output->push_back(static_cast<char>(source[i]));
+    } else {
+      // Doesn't need escaping, copy it along with the rest of the run of
+      // characters that don't either.
+      int run_end = i + 1;
+      while (run_end < length &&
+             IsQueryChar(static_cast<unsigned char>(source[run_end])))
+        run_end++;
+      AppendASCIIRun(&source[i], run_end - i, output);
+      i = run_end - 1;
+    }
   }
 }
 
-// Runs the converter on the given UTF-8 input. Since the converter expects
-// UTF-16, we have to convert first. The converter must be non-NULL.
+// Runs the converter on the given UTF-8 input. The converter must be non-NULL.
 void RunConverter(const char* spec,
                   const url_parse::Component& query,
                   CharsetConverter* converter,
                   CanonOutput* output) {
-  // This function will replace any misencoded values with the invalid
-  // character. This is what we want so we don't have to check for error.
-  RawCanonOutputW<1024> utf16;
-  ConvertUTF8ToUTF16(&spec[query.begin], query.len, &utf16);
-  converter->ConvertFromUTF16(utf16.data(), utf16.length(), output);
+  converter->ConvertFromUTF8(&spec[query.begin], query.len, output);
 }
 
-// Runs the converter with the given UTF-16 input. We don't have to do
-// anything, but this overriddden function allows us to use the same code
-// for both UTF-8 and UTF-16 input.
+// Runs the converter with the given UTF-16 input. This overloaded function
+// allows us to use the same code for both UTF-8 and UTF-16 input.
 void RunConverter(const char16* spec,
                   const url_parse::Component& query,
                   CharsetConverter* converter,
@@ -127,9 +131,20 @@ void DoConvertToQueryEncoding(const CHAR* spec,
     // Harder: convert to the proper encoding first.
     if (converter) {
       // Run the converter to get an 8-bit string, then append it, escaping
-      // necessary values.
+      // necessary values. Escaping never makes the string shorter, so it
+      // can't take more room than the output has left either.
       RawCanonOutput<1024> eight_bit;
-      RunConverter(spec, query, converter, &eight_bit);
+      eight_bit.set_max_capacity(output->max_capacity() - output->length());
+      {
+        NoteSlowURLPath(SLOW_URL_CHARSET);
+        CANON_STAT_INCREMENT(charset_conversions);
+        CANON_STAT_SCOPED_TIMER(charset_conversion_ns);
+        RunConverter(spec, query, converter, &eight_bit);
+      }
+      if (eight_bit.truncated()) {
+        output->set_truncated();
+        return;
+      }
       AppendRaw8BitQueryString(eight_bit.data(), eight_bit.length(), output);
 
     } else {
@@ -143,6 +158,7 @@ template<typename CHAR, typename UCHAR>
 void DoCanonicalizeQuery(const CHAR* spec,
                          const url_parse::Component& query,
                          CharsetConverter* converter,
+                         const QueryFilter* filter,
                          CanonOutput* output,
                          url_parse::Component* out_query) {
   if (query.len < 0) {
@@ -156,6 +172,12 @@ void DoCanonicalizeQuery(const CHAR* spec,
   DoConvertToQueryEncoding<CHAR, UCHAR>(spec, query, converter, output);
 
   out_query->len = output->length() - out_query->begin;
+
+  // The parameters are matched in their canonical form, so they are filtered
+  // once written. The query is the last thing in the output at this point, so
+  // there is nothing after it to move.
+  if (filter)
+    filter->Apply(output, out_query, NULL);
 }
 
 }  // namespace
@@ -165,19 +187,48 @@ void CanonicalizeQuery(const char* spec,
                        CharsetConverter* converter,
                        CanonOutput* output,
                        url_parse::Component* out_query) {
-  DoCanonicalizeQuery<char, unsigned char>(spec, query, converter,
+  DoCanonicalizeQuery<char, unsigned char>(spec, query, converter, NULL,
+                                           output, out_query);
+}
+
+void CanonicalizeQuery(const char16* spec,
+                       const url_parse::Component& query,
+                       CharsetConverter* converter,
+                       CanonOutput* output,
+                       url_parse::Component* out_query) {
+  DoCanonicalizeQuery<char16, char16>(spec, query, converter, NULL,
+                                      output, out_query);
+}
+
+void CanonicalizeQuery(const char* spec,
+                       const url_parse::Component& query,
+                       CharsetConverter* converter,
+                       const QueryFilter* filter,
+                       CanonOutput* output,
+                       url_parse::Component* out_query) {
+  DoCanonicalizeQuery<char, unsigned char>(spec, query, converter, filter,
                                            output, out_query);
 }
 
 void CanonicalizeQuery(const char16* spec,
                        const url_parse::Component& query,
                        CharsetConverter* converter,
+                       const QueryFilter* filter,
                        CanonOutput* output,
                        url_parse::Component* out_query) {
-  DoCanonicalizeQuery<char16, char16>(spec, query, converter,
+  DoCanonicalizeQuery<char16, char16>(spec, query, converter, filter,
                                       output, out_query);
 }
 
+bool IsCanonicalQuery(const char* spec, const url_parse::Component& query) {
+  int end = query.end();
+  for (int i = query.begin; i < end; i++) {
+    if (!IsQueryChar(static_cast<unsigned char>(spec[i])))
+      return false;
+  }
+  return true;
+}
+
 void ConvertUTF16ToQueryEncoding(const char16* input,
                                  const url_parse::Component& query,
                                  CharsetConverter* converter,
@@ -0,0 +1,155 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "googleurl/src/url_canon_query_filter.h"
+
+#include "googleurl/base/logging.h"
+
+namespace url_canon {
+
+namespace {
+
+inline uint64_t HashKey(const char* key, int key_len) {
+  return url_util::FNVHash(url_util::kFNVBasis, key, key_len);
+}
+
+}  // namespace
+
+QueryFilter::QueryFilter(Mode mode) : mode_(mode) {
+}
+
+QueryFilter::~QueryFilter() {
+}
+
+void QueryFilter::Add(const char* key, int key_len) {
+  if (key_len > 0 && key[key_len - 1] == '*') {
+    std::string prefix(key, key_len - 1);
+    for (size_t i = 0; i < prefixes_.size(); i++) {
+      if (prefixes_[i] == prefix)
+        return;
+    }
+    prefixes_.push_back(prefix);
+    return;
+  }
+
+  uint64_t hash = HashKey(key, key_len);
+  if (Contains(hash, key, key_len))
+    return;
+
+  Entry entry;
+  entry.hash = hash;
+  entry.offset = static_cast<int>(keys_.size());
+  entry.len = key_len;
+  keys_.append(key, key_len);
+  entries_.Add(entry);
+}
+
+bool QueryFilter::Matches(const char* key, int key_len) const {
+  if (Contains(HashKey(key, key_len), key, key_len))
+    return true;
+  for (size_t i = 0; i < prefixes_.size(); i++) {
+    int prefix_len = static_cast<int>(prefixes_[i].size());
+    if (prefix_len <= key_len &&
+        memcmp(key, prefixes_[i].data(), prefix_len) == 0)
+      return true;
+  }
+  return false;
+}
+
+void QueryFilter::Apply(CanonOutput* output,
+                        url_parse::Component* query,
+                        url_parse::Component* ref) const {
+  if (query->len < 0)
+    return;
+  DCHECK(query->begin > 0 && query->end() <= output->length());
+
+  // The kept parameters are compacted towards the start of the query. Since
+  // the write position never passes the read position, this happens in
+  // place.
+  char* data = output->data();
+  int end = query->end();
+  int write = query->begin;
+  bool kept_any = false;
+  int cur = query->begin;
+  while (cur <= end) {
+    int param_begin = cur;
+    int key_end = -1;
+    while (cur < end && data[cur] != '&') {
+      if (key_end < 0 && data[cur] == '=')
+        key_end = cur;
+      cur++;
+    }
+    if (key_end < 0)
+      key_end = cur;
+
+    if (Keeps(&data[param_begin], key_end - param_begin)) {
+      if (kept_any)
+        data[write++] = '&';
+      kept_any = true;
+      memmove(&data[write], &data[param_begin], cur - param_begin);
+      write += cur - param_begin;
+    }
+    cur++;  // Skip the '&'.
+  }
+
+  // With nothing left, drop the '?' as well.
+  int new_end = write;
+  if (!kept_any) {
+    new_end = query->begin - 1;
+    query->reset();
+  } else {
+    query->len = write - query->begin;
+  }
+
+  int removed = end - new_end;
+  if (removed == 0)
+    return;
+  int tail_len = output->length() - end;
+  if (tail_len > 0) {
+    DCHECK(ref && ref->begin > end);
+    memmove(&data[new_end], &data[end], tail_len);
+  }
+  if (ref && ref->is_valid())
+    ref->begin -= removed;
+  output->set_length(output->length() - removed);
+}
+
+bool QueryFilter::Contains(uint64_t hash, const char* key, int key_len) const {
+  for (url_util::HashTable<Entry>::Probe probe(entries_, hash); !probe.done();
+       probe.Next()) {
+    const Entry& entry = probe.entry();
+    if (entry.len == key_len &&
+        memcmp(&keys_[entry.offset], key, key_len) == 0)
+      return true;
+  }
+  return false;
+}
+
+}  // namespace url_canon
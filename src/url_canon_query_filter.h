@@ -0,0 +1,125 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef GOOGLEURL_SRC_URL_CANON_QUERY_FILTER_H__
+#define GOOGLEURL_SRC_URL_CANON_QUERY_FILTER_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "googleurl/src/url_canon.h"
+#include "googleurl/src/url_common.h"
+#include "googleurl/src/url_parse.h"
+#include "googleurl/src/url_util_internal.h"
+
+namespace url_canon {
+
+// A set of query parameter keys compiled for removing parameters from
+// canonical queries, such as the tracking parameters "utm_source" or
+// "gclid". The filter either drops the listed keys or keeps only them. A
+// lookup hashes the key once, so it costs time proportional to the length of
+// the key no matter how many keys are in the set.
+//
+// Keys are compared byte for byte with the keys of the canonical query, so
+// they must be given in canonical (escaped) form, and are case sensitive like
+// the query itself. A key ending with '*' matches any key starting with the
+// rest of it, so "utm_*" matches "utm_source" and "utm_medium".
+//
+// Adding keys is not threadsafe, but once built, a filter can be used from
+// any number of threads.
+class QueryFilter {
+ public:
+  enum Mode {
+    DROP_LISTED,  // Remove the parameters whose key is in the set.
+    KEEP_LISTED,  // Remove all the other parameters.
+  };
+
+  GURL_API explicit QueryFilter(Mode mode);
+  GURL_API ~QueryFilter();
+
+  Mode mode() const {
+    return mode_;
+  }
+
+  // Adds the given key or key prefix (see above), which need not be NULL
+  // terminated. Adding a key that is already in the set does nothing.
+  GURL_API void Add(const char* key, int key_len);
+  void Add(const char* key) {
+    Add(key, static_cast<int>(strlen(key)));
+  }
+
+  // Returns true if the given key is in the set or starts with one of its
+  // prefixes.
+  GURL_API bool Matches(const char* key, int key_len) const;
+
+  // Returns true if a parameter with the given key should stay in the query.
+  bool Keeps(const char* key, int key_len) const {
+    return Matches(key, key_len) == (mode_ == KEEP_LISTED);
+  }
+
+  // Removes the parameters this filter rejects from the canonical query at
+  // |*query| in |output|, in place, in a single scan. A parameter is
+  // everything between two '&', and its key is the part before the first
+  // '=', as for url_parse::ExtractQueryKeyValue. When no parameter is left,
+  // the '?' is removed too and |*query| is reset.
+  //
+  // Anything after the query in the output is moved down to follow it. This
+  // is normally the ref, so |ref| is adjusted as well when it is non-NULL;
+  // it must be if the output has a ref.
+  GURL_API void Apply(CanonOutput* output,
+                      url_parse::Component* query,
+                      url_parse::Component* ref) const;
+
+ private:
+  struct Entry {
+    uint64_t hash;
+    int offset;  // In keys_.
+    int len;
+  };
+
+  // Returns true if the exact key is in the set.
+  bool Contains(uint64_t hash, const char* key, int key_len) const;
+
+  Mode mode_;
+
+  // The exact keys, one after the other.
+  std::string keys_;
+  url_util::HashTable<Entry> entries_;
+
+  // The key prefixes, without their '*'. There are usually only a few.
+  std::vector<std::string> prefixes_;
+};
+
+}  // namespace url_canon
+
+#endif  // GOOGLEURL_SRC_URL_CANON_QUERY_FILTER_H__
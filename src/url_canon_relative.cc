@@ -85,11 +85,9 @@ bool DoesBeginSlashWindowsDriveSpec(const CHAR* spec, int start_offset,
 
 // See IsRelativeURL in the header file for usage.
 template<typename CHAR>
-bool DoIsRelativeURL(const char* base,
-                     const url_parse::Parsed& base_parsed,
+bool DoIsRelativeURL(const RelativeBase& base,
                      const CHAR* url,
                      int url_len,
-                     bool is_base_hierarchical,
                      bool* is_relative,
                      url_parse::Component* relative_component) {
   *is_relative = false;  // So we can default later to not relative.
@@ -128,7 +126,7 @@ bool DoIsRelativeURL(const char* base,
   url_parse::Component scheme;
   if (!url_parse::ExtractScheme(url, url_len, &scheme) || scheme.len == 0) {
     // Don't allow relative URLs if the base scheme doesn't support it.
-    if (!is_base_hierarchical)
+    if (!base.is_hierarchical)
       return false;
 
     *relative_component = url_parse::MakeRange(begin, url_len);
@@ -147,20 +145,21 @@ bool DoIsRelativeURL(const char* base,
   }
 
   // If the scheme is not the same, then we can't count it as relative.
-  if (!AreSchemesEqual(base, base_parsed.scheme, url, scheme))
+  if (!AreSchemesEqual(base.spec, base.parsed.scheme, url, scheme))
     return true;
 
   // When the scheme that they both share is not hierarchical, treat the
   // incoming scheme as absolute (this way with the base of "data:foo",
   // "data:bar" will be reported as absolute.
-  if (!is_base_hierarchical)
+  if (!base.is_hierarchical)
     return true;
 
   int colon_offset = scheme.end();
 
   // If it's a filesystem URL, the only valid way to make it relative is not to
-  // supply a scheme.  There's no equivalent to e.g. http:index.html.
-  if (url_util::CompareSchemeComponent(url, scheme, "filesystem"))
+  // supply a scheme.  There's no equivalent to e.g. http:index.html. The
+  // schemes are the same, so we can check the base.
+  if (base.is_filesystem)
     return true;
 
   // ExtractScheme guarantees that the colon immediately follows what it
@@ -181,30 +180,17 @@ bool DoIsRelativeURL(const char* base,
   return true;
 }
 
-// Copies all characters in the range [begin, end) of |spec| to the output,
-// up until and including the last slash. There should be a slash in the
-// range, if not, nothing will be copied.
+// Returns the offset just past the last slash in the range [begin, end) of
+// |spec|, or -1 if there is no slash in the range.
 //
 // The input is assumed to be canonical, so we search only for exact slashes
 // and not backslashes as well. We also know that it's ASCII.
-void CopyToLastSlash(const char* spec,
-                     int begin,
-                     int end,
-                     CanonOutput* output) {
-  // Find the last slash.
-  int last_slash = -1;
+int FindPathPrefixEnd(const char* spec, int begin, int end) {
   for (int i = end - 1; i >= begin; i--) {
-    if (spec[i] == '/') {
-      last_slash = i;
-      break;
-    }
+    if (spec[i] == '/')
+      return i + 1;
   }
-  if (last_slash < 0)
-    return;  // No slash.
-
-  // Copy.
-  for (int i = begin; i <= last_slash; i++)
-    output->push_back(spec[i]);
+  return -1;
 }
 
 // Copies a single component from the source to the output. This is used
@@ -278,14 +264,14 @@ int CopyBaseDriveSpecIfNecessary(const char* base_url,
 // A subroutine of DoResolveRelativeURL, this resolves the URL knowning that
 // the input is a relative path or less (qyuery or ref).
 template<typename CHAR>
-bool DoResolveRelativePath(const char* base_url,
-                           const url_parse::Parsed& base_parsed,
-                           bool base_is_file,
+bool DoResolveRelativePath(const RelativeBase& base,
                            const CHAR* relative_url,
                            const url_parse::Component& relative_component,
                            CharsetConverter* query_converter,
                            CanonOutput* output,
                            url_parse::Parsed* out_parsed) {
+  const char* base_url = base.spec;
+  const url_parse::Parsed& base_parsed = base.parsed;
   bool success = true;
 
   // We know the authority section didn't change, copy it to the output. We
@@ -309,7 +295,7 @@ bool DoResolveRelativePath(const char* base_url,
     // beginning so we can fix it up after we are done.
     int base_path_begin = base_parsed.path.begin;
 #ifdef WIN32
-    if (base_is_file) {
+    if (base.is_file) {
       base_path_begin = CopyBaseDriveSpecIfNecessary(
           base_url, base_parsed.path.begin, base_parsed.path.end(),
           relative_url, relative_component.begin, relative_component.end(),
@@ -332,8 +318,10 @@ bool DoResolveRelativePath(const char* base_url,
       // original path with the file part stripped, and append the new path.
       // The canonicalizer will take care of resolving ".." and "."
       int path_begin = output->length();
-      CopyToLastSlash(base_url, base_path_begin, base_parsed.path.end(),
-                      output);
+      if (base.path_prefix_end > base_path_begin) {
+        output->Append(&base_url[base_path_begin],
+                       base.path_prefix_end - base_path_begin);
+      }
       success &= CanonicalizePartialPath(relative_url, path, path_begin,
                                          output);
       out_parsed->path = url_parse::MakeRange(path_begin, output->length());
@@ -438,14 +426,16 @@ bool DoResolveAbsoluteFile(const CHAR* relative_url,
 
 // TODO(brettw) treat two slashes as root like Mozilla for FTP?
 template<typename CHAR>
-bool DoResolveRelativeURL(const char* base_url,
-                          const url_parse::Parsed& base_parsed,
-                          bool base_is_file,
+bool DoResolveRelativeURL(const RelativeBase& base,
                           const CHAR* relative_url,
                           const url_parse::Component& relative_component,
                           CharsetConverter* query_converter,
                           CanonOutput* output,
                           url_parse::Parsed* out_parsed) {
+  const char* base_url = base.spec;
+  const url_parse::Parsed& base_parsed = base.parsed;
+  bool base_is_file = base.is_file;
+
   // Starting point for our output parsed. We'll fix what we change.
   *out_parsed = base_parsed;
 
@@ -519,13 +509,27 @@ bool DoResolveRelativeURL(const char* base_url,
   }
 
   // When we get here, we know that the relative URL is on the same host.
-  return DoResolveRelativePath(base_url, base_parsed, base_is_file,
-                               relative_url, relative_component,
+  return DoResolveRelativePath(base, relative_url, relative_component,
                                query_converter, output, out_parsed);
 }
 
 }  // namespace
 
+void InitRelativeBase(const char* base,
+                      const url_parse::Parsed& base_parsed,
+                      bool is_base_hierarchical,
+                      bool base_is_file,
+                      RelativeBase* relative_base) {
+  relative_base->spec = base;
+  relative_base->parsed = base_parsed;
+  relative_base->is_hierarchical = is_base_hierarchical;
+  relative_base->is_file = base_is_file;
+  relative_base->is_filesystem = base_parsed.scheme.is_nonempty() &&
+      url_util::CompareSchemeComponent(base, base_parsed.scheme, "filesystem");
+  relative_base->path_prefix_end = FindPathPrefixEnd(
+      base, base_parsed.path.begin, base_parsed.path.end());
+}
+
 bool IsRelativeURL(const char* base,
                    const url_parse::Parsed& base_parsed,
                    const char* fragment,
@@ -533,9 +537,11 @@ bool IsRelativeURL(const char* base,
                    bool is_base_hierarchical,
                    bool* is_relative,
                    url_parse::Component* relative_component) {
+  RelativeBase relative_base;
+  InitRelativeBase(base, base_parsed, is_base_hierarchical, false,
+                   &relative_base);
   return DoIsRelativeURL<char>(
-      base, base_parsed, fragment, fragment_len, is_base_hierarchical,
-      is_relative, relative_component);
+      relative_base, fragment, fragment_len, is_relative, relative_component);
 }
 
 bool IsRelativeURL(const char* base,
@@ -545,9 +551,29 @@ bool IsRelativeURL(const char* base,
                    bool is_base_hierarchical,
                    bool* is_relative,
                    url_parse::Component* relative_component) {
+  RelativeBase relative_base;
+  InitRelativeBase(base, base_parsed, is_base_hierarchical, false,
+                   &relative_base);
+  return DoIsRelativeURL<char16>(
+      relative_base, fragment, fragment_len, is_relative, relative_component);
+}
+
+bool IsRelativeURL(const RelativeBase& base,
+                   const char* fragment,
+                   int fragment_len,
+                   bool* is_relative,
+                   url_parse::Component* relative_component) {
+  return DoIsRelativeURL<char>(
+      base, fragment, fragment_len, is_relative, relative_component);
+}
+
+bool IsRelativeURL(const RelativeBase& base,
+                   const char16* fragment,
+                   int fragment_len,
+                   bool* is_relative,
+                   url_parse::Component* relative_component) {
   return DoIsRelativeURL<char16>(
-      base, base_parsed, fragment, fragment_len, is_base_hierarchical,
-      is_relative, relative_component);
+      base, fragment, fragment_len, is_relative, relative_component);
 }
 
 bool ResolveRelativeURL(const char* base_url,
@@ -558,9 +584,11 @@ bool ResolveRelativeURL(const char* base_url,
                         CharsetConverter* query_converter,
                         CanonOutput* output,
                         url_parse::Parsed* out_parsed) {
+  RelativeBase relative_base;
+  InitRelativeBase(base_url, base_parsed, true, base_is_file, &relative_base);
   return DoResolveRelativeURL<char>(
-      base_url, base_parsed, base_is_file, relative_url,
-      relative_component, query_converter, output, out_parsed);
+      relative_base, relative_url, relative_component, query_converter,
+      output, out_parsed);
 }
 
 bool ResolveRelativeURL(const char* base_url,
@@ -571,9 +599,33 @@ bool ResolveRelativeURL(const char* base_url,
                         CharsetConverter* query_converter,
                         CanonOutput* output,
                         url_parse::Parsed* out_parsed) {
+  RelativeBase relative_base;
+  InitRelativeBase(base_url, base_parsed, true, base_is_file, &relative_base);
+  return DoResolveRelativeURL<char16>(
+      relative_base, relative_url, relative_component, query_converter,
+      output, out_parsed);
+}
+
+bool ResolveRelativeURL(const RelativeBase& base,
+                        const char* relative_url,
+                        const url_parse::Component& relative_component,
+                        CharsetConverter* query_converter,
+                        CanonOutput* output,
+                        url_parse::Parsed* out_parsed) {
+  return DoResolveRelativeURL<char>(
+      base, relative_url, relative_component, query_converter,
+      output, out_parsed);
+}
+
+bool ResolveRelativeURL(const RelativeBase& base,
+                        const char16* relative_url,
+                        const url_parse::Component& relative_component,
+                        CharsetConverter* query_converter,
+                        CanonOutput* output,
+                        url_parse::Parsed* out_parsed) {
   return DoResolveRelativeURL<char16>(
-      base_url, base_parsed, base_is_file, relative_url,
-      relative_component, query_converter, output, out_parsed);
+      base, relative_url, relative_component, query_converter,
+      output, out_parsed);
 }
 
 }  // namespace url_canon
@@ -0,0 +1,382 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "googleurl/src/url_canon_sampler.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define URL_SAMPLER_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define URL_SAMPLER_RDTSC 1
+#elif !defined(__aarch64__)
+#include <chrono>
+#endif
+
+#include "googleurl/src/url_canon.h"
+#include "googleurl/src/url_canon_internal.h"
+
+namespace url_canon {
+
+std::atomic<int> slow_url_sample_interval(0);
+
+namespace {
+
+// Bumped whenever the samples are dropped. Slots recorded under an older
+// generation are ignored by readers and overwritten by their threads.
+std::atomic<unsigned> sample_generation(1);
+
+std::atomic<int> max_samples_per_thread(kMaxSlowURLSamples);
+
+inline unsigned long long ReadTicks() {
+#if defined(URL_SAMPLER_RDTSC)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  unsigned long long ticks;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// The spec of a sample is stored as words so that it can be copied with
+// atomic loads and stores.
+const int kSpecWords = kSlowURLSpecCapacity / 8;
+
+// One recorded sample. It is written only by the thread owning its buffer and
+// read by GetSlowURLSamples, using |sequence| as a sequence lock: it is odd
+// while a write is in progress, and a reader that sees it change retries.
+// The fields are atomics written with release and read with acquire, which
+// orders them against |sequence| without fences, so that a read racing with a
+// write is only ever discarded, never undefined. Both are plain moves on x86.
+struct SampleSlot {
+  SampleSlot()
+      : sequence(0), generation(0), ticks(0), path(0), spec_len(0),
+        stored_len(0) {
+  }
+
+  std::atomic<unsigned> sequence;
+  std::atomic<unsigned> generation;
+  std::atomic<unsigned long long> ticks;
+  std::atomic<int> path;
+  std::atomic<int> spec_len;
+  std::atomic<int> stored_len;
+  std::atomic<uint64_t> spec[kSpecWords];
+};
+
+// The samples of one thread. Buffers are never freed: when its thread exits a
+// buffer is released for the next new thread to take over, and its samples
+// stay readable until then.
+struct ThreadSamples {
+  ThreadSamples()
+      : in_use(false), next(NULL), generation(0), count(0), capacity(0),
+        fastest(0) {
+  }
+
+  SampleSlot slots[kMaxSlowURLSamples];
+
+  // Set while a thread owns the buffer.
+  std::atomic<bool> in_use;
+
+  // Link in the list of all buffers, set before the buffer is published.
+  ThreadSamples* next;
+
+  // The rest is only used by the owning thread. |count| slots of the current
+  // |generation| are in use, of at most |capacity|, and |fastest| is the one
+  // the next slower sample replaces once they are all in use.
+  unsigned generation;
+  int count;
+  int capacity;
+  int fastest;
+  unsigned long long ticks[kMaxSlowURLSamples];
+};
+
+std::atomic<ThreadSamples*> all_thread_samples(NULL);
+
+// Takes over a buffer released by an exited thread, or adds a new one.
+ThreadSamples* ClaimThreadSamples() {
+  for (ThreadSamples* samples =
+           all_thread_samples.load(std::memory_order_acquire);
+       samples; samples = samples->next) {
+    bool in_use = false;
+    if (samples->in_use.compare_exchange_strong(in_use, true,
+                                                std::memory_order_acq_rel))
+      return samples;
+  }
+
+  ThreadSamples* samples = new ThreadSamples;
+  samples->in_use.store(true, std::memory_order_relaxed);
+  samples->next = all_thread_samples.load(std::memory_order_relaxed);
+  while (!all_thread_samples.compare_exchange_weak(
+      samples->next, samples,
+      std::memory_order_release, std::memory_order_relaxed)) {
+  }
+  return samples;
+}
+
+struct SamplerThreadState {
+  SamplerThreadState()
+      : countdown(0), random(0), active(false), path(0), samples(NULL) {
+  }
+  ~SamplerThreadState() {
+    if (samples)
+      samples->in_use.store(false, std::memory_order_release);
+  }
+
+  // Calls left before the next sample.
+  int countdown;
+
+  // State of the xorshift generator spreading out the samples, so that they
+  // don't lock onto a period in the input.
+  unsigned random;
+
+  // Set while a call is being sampled, and the SlowURLPath bits noted so far.
+  bool active;
+  int path;
+
+  ThreadSamples* samples;
+};
+thread_local SamplerThreadState sampler_state;
+
+// Returns the number of calls until the next sample, which averages
+// |interval|.
+int NextCountdown(SamplerThreadState* state, int interval) {
+  if (interval <= 1)
+    return 1;
+  if (state->random == 0) {
+    state->random = static_cast<unsigned>(ReadTicks() ^
+        reinterpret_cast<size_t>(state)) | 1;
+  }
+  state->random ^= state->random << 13;
+  state->random ^= state->random >> 17;
+  state->random ^= state->random << 5;
+  return 1 + static_cast<int>(state->random %
+                              (2 * static_cast<unsigned>(interval) - 1));
+}
+
+// Zeroes the word the last of |len| bytes go into, so that the bytes after
+// them are not left uninitialized.
+inline void ClearLastWord(int len, uint64_t words[kSpecWords]) {
+  if (len > 0)
+    words[(len - 1) / 8] = 0;
+}
+
+// Copies the spec into |words|, cutting it to fit, and returns the number of
+// bytes kept.
+int CutSpec(const char* spec, const char16* spec16, int spec_len,
+            uint64_t words[kSpecWords]) {
+  if (spec) {
+    int len = std::min(spec_len, static_cast<int>(kSlowURLSpecCapacity));
+    ClearLastWord(len, words);
+    memcpy(words, spec, len);
+    return len;
+  }
+
+  RawCanonOutput<kSlowURLSpecCapacity * 3> utf8;
+  ConvertUTF16ToUTF8(spec16, std::min(spec_len, static_cast<int>(
+      kSlowURLSpecCapacity)), &utf8);
+  int len = utf8.length();
+  if (len > kSlowURLSpecCapacity) {
+    // Drop the character cut in two.
+    len = kSlowURLSpecCapacity;
+    while (len > 0 && (static_cast<unsigned char>(utf8.at(len)) & 0xc0) ==
+                      0x80)
+      len--;
+  }
+  ClearLastWord(len, words);
+  memcpy(words, utf8.data(), len);
+  return len;
+}
+
+void RecordSample(SamplerThreadState* state,
+                  const char* spec, const char16* spec16, int spec_len,
+                  unsigned long long ticks, int path) {
+  unsigned generation = sample_generation.load(std::memory_order_acquire);
+  if (!state->samples)
+    state->samples = ClaimThreadSamples();
+  ThreadSamples* samples = state->samples;
+  if (samples->generation != generation) {
+    samples->generation = generation;
+    samples->count = 0;
+    samples->capacity = max_samples_per_thread.load(std::memory_order_relaxed);
+  }
+
+  int index;
+  if (samples->count < samples->capacity) {
+    index = samples->count++;
+  } else {
+    if (ticks <= samples->ticks[samples->fastest])
+      return;
+    index = samples->fastest;
+  }
+  samples->ticks[index] = ticks;
+
+  uint64_t words[kSpecWords];
+  int stored_len = CutSpec(spec, spec16, spec_len, words);
+
+  SampleSlot* slot = &samples->slots[index];
+  unsigned sequence = slot->sequence.load(std::memory_order_relaxed);
+  slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+  slot->generation.store(generation, std::memory_order_release);
+  slot->ticks.store(ticks, std::memory_order_release);
+  slot->path.store(path, std::memory_order_release);
+  slot->spec_len.store(spec_len, std::memory_order_release);
+  slot->stored_len.store(stored_len, std::memory_order_release);
+  for (int i = 0; i < (stored_len + 7) / 8; i++)
+    slot->spec[i].store(words[i], std::memory_order_release);
+  slot->sequence.store(sequence + 2, std::memory_order_release);
+
+  if (samples->count == samples->capacity) {
+    samples->fastest = 0;
+    for (int i = 1; i < samples->count; i++) {
+      if (samples->ticks[i] < samples->ticks[samples->fastest])
+        samples->fastest = i;
+    }
+  }
+}
+
+// Copies |slot| into |*sample| if it holds a sample of |generation|. Gives up
+// on a slot being rewritten over and over rather than wait for it.
+bool ReadSample(const SampleSlot& slot, unsigned generation,
+                SlowURLSample* sample) {
+  uint64_t words[kSpecWords];
+  for (int attempt = 0; attempt < 4; attempt++) {
+    unsigned sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence & 1)
+      continue;
+    unsigned slot_generation =
+        slot.generation.load(std::memory_order_acquire);
+    unsigned long long ticks = slot.ticks.load(std::memory_order_acquire);
+    int path = slot.path.load(std::memory_order_acquire);
+    int spec_len = slot.spec_len.load(std::memory_order_acquire);
+    // A torn read can give any length, so clamp it before using it.
+    int stored_len = std::min(
+        std::max(slot.stored_len.load(std::memory_order_acquire), 0),
+        static_cast<int>(kSlowURLSpecCapacity));
+    for (int i = 0; i < (stored_len + 7) / 8; i++)
+      words[i] = slot.spec[i].load(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+      continue;
+
+    if (slot_generation != generation)
+      return false;
+    sample->ticks = ticks;
+    sample->path = path;
+    sample->spec_len = spec_len;
+    sample->spec.assign(reinterpret_cast<const char*>(words), stored_len);
+    return true;
+  }
+  return false;
+}
+
+bool IsSlower(const SlowURLSample& a, const SlowURLSample& b) {
+  return a.ticks > b.ticks;
+}
+
+}  // namespace
+
+void ScopedSlowURLSample::Begin() {
+  SamplerThreadState* state = &sampler_state;
+  if (state->active || --state->countdown > 0)
+    return;  // Not picked, or nested in a call already being sampled.
+  int interval = slow_url_sample_interval.load(std::memory_order_relaxed);
+  if (interval <= 0)
+    return;
+  state->countdown = NextCountdown(state, interval);
+  state->active = true;
+  state->path = 0;
+  sampling_ = true;
+  start_ = ReadTicks();
+}
+
+void ScopedSlowURLSample::End(int path) {
+  // The TSC of another core may be behind, in case the thread moved.
+  unsigned long long end = ReadTicks();
+  unsigned long long ticks = end > start_ ? end - start_ : 0;
+  SamplerThreadState* state = &sampler_state;
+  path |= state->path;
+  if (spec16_)
+    path |= SLOW_URL_UTF16;
+  state->active = false;
+  sampling_ = false;
+  RecordSample(state, spec_, spec16_, spec_len_, ticks, path);
+}
+
+void ScopedSlowURLSample::Cancel() {
+  sampler_state.active = false;
+  sampling_ = false;
+}
+
+void NoteSlowURLPath(int path) {
+  SamplerThreadState* state = &sampler_state;
+  if (state->active)
+    state->path |= path;
+}
+
+void SetSlowURLSampling(int sample_interval, int max_samples) {
+  max_samples_per_thread.store(
+      std::max(1, std::min(max_samples, static_cast<int>(kMaxSlowURLSamples))),
+      std::memory_order_relaxed);
+  slow_url_sample_interval.store(std::max(sample_interval, 0),
+                                 std::memory_order_relaxed);
+  sample_generation.fetch_add(1, std::memory_order_release);
+}
+
+std::vector<SlowURLSample> GetSlowURLSamples() {
+  unsigned generation = sample_generation.load(std::memory_order_acquire);
+  std::vector<SlowURLSample> result;
+  SlowURLSample sample;
+  for (ThreadSamples* samples =
+           all_thread_samples.load(std::memory_order_acquire);
+       samples; samples = samples->next) {
+    for (int i = 0; i < kMaxSlowURLSamples; i++) {
+      if (ReadSample(samples->slots[i], generation, &sample))
+        result.push_back(sample);
+    }
+  }
+
+  std::stable_sort(result.begin(), result.end(), IsSlower);
+  size_t max_samples = static_cast<size_t>(
+      max_samples_per_thread.load(std::memory_order_relaxed));
+  if (result.size() > max_samples)
+    result.resize(max_samples);
+  return result;
+}
+
+void ResetSlowURLSamples() {
+  sample_generation.fetch_add(1, std::memory_order_release);
+}
+
+}  // namespace url_canon
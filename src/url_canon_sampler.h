@@ -0,0 +1,161 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// An opt-in sampler that finds the inputs url_util::Canonicalize (and so GURL
+// construction) is slowest on, for building benchmark corpora out of real
+// traffic. While it is off, which is the default, each call pays for one
+// relaxed atomic load.
+//
+// When on, one call in about every |sample_interval| on each thread is timed
+// with the cycle counter, and each thread keeps its slowest |max_samples|
+// inputs in a fixed buffer of its own. Recording takes no locks, and
+// GetSlowURLSamples() can be called from any thread while others record.
+
+#ifndef GOOGLEURL_SRC_URL_CANON_SAMPLER_H__
+#define GOOGLEURL_SRC_URL_CANON_SAMPLER_H__
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "googleurl/base/string16.h"
+#include "googleurl/src/url_common.h"
+
+namespace url_canon {
+
+// The most bytes of input kept per sample, and the most samples kept per
+// thread. Longer inputs are stored truncated, with their full length in
+// SlowURLSample::spec_len.
+enum {
+  kSlowURLSpecCapacity = 512,
+  kMaxSlowURLSamples = 64
+};
+
+// What a sampled call went through, as a bit mask. One of the first five says
+// how the scheme was canonicalized; the others are added when they apply.
+enum SlowURLPath {
+  SLOW_URL_STANDARD = 1 << 0,
+  SLOW_URL_FILE = 1 << 1,
+  SLOW_URL_FILESYSTEM = 1 << 2,
+  SLOW_URL_MAILTO = 1 << 3,
+  SLOW_URL_PATH = 1 << 4,
+
+  // A host with non-ASCII characters, which needs IDN conversion.
+  SLOW_URL_IDN = 1 << 5,
+
+  // A non-ASCII query converted with a CharsetConverter.
+  SLOW_URL_CHARSET = 1 << 6,
+
+  // The input was UTF-16. Its spec is stored converted to UTF-8.
+  SLOW_URL_UTF16 = 1 << 7
+};
+
+struct SlowURLSample {
+  SlowURLSample() : spec_len(0), ticks(0), path(0) {}
+
+  // The input, cut at kSlowURLSpecCapacity bytes, and its full length in
+  // input characters. UTF-16 input is converted to UTF-8 and cut at a
+  // character boundary.
+  std::string spec;
+  int spec_len;
+
+  // Time taken, in ticks of the cycle counter (TSC on x86, the virtual timer
+  // on ARM64, nanoseconds elsewhere). Ticks are only meant to be compared
+  // with each other within one process.
+  unsigned long long ticks;
+
+  // SlowURLPath bits.
+  int path;
+};
+
+// Turns sampling on, timing about one call in |sample_interval| per thread
+// and keeping the slowest |max_samples| (at most kMaxSlowURLSamples) of each
+// thread. A |sample_interval| of 0, the default, turns it off. Either way the
+// samples recorded so far are dropped.
+GURL_API void SetSlowURLSampling(int sample_interval, int max_samples);
+
+// Returns the slowest samples of all threads since sampling was last set or
+// reset, slowest first, and at most |max_samples| of them. Samples of threads
+// that have exited are included.
+GURL_API std::vector<SlowURLSample> GetSlowURLSamples();
+
+// Drops the samples recorded so far, leaving sampling on or off.
+GURL_API void ResetSlowURLSamples();
+
+// Adds SlowURLPath bits to the call being sampled on this thread, if any.
+GURL_API void NoteSlowURLPath(int path);
+
+GURL_API extern std::atomic<int> slow_url_sample_interval;
+
+// Samples the call that spans its lifetime, if it is picked. Finish() stops
+// the timer and records the sample.
+class GURL_API ScopedSlowURLSample {
+ public:
+  ScopedSlowURLSample(const char* spec, int spec_len)
+      : spec_(spec), spec16_(NULL), spec_len_(spec_len), sampling_(false) {
+    if (slow_url_sample_interval.load(std::memory_order_relaxed) != 0)
+      Begin();
+  }
+  ScopedSlowURLSample(const char16* spec, int spec_len)
+      : spec_(NULL), spec16_(spec), spec_len_(spec_len), sampling_(false) {
+    if (slow_url_sample_interval.load(std::memory_order_relaxed) != 0)
+      Begin();
+  }
+  ~ScopedSlowURLSample() {
+    if (sampling_)
+      Cancel();
+  }
+
+  // True if this call was picked. Callers use this to skip working out the
+  // |path| they pass to Finish().
+  bool sampling() const { return sampling_; }
+
+  void Finish(int path) {
+    if (sampling_)
+      End(path);
+  }
+
+ private:
+  void Begin();
+  void End(int path);
+  void Cancel();
+
+  const char* spec_;
+  const char16* spec16_;
+  int spec_len_;
+  bool sampling_;
+  unsigned long long start_;
+
+  ScopedSlowURLSample(const ScopedSlowURLSample&);
+  void operator=(const ScopedSlowURLSample&);
+};
+
+}  // namespace url_canon
+
+#endif  // GOOGLEURL_SRC_URL_CANON_SAMPLER_H__
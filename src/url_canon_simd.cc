@@ -0,0 +1,950 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "googleurl/src/url_canon_simd.h"
+
+#include "googleurl/src/url_canon_internal.h"
+
+#if !defined(GURL_NO_SIMD)
+#if defined(__SSE2__)
+#define URL_CANON_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// AVX2 kernels are compiled with a function-level target attribute so that
+// the rest of the library doesn't require AVX2, and used only when the CPU
+// reports support for it. Since the rest of the library is SSE code, they
+// must clear the upper halves of the registers before returning, or every
+// SSE instruction that follows pays for the transition.
+#define URL_CANON_AVX2 1
+#include <immintrin.h>
+#define URL_CANON_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define URL_CANON_NEON 1
+#include <arm_neon.h>
+#endif
+#endif  // !GURL_NO_SIMD
+
+namespace url_canon {
+
+namespace {
+
+// Scalar kernels --------------------------------------------------------------
+
+inline bool IsRemovableURLWhitespace(int ch) {
+  return ch == '\r' || ch == '\n' || ch == '\t';
+}
+
+template<typename CHAR>
+int FindRemovableURLWhitespaceScalar(const CHAR* input, int begin,
+                                     int input_len) {
+  for (int i = begin; i < input_len; i++) {
+    if (IsRemovableURLWhitespace(input[i]))
+      return i;
+  }
+  return input_len;
+}
+
+int FindRemovableURLWhitespace8Scalar(const char* input, int input_len) {
+  return FindRemovableURLWhitespaceScalar(input, 0, input_len);
+}
+
+int FindRemovableURLWhitespace16Scalar(const char16* input, int input_len) {
+  return FindRemovableURLWhitespaceScalar(input, 0, input_len);
+}
+
+// SSE2 kernels ----------------------------------------------------------------
+
+#if defined(URL_CANON_SSE2)
+
+int FindRemovableURLWhitespace8SSE2(const char* input, int input_len) {
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i lf = _mm_set1_epi8('\n');
+  const __m128i cr = _mm_set1_epi8('\r');
+  int i = 0;
+  for (; i + 16 <= input_len; i += 16) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+    __m128i found = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, tab), _mm_cmpeq_epi8(chunk, lf)),
+        _mm_cmpeq_epi8(chunk, cr));
+    int mask = _mm_movemask_epi8(found);
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+  return FindRemovableURLWhitespaceScalar(input, i, input_len);
+}
+
+int FindRemovableURLWhitespace16SSE2(const char16* input, int input_len) {
+  const __m128i tab = _mm_set1_epi16('\t');
+  const __m128i lf = _mm_set1_epi16('\n');
+  const __m128i cr = _mm_set1_epi16('\r');
+  int i = 0;
+  for (; i + 8 <= input_len; i += 8) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+    __m128i found = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi16(chunk, tab), _mm_cmpeq_epi16(chunk, lf)),
+        _mm_cmpeq_epi16(chunk, cr));
+    // Each matching 16-bit lane sets two adjacent bits of the byte mask.
+    int mask = _mm_movemask_epi8(found);
+    if (mask)
+      return i + __builtin_ctz(mask) / 2;
+  }
+  return FindRemovableURLWhitespaceScalar(input, i, input_len);
+}
+
+#endif  // URL_CANON_SSE2
+
+// AVX2 kernels ----------------------------------------------------------------
+
+#if defined(URL_CANON_AVX2)
+
+URL_CANON_TARGET_AVX2
+int FindRemovableURLWhitespace8AVX2(const char* input, int input_len) {
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  const __m256i cr = _mm256_set1_epi8('\r');
+  int i = 0;
+  for (; i + 32 <= input_len; i += 32) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+    __m256i found = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, tab),
+                        _mm256_cmpeq_epi8(chunk, lf)),
+        _mm256_cmpeq_epi8(chunk, cr));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(found));
+    if (mask) {
+      _mm256_zeroupper();
+      return i + __builtin_ctz(mask);
+    }
+  }
+  // Finish the tail with the 16-byte kernel, and then the scalar one.
+  _mm256_zeroupper();
+  return i + FindRemovableURLWhitespace8SSE2(input + i, input_len - i);
+}
+
+URL_CANON_TARGET_AVX2
+int FindRemovableURLWhitespace16AVX2(const char16* input, int input_len) {
+  const __m256i tab = _mm256_set1_epi16('\t');
+  const __m256i lf = _mm256_set1_epi16('\n');
+  const __m256i cr = _mm256_set1_epi16('\r');
+  int i = 0;
+  for (; i + 16 <= input_len; i += 16) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+    __m256i found = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi16(chunk, tab),
+                        _mm256_cmpeq_epi16(chunk, lf)),
+        _mm256_cmpeq_epi16(chunk, cr));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(found));
+    if (mask) {
+      _mm256_zeroupper();
+      return i + __builtin_ctz(mask) / 2;
+    }
+  }
+  _mm256_zeroupper();
+  return i + FindRemovableURLWhitespace16SSE2(input + i, input_len - i);
+}
+
+#endif  // URL_CANON_AVX2
+
+// NEON kernels ----------------------------------------------------------------
+
+#if defined(URL_CANON_NEON)
+
+int FindRemovableURLWhitespace8NEON(const char* input, int input_len) {
+  const uint8x16_t tab = vdupq_n_u8('\t');
+  const uint8x16_t lf = vdupq_n_u8('\n');
+  const uint8x16_t cr = vdupq_n_u8('\r');
+  int i = 0;
+  for (; i + 16 <= input_len; i += 16) {
+    uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(input + i));
+    uint8x16_t found = vorrq_u8(
+        vorrq_u8(vceqq_u8(chunk, tab), vceqq_u8(chunk, lf)),
+        vceqq_u8(chunk, cr));
+    if (vmaxvq_u8(found))
+      return FindRemovableURLWhitespaceScalar(input, i, i + 16);
+  }
+  return FindRemovableURLWhitespaceScalar(input, i, input_len);
+}
+
+int FindRemovableURLWhitespace16NEON(const char16* input, int input_len) {
+  const uint16x8_t tab = vdupq_n_u16('\t');
+  const uint16x8_t lf = vdupq_n_u16('\n');
+  const uint16x8_t cr = vdupq_n_u16('\r');
+  int i = 0;
+  for (; i + 8 <= input_len; i += 8) {
+    uint16x8_t chunk =
+        vld1q_u16(reinterpret_cast<const uint16_t*>(input + i));
+    uint16x8_t found = vorrq_u16(
+        vorrq_u16(vceqq_u16(chunk, tab), vceqq_u16(chunk, lf)),
+        vceqq_u16(chunk, cr));
+    if (vmaxvq_u16(found))
+      return FindRemovableURLWhitespaceScalar(input, i, i + 8);
+  }
+  return FindRemovableURLWhitespaceScalar(input, i, input_len);
+}
+
+#endif  // URL_CANON_NEON
+
+// Path kernels ----------------------------------------------------------------
+//
+// These must agree with the SPECIAL flag in kPathCharLookup, see the header.
+
+inline bool IsSpecialPathChar(unsigned ch) {
+  if (ch <= ' ' || ch >= 0x7f)
+    return true;
+  switch (ch) {
+    case '"': case '#': case '%': case '.': case '<': case '>': case '?':
+    case '\\': case '^': case '`': case '{': case '|': case '}':
+      return true;
+  }
+  return false;
+}
+
+template<typename CHAR, typename UCHAR>
+int FindSpecialPathCharScalar(const CHAR* input, int begin, int input_len) {
+  for (int i = begin; i < input_len; i++) {
+    if (IsSpecialPathChar(static_cast<UCHAR>(input[i])))
+      return i;
+  }
+  return input_len;
+}
+
+int FindSpecialPathChar8Scalar(const char* input, int input_len) {
+  return FindSpecialPathCharScalar<char, unsigned char>(input, 0, input_len);
+}
+
+int FindSpecialPathChar16Scalar(const char16* input, int input_len) {
+  return FindSpecialPathCharScalar<char16, char16>(input, 0, input_len);
+}
+
+#if defined(URL_CANON_SSE2)
+
+// Flags the special path characters in 16 bytes. The comparisons are signed,
+// so the characters with the high bit set fall into the "<= space" test.
+inline __m128i SpecialPathChars8SSE2(__m128i x) {
+  __m128i special = _mm_or_si128(_mm_cmplt_epi8(x, _mm_set1_epi8(0x21)),
+                                 _mm_cmpeq_epi8(x, _mm_set1_epi8(0x7f)));
+  // '"' and '#', '>' and '?', and '{' through '}' are contiguous.
+  special = _mm_or_si128(special, _mm_and_si128(
+      _mm_cmpgt_epi8(x, _mm_set1_epi8('"' - 1)),
+      _mm_cmplt_epi8(x, _mm_set1_epi8('#' + 1))));
+  special = _mm_or_si128(special, _mm_and_si128(
+      _mm_cmpgt_epi8(x, _mm_set1_epi8('>' - 1)),
+      _mm_cmplt_epi8(x, _mm_set1_epi8('?' + 1))));
+  special = _mm_or_si128(special, _mm_and_si128(
+      _mm_cmpgt_epi8(x, _mm_set1_epi8('{' - 1)),
+      _mm_cmplt_epi8(x, _mm_set1_epi8('}' + 1))));
+  special = _mm_or_si128(special, _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('%')),
+                   _mm_cmpeq_epi8(x, _mm_set1_epi8('.'))),
+      _mm_cmpeq_epi8(x, _mm_set1_epi8('<'))));
+  special = _mm_or_si128(special, _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\\')),
+                   _mm_cmpeq_epi8(x, _mm_set1_epi8('^'))),
+      _mm_cmpeq_epi8(x, _mm_set1_epi8('`'))));
+  return special;
+}
+
+// Same as above for 8 16-bit characters. Characters with the high bit set
+// are again caught by the signed "<= space" comparison, and everything else
+// from DEL up by the "> ~" one.
+inline __m128i SpecialPathChars16SSE2(__m128i x) {
+  __m128i special = _mm_or_si128(_mm_cmplt_epi16(x, _mm_set1_epi16(0x21)),
+                                 _mm_cmpgt_epi16(x, _mm_set1_epi16(0x7e)));
+  special = _mm_or_si128(special, _mm_and_si128(
+      _mm_cmpgt_epi16(x, _mm_set1_epi16('"' - 1)),
+      _mm_cmplt_epi16(x, _mm_set1_epi16('#' + 1))));
+  special = _mm_or_si128(special, _mm_and_si128(
+      _mm_cmpgt_epi16(x, _mm_set1_epi16('>' - 1)),
+      _mm_cmplt_epi16(x, _mm_set1_epi16('?' + 1))));
+  special = _mm_or_si128(special, _mm_and_si128(
+      _mm_cmpgt_epi16(x, _mm_set1_epi16('{' - 1)),
+      _mm_cmplt_epi16(x, _mm_set1_epi16('}' + 1))));
+  special = _mm_or_si128(special, _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi16(x, _mm_set1_epi16('%')),
+                   _mm_cmpeq_epi16(x, _mm_set1_epi16('.'))),
+      _mm_cmpeq_epi16(x, _mm_set1_epi16('<'))));
+  special = _mm_or_si128(special, _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi16(x, _mm_set1_epi16('\\')),
+                   _mm_cmpeq_epi16(x, _mm_set1_epi16('^'))),
+      _mm_cmpeq_epi16(x, _mm_set1_epi16('`'))));
+  return special;
+}
+
+int FindSpecialPathChar8SSE2(const char* input, int input_len) {
+  int i = 0;
+  for (; i + 16 <= input_len; i += 16) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+    int mask = _mm_movemask_epi8(SpecialPathChars8SSE2(chunk));
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+  return FindSpecialPathCharScalar<char, unsigned char>(input, i, input_len);
+}
+
+int FindSpecialPathChar16SSE2(const char16* input, int input_len) {
+  int i = 0;
+  for (; i + 8 <= input_len; i += 8) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+    int mask = _mm_movemask_epi8(SpecialPathChars16SSE2(chunk));
+    if (mask)
+      return i + __builtin_ctz(mask) / 2;
+  }
+  return FindSpecialPathCharScalar<char16, char16>(input, i, input_len);
+}
+
+#endif  // URL_CANON_SSE2
+
+#if defined(URL_CANON_NEON)
+
+inline uint8x16_t InRange8NEON(uint8x16_t x, uint8_t lo, uint8_t hi) {
+  return vcleq_u8(vsubq_u8(x, vdupq_n_u8(lo)), vdupq_n_u8(hi - lo));
+}
+
+int FindSpecialPathChar8NEON(const char* input, int input_len) {
+  int i = 0;
+  for (; i + 16 <= input_len; i += 16) {
+    uint8x16_t x = vld1q_u8(reinterpret_cast<const uint8_t*>(input + i));
+    uint8x16_t special = vorrq_u8(vcleq_u8(x, vdupq_n_u8(' ')),
+                                  vcgeq_u8(x, vdupq_n_u8(0x7f)));
+    special = vorrq_u8(special, InRange8NEON(x, '"', '#'));
+    special = vorrq_u8(special, InRange8NEON(x, '>', '?'));
+    special = vorrq_u8(special, InRange8NEON(x, '{', '}'));
+    special = vorrq_u8(special, vceqq_u8(x, vdupq_n_u8('%')));
+    special = vorrq_u8(special, vceqq_u8(x, vdupq_n_u8('.')));
+    special = vorrq_u8(special, vceqq_u8(x, vdupq_n_u8('<')));
+    special = vorrq_u8(special, vceqq_u8(x, vdupq_n_u8('\\')));
+    special = vorrq_u8(special, vceqq_u8(x, vdupq_n_u8('^')));
+    special = vorrq_u8(special, vceqq_u8(x, vdupq_n_u8('`')));
+    if (vmaxvq_u8(special)) {
+      return FindSpecialPathCharScalar<char, unsigned char>(input, i,
+                                                            i + 16);
+    }
+  }
+  return FindSpecialPathCharScalar<char, unsigned char>(input, i, input_len);
+}
+
+#endif  // URL_CANON_NEON
+
+// Escape kernels --------------------------------------------------------------
+//
+// The component kernels must agree with CHAR_COMPONENT in kSharedCharTypeTable:
+// the ASCII letters and digits and "!'()*-._~".
+
+int FindPercentScalar(const char* input, int begin, int input_len) {
+  for (int i = begin; i < input_len; i++) {
+    if (input[i] == '%')
+      return i;
+  }
+  return input_len;
+}
+
+int FindPercent8Scalar(const char* input, int input_len) {
+  return FindPercentScalar(input, 0, input_len);
+}
+
+int FindNonComponentCharScalar(const char* input, int begin, int input_len) {
+  for (int i = begin; i < input_len; i++) {
+    if (!IsComponentChar(static_cast<unsigned char>(input[i])))
+      return i;
+  }
+  return input_len;
+}
+
+int FindNonComponentChar8Scalar(const char* input, int input_len) {
+  return FindNonComponentCharScalar(input, 0, input_len);
+}
+
+#if defined(URL_CANON_SSE2)
+
+inline __m128i InRange8SSE2(__m128i x, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(lo - 1)),
+                       _mm_cmplt_epi8(x, _mm_set1_epi8(hi + 1)));
+}
+
+// Flags the component characters in 16 bytes. The comparisons are signed, so
+// the characters with the high bit set are in none of the ranges.
+inline __m128i ComponentChars8SSE2(__m128i x) {
+  __m128i ok = _mm_or_si128(InRange8SSE2(x, 'a', 'z'),
+                            InRange8SSE2(x, 'A', 'Z'));
+  ok = _mm_or_si128(ok, InRange8SSE2(x, '0', '9'));
+  // "'()*" and "-." are contiguous.
+  ok = _mm_or_si128(ok, InRange8SSE2(x, '\'', '*'));
+  ok = _mm_or_si128(ok, InRange8SSE2(x, '-', '.'));
+  ok = _mm_or_si128(ok, _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('!')),
+                   _mm_cmpeq_epi8(x, _mm_set1_epi8('_'))),
+      _mm_cmpeq_epi8(x, _mm_set1_epi8('~'))));
+  return ok;
+}
+
+int FindPercent8SSE2(const char* input, int input_len) {
+  const __m128i percent = _mm_set1_epi8('%');
+  int i = 0;
+  for (; i + 16 <= input_len; i += 16) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, percent));
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+  return FindPercentScalar(input, i, input_len);
+}
+
+int FindNonComponentChar8SSE2(const char* input, int input_len) {
+  int i = 0;
+  for (; i + 16 <= input_len; i += 16) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+    int mask = _mm_movemask_epi8(ComponentChars8SSE2(chunk)) ^ 0xffff;
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+  return FindNonComponentCharScalar(input, i, input_len);
+}
+
+#endif  // URL_CANON_SSE2
+
+#if defined(URL_CANON_AVX2)
+
+URL_CANON_TARGET_AVX2
+int FindPercent8AVX2(const char* input, int input_len) {
+  const __m256i percent = _mm256_set1_epi8('%');
+  int i = 0;
+  for (; i + 32 <= input_len; i += 32) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+    unsigned mask = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, percent)));
+    if (mask) {
+      _mm256_zeroupper();
+      return i + __builtin_ctz(mask);
+    }
+  }
+  _mm256_zeroupper();
+  return i + FindPercent8SSE2(input + i, input_len - i);
+}
+
+#endif  // URL_CANON_AVX2
+
+#if defined(URL_CANON_NEON)
+
+int FindPercent8NEON(const char* input, int input_len) {
+  const uint8x16_t percent = vdupq_n_u8('%');
+  int i = 0;
+  for (; i + 16 <= input_len; i += 16) {
+    uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(input + i));
+    if (vmaxvq_u8(vceqq_u8(chunk, percent)))
+      return FindPercentScalar(input, i, i + 16);
+  }
+  return FindPercentScalar(input, i, input_len);
+}
+
+int FindNonComponentChar8NEON(const char* input, int input_len) {
+  int i = 0;
+  for (; i + 16 <= input_len; i += 16) {
+    uint8x16_t x = vld1q_u8(reinterpret_cast<const uint8_t*>(input + i));
+    uint8x16_t ok = vorrq_u8(InRange8NEON(x, 'a', 'z'),
+                             InRange8NEON(x, 'A', 'Z'));
+    ok = vorrq_u8(ok, InRange8NEON(x, '0', '9'));
+    ok = vorrq_u8(ok, InRange8NEON(x, '\'', '*'));
+    ok = vorrq_u8(ok, InRange8NEON(x, '-', '.'));
+    ok = vorrq_u8(ok, vceqq_u8(x, vdupq_n_u8('!')));
+    ok = vorrq_u8(ok, vceqq_u8(x, vdupq_n_u8('_')));
+    ok = vorrq_u8(ok, vceqq_u8(x, vdupq_n_u8('~')));
+    if (vminvq_u8(ok) == 0)
+      return FindNonComponentCharScalar(input, i, i + 16);
+  }
+  return FindNonComponentCharScalar(input, i, input_len);
+}
+
+#endif  // URL_CANON_NEON
+
+// Host kernels ----------------------------------------------------------------
+//
+// These must agree with kHostCharLookup in url_canon_host.cc: the characters
+// it maps to themselves or to their lowercase version, see the header. The
+// vector versions finish with one block that overlaps the previous one rather
+// than leaving the last partial block to the scalar code, since hosts are
+// short and rarely a multiple of the block size. Rewriting the overlap is
+// harmless because it produces the same bytes.
+
+inline bool IsSimpleHostChar(unsigned ch) {
+  if ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'z')
+    return true;
+  if (ch >= '0' && ch <= '9')
+    return true;
+  switch (ch) {
+    case '+': case '-': case '.': case ':': case '[': case ']': case '_':
+      return true;
+  }
+  return false;
+}
+
+template<typename CHAR, typename UCHAR>
+int LowerSimpleHostCharsScalar(const CHAR* input, int begin, int input_len,
+                               char* output) {
+  for (int i = begin; i < input_len; i++) {
+    UCHAR ch = static_cast<UCHAR>(input[i]);
+    if (ch >= 0x80 || !IsSimpleHostChar(ch))
+      return i;
+    output[i] = static_cast<char>(ch >= 'A' && ch <= 'Z' ? ch | 0x20 : ch);
+  }
+  return input_len;
+}
+
+int LowerSimpleHostChars8Scalar(const char* input, int input_len,
+                                char* output) {
+  return LowerSimpleHostCharsScalar<char, unsigned char>(input, 0, input_len,
+                                                         output);
+}
+
+int LowerSimpleHostChars16Scalar(const char16* input, int input_len,
+                                 char* output) {
+  return LowerSimpleHostCharsScalar<char16, char16>(input, 0, input_len,
+                                                    output);
+}
+
+#if defined(URL_CANON_SSE2)
+
+// Lowercases the letters in 16 bytes and returns the mask of the simple host
+// characters among them. As for the component characters, the signed
+// comparisons keep the bytes with the high bit set out of every range.
+inline int SimpleHostChars8SSE2(__m128i x, __m128i* lowered) {
+  const __m128i case_bit = _mm_set1_epi8(0x20);
+  __m128i alpha = InRange8SSE2(_mm_or_si128(x, case_bit), 'a', 'z');
+  *lowered = _mm_or_si128(x, _mm_and_si128(alpha, case_bit));
+  // The digits and ':' are contiguous, and so are "-.".
+  __m128i ok = _mm_or_si128(alpha, InRange8SSE2(x, '0', ':'));
+  ok = _mm_or_si128(ok, InRange8SSE2(x, '-', '.'));
+  ok = _mm_or_si128(ok, _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('+')),
+                   _mm_cmpeq_epi8(x, _mm_set1_epi8('['))),
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(']')),
+                   _mm_cmpeq_epi8(x, _mm_set1_epi8('_')))));
+  return _mm_movemask_epi8(ok);
+}
+
+// Lowers the 16 characters at |offset| and returns the index of the first one
+// that is not a simple host character, or -1 if they all are.
+inline int LowerSimpleHostBlock8SSE2(const char* input, int offset,
+                                     char* output) {
+  __m128i lowered;
+  int mask = SimpleHostChars8SSE2(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + offset)),
+      &lowered);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(output + offset), lowered);
+  mask ^= 0xffff;
+  return mask ? offset + __builtin_ctz(mask) : -1;
+}
+
+// Same for 16 wide characters. The unsigned saturation of the pack turns the
+// ones above 0xff into 0xff, which is not a host character either.
+inline int LowerSimpleHostBlock16SSE2(const char16* input, int offset,
+                                      char* output) {
+  const __m128i* src = reinterpret_cast<const __m128i*>(input + offset);
+  __m128i lowered;
+  int mask = SimpleHostChars8SSE2(
+      _mm_packus_epi16(_mm_loadu_si128(src), _mm_loadu_si128(src + 1)),
+      &lowered);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(output + offset), lowered);
+  mask ^= 0xffff;
+  return mask ? offset + __builtin_ctz(mask) : -1;
+}
+
+int LowerSimpleHostChars8SSE2(const char* input, int input_len,
+                              char* output) {
+  if (input_len < 16) {
+    return LowerSimpleHostCharsScalar<char, unsigned char>(input, 0,
+                                                           input_len, output);
+  }
+  int i = 0;
+  for (; i + 16 <= input_len; i += 16) {
+    int stop = LowerSimpleHostBlock8SSE2(input, i, output);
+    if (stop >= 0)
+      return stop;
+  }
+  if (i < input_len) {
+    int stop = LowerSimpleHostBlock8SSE2(input, input_len - 16, output);
+    if (stop >= 0)
+      return stop;
+  }
+  return input_len;
+}
+
+int LowerSimpleHostChars16SSE2(const char16* input, int input_len,
+                               char* output) {
+  if (input_len < 16) {
+    return LowerSimpleHostCharsScalar<char16, char16>(input, 0, input_len,
+                                                      output);
+  }
+  int i = 0;
+  for (; i + 16 <= input_len; i += 16) {
+    int stop = LowerSimpleHostBlock16SSE2(input, i, output);
+    if (stop >= 0)
+      return stop;
+  }
+  if (i < input_len) {
+    int stop = LowerSimpleHostBlock16SSE2(input, input_len - 16, output);
+    if (stop >= 0)
+      return stop;
+  }
+  return input_len;
+}
+
+#endif  // URL_CANON_SSE2
+
+#if defined(URL_CANON_AVX2)
+
+URL_CANON_TARGET_AVX2
+inline __m256i InRange8AVX2(__m256i x, char lo, char hi) {
+  return _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8(lo - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), x));
+}
+
+URL_CANON_TARGET_AVX2
+int LowerSimpleHostChars8AVX2(const char* input, int input_len,
+                              char* output) {
+  const __m256i case_bit = _mm256_set1_epi8(0x20);
+  int i = 0;
+  for (; i + 32 <= input_len; i += 32) {
+    __m256i x =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+    __m256i alpha = InRange8AVX2(_mm256_or_si256(x, case_bit), 'a', 'z');
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i),
+                        _mm256_or_si256(x, _mm256_and_si256(alpha, case_bit)));
+    __m256i ok = _mm256_or_si256(alpha, InRange8AVX2(x, '0', ':'));
+    ok = _mm256_or_si256(ok, InRange8AVX2(x, '-', '.'));
+    ok = _mm256_or_si256(ok, _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('+')),
+                        _mm256_cmpeq_epi8(x, _mm256_set1_epi8('['))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(']')),
+                        _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_')))));
+    unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(ok));
+    if (mask) {
+      _mm256_zeroupper();
+      return i + __builtin_ctz(mask);
+    }
+  }
+  _mm256_zeroupper();
+  if (i == input_len)
+    return input_len;
+  // The rest is shorter than a block: finish with 16 byte ones, overlapping
+  // the part already done if that is needed to fill the last one.
+  int tail = input_len - i < 16 ? input_len - 16 : i;
+  if (tail < 0) {
+    return LowerSimpleHostCharsScalar<char, unsigned char>(input, i,
+                                                           input_len, output);
+  }
+  return tail + LowerSimpleHostChars8SSE2(input + tail, input_len - tail,
+                                          output + tail);
+}
+
+#endif  // URL_CANON_AVX2
+
+#if defined(URL_CANON_NEON)
+
+inline uint8x16_t LowerSimpleHostBlock8NEON(uint8x16_t x, uint8x16_t* ok) {
+  const uint8x16_t case_bit = vdupq_n_u8(0x20);
+  uint8x16_t alpha = InRange8NEON(vorrq_u8(x, case_bit), 'a', 'z');
+  uint8x16_t found = vorrq_u8(alpha, InRange8NEON(x, '0', ':'));
+  found = vorrq_u8(found, InRange8NEON(x, '-', '.'));
+  found = vorrq_u8(found, vceqq_u8(x, vdupq_n_u8('+')));
+  found = vorrq_u8(found, vceqq_u8(x, vdupq_n_u8('[')));
+  found = vorrq_u8(found, vceqq_u8(x, vdupq_n_u8(']')));
+  found = vorrq_u8(found, vceqq_u8(x, vdupq_n_u8('_')));
+  *ok = found;
+  return vorrq_u8(x, vandq_u8(alpha, case_bit));
+}
+
+int LowerSimpleHostChars8NEON(const char* input, int input_len,
+                              char* output) {
+  if (input_len < 16) {
+    return LowerSimpleHostCharsScalar<char, unsigned char>(input, 0,
+                                                           input_len, output);
+  }
+  int i = 0;
+  while (i < input_len) {
+    // Overlap the last block with the previous one, as for SSE2.
+    if (i + 16 > input_len)
+      i = input_len - 16;
+    uint8x16_t ok;
+    uint8x16_t lowered = LowerSimpleHostBlock8NEON(
+        vld1q_u8(reinterpret_cast<const uint8_t*>(input + i)), &ok);
+    if (vminvq_u8(ok) == 0) {
+      return LowerSimpleHostCharsScalar<char, unsigned char>(input, i,
+                                                             i + 16, output);
+    }
+    vst1q_u8(reinterpret_cast<uint8_t*>(output + i), lowered);
+    i += 16;
+  }
+  return input_len;
+}
+
+#endif  // URL_CANON_NEON
+
+// Delimiter kernels -----------------------------------------------------------
+//
+// These must agree with the characters the standard URL parser looks for, see
+// the header. The vector versions classify 64 bytes at a time and leave the
+// final partial block to the scalar one.
+
+inline bool IsURLDelimiter(char ch) {
+  switch (ch) {
+    case ':': case '/': case '\\': case '?': case '#': case '@': case ']':
+      return true;
+  }
+  return false;
+}
+
+// |begin| must be a multiple of 64.
+void MarkURLDelimitersScalar(const char* input, int begin, int input_len,
+                             uint64_t* mask) {
+  for (int block = begin; block < input_len; block += 64) {
+    int block_len = input_len - block < 64 ? input_len - block : 64;
+    uint64_t bits = 0;
+    for (int i = 0; i < block_len; i++) {
+      if (IsURLDelimiter(input[block + i]))
+        bits |= static_cast<uint64_t>(1) << i;
+    }
+    mask[block / 64] = bits;
+  }
+}
+
+void MarkURLDelimiters8Scalar(const char* input, int input_len,
+                              uint64_t* mask) {
+  MarkURLDelimitersScalar(input, 0, input_len, mask);
+}
+
+#if defined(URL_CANON_SSE2)
+
+inline uint64_t URLDelimiters16SSE2(const char* input) {
+  __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+  __m128i found = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(':')),
+                   _mm_cmpeq_epi8(x, _mm_set1_epi8('/'))),
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\\')),
+                   _mm_cmpeq_epi8(x, _mm_set1_epi8('?'))));
+  found = _mm_or_si128(found, _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('#')),
+                   _mm_cmpeq_epi8(x, _mm_set1_epi8('@'))),
+      _mm_cmpeq_epi8(x, _mm_set1_epi8(']'))));
+  return static_cast<unsigned>(_mm_movemask_epi8(found));
+}
+
+void MarkURLDelimiters8SSE2(const char* input, int input_len,
+                            uint64_t* mask) {
+  int block = 0;
+  for (; block + 64 <= input_len; block += 64) {
+    mask[block / 64] = URLDelimiters16SSE2(input + block) |
+                       URLDelimiters16SSE2(input + block + 16) << 16 |
+                       URLDelimiters16SSE2(input + block + 32) << 32 |
+                       URLDelimiters16SSE2(input + block + 48) << 48;
+  }
+  MarkURLDelimitersScalar(input, block, input_len, mask);
+}
+
+#endif  // URL_CANON_SSE2
+
+#if defined(URL_CANON_AVX2)
+
+URL_CANON_TARGET_AVX2
+inline uint64_t URLDelimiters32AVX2(const char* input) {
+  __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input));
+  __m256i found = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(':')),
+                      _mm256_cmpeq_epi8(x, _mm256_set1_epi8('/'))),
+      _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\')),
+                      _mm256_cmpeq_epi8(x, _mm256_set1_epi8('?'))));
+  found = _mm256_or_si256(found, _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('#')),
+                      _mm256_cmpeq_epi8(x, _mm256_set1_epi8('@'))),
+      _mm256_cmpeq_epi8(x, _mm256_set1_epi8(']'))));
+  return static_cast<unsigned>(_mm256_movemask_epi8(found));
+}
+
+URL_CANON_TARGET_AVX2
+void MarkURLDelimiters8AVX2(const char* input, int input_len,
+                            uint64_t* mask) {
+  int block = 0;
+  for (; block + 64 <= input_len; block += 64) {
+    mask[block / 64] = URLDelimiters32AVX2(input + block) |
+                       URLDelimiters32AVX2(input + block + 32) << 32;
+  }
+  _mm256_zeroupper();
+  MarkURLDelimitersScalar(input, block, input_len, mask);
+}
+
+#endif  // URL_CANON_AVX2
+
+#if defined(URL_CANON_NEON)
+
+inline uint8x16_t URLDelimiters16NEON(const char* input) {
+  uint8x16_t x = vld1q_u8(reinterpret_cast<const uint8_t*>(input));
+  uint8x16_t found = vorrq_u8(vceqq_u8(x, vdupq_n_u8(':')),
+                              vceqq_u8(x, vdupq_n_u8('/')));
+  found = vorrq_u8(found, vceqq_u8(x, vdupq_n_u8('\\')));
+  found = vorrq_u8(found, vceqq_u8(x, vdupq_n_u8('?')));
+  found = vorrq_u8(found, vceqq_u8(x, vdupq_n_u8('#')));
+  found = vorrq_u8(found, vceqq_u8(x, vdupq_n_u8('@')));
+  found = vorrq_u8(found, vceqq_u8(x, vdupq_n_u8(']')));
+  return found;
+}
+
+void MarkURLDelimiters8NEON(const char* input, int input_len,
+                            uint64_t* mask) {
+  // NEON has no movemask: give each lane of a group of eight its own bit,
+  // then three rounds of pairwise adds pack the 64 lanes into 64 bits.
+  static const uint8_t kBits[16] = {
+    1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+  const uint8x16_t bits = vld1q_u8(kBits);
+  int block = 0;
+  for (; block + 64 <= input_len; block += 64) {
+    uint8x16_t b0 = vandq_u8(URLDelimiters16NEON(input + block), bits);
+    uint8x16_t b1 = vandq_u8(URLDelimiters16NEON(input + block + 16), bits);
+    uint8x16_t b2 = vandq_u8(URLDelimiters16NEON(input + block + 32), bits);
+    uint8x16_t b3 = vandq_u8(URLDelimiters16NEON(input + block + 48), bits);
+    uint8x16_t sum = vpaddq_u8(vpaddq_u8(b0, b1), vpaddq_u8(b2, b3));
+    sum = vpaddq_u8(sum, sum);
+    mask[block / 64] = vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+  }
+  MarkURLDelimitersScalar(input, block, input_len, mask);
+}
+
+#endif  // URL_CANON_NEON
+
+// Dispatch --------------------------------------------------------------------
+
+// The kernels selected for the running CPU.
+struct Kernels {
+  int (*find_whitespace8)(const char*, int);
+  int (*find_whitespace16)(const char16*, int);
+  int (*find_special_path8)(const char*, int);
+  int (*find_special_path16)(const char16*, int);
+  int (*find_percent8)(const char*, int);
+  int (*find_non_component8)(const char*, int);
+  int (*lower_simple_host8)(const char*, int, char*);
+  int (*lower_simple_host16)(const char16*, int, char*);
+  void (*mark_delimiters8)(const char*, int, uint64_t*);
+};
+
+Kernels SelectKernels() {
+  Kernels kernels;
+  kernels.find_whitespace8 = &FindRemovableURLWhitespace8Scalar;
+  kernels.find_whitespace16 = &FindRemovableURLWhitespace16Scalar;
+  kernels.find_special_path8 = &FindSpecialPathChar8Scalar;
+  kernels.find_special_path16 = &FindSpecialPathChar16Scalar;
+  kernels.find_percent8 = &FindPercent8Scalar;
+  kernels.find_non_component8 = &FindNonComponentChar8Scalar;
+  kernels.lower_simple_host8 = &LowerSimpleHostChars8Scalar;
+  kernels.lower_simple_host16 = &LowerSimpleHostChars16Scalar;
+  kernels.mark_delimiters8 = &MarkURLDelimiters8Scalar;
+#if defined(URL_CANON_SSE2)
+  kernels.find_whitespace8 = &FindRemovableURLWhitespace8SSE2;
+  kernels.find_whitespace16 = &FindRemovableURLWhitespace16SSE2;
+  kernels.find_special_path8 = &FindSpecialPathChar8SSE2;
+  kernels.find_special_path16 = &FindSpecialPathChar16SSE2;
+  kernels.find_percent8 = &FindPercent8SSE2;
+  kernels.find_non_component8 = &FindNonComponentChar8SSE2;
+  kernels.lower_simple_host8 = &LowerSimpleHostChars8SSE2;
+  kernels.lower_simple_host16 = &LowerSimpleHostChars16SSE2;
+  kernels.mark_delimiters8 = &MarkURLDelimiters8SSE2;
+#endif
+#if defined(URL_CANON_AVX2)
+  if (__builtin_cpu_supports("avx2")) {
+    kernels.find_whitespace8 = &FindRemovableURLWhitespace8AVX2;
+    kernels.find_whitespace16 = &FindRemovableURLWhitespace16AVX2;
+    kernels.find_percent8 = &FindPercent8AVX2;
+    kernels.lower_simple_host8 = &LowerSimpleHostChars8AVX2;
+    kernels.mark_delimiters8 = &MarkURLDelimiters8AVX2;
+  }
+#endif
+#if defined(URL_CANON_NEON)
+  kernels.find_whitespace8 = &FindRemovableURLWhitespace8NEON;
+  kernels.find_whitespace16 = &FindRemovableURLWhitespace16NEON;
+  kernels.find_special_path8 = &FindSpecialPathChar8NEON;
+  kernels.find_percent8 = &FindPercent8NEON;
+  kernels.find_non_component8 = &FindNonComponentChar8NEON;
+  kernels.lower_simple_host8 = &LowerSimpleHostChars8NEON;
+  kernels.mark_delimiters8 = &MarkURLDelimiters8NEON;
+#endif
+  return kernels;
+}
+
+// The selection is done once, the first time any kernel is needed. Function
+// local statics are initialized in a threadsafe manner.
+const Kernels& GetKernels() {
+  static const Kernels kernels = SelectKernels();
+  return kernels;
+}
+
+}  // namespace
+
+int FindRemovableURLWhitespace(const char* input, int input_len) {
+  return GetKernels().find_whitespace8(input, input_len);
+}
+
+int FindRemovableURLWhitespace(const char16* input, int input_len) {
+  return GetKernels().find_whitespace16(input, input_len);
+}
+
+int FindSpecialPathChar(const char* input, int input_len) {
+  return GetKernels().find_special_path8(input, input_len);
+}
+
+int FindSpecialPathChar(const char16* input, int input_len) {
+  return GetKernels().find_special_path16(input, input_len);
+}
+
+int FindPercent(const char* input, int input_len) {
+  return GetKernels().find_percent8(input, input_len);
+}
+
+int FindNonComponentChar(const char* input, int input_len) {
+  return GetKernels().find_non_component8(input, input_len);
+}
+
+int LowerSimpleHostChars(const char* input, int input_len, char* output) {
+  return GetKernels().lower_simple_host8(input, input_len, output);
+}
+
+int LowerSimpleHostChars(const char16* input, int input_len, char* output) {
+  return GetKernels().lower_simple_host16(input, input_len, output);
+}
+
+void MarkURLDelimiters(const char* input, int input_len, uint64_t* mask) {
+  GetKernels().mark_delimiters8(input, input_len, mask);
+}
+
+}  // namespace url_canon
@@ -0,0 +1,85 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Vectorized scanning kernels used by the parser and the canonicalizers. Each
+// function has a portable scalar implementation plus SSE2, AVX2 and NEON
+// versions where the compiler supports them; the best one for the running CPU
+// is selected the first time it is needed. Define GURL_NO_SIMD to build only
+// the scalar code.
+
+#ifndef GOOGLEURL_SRC_URL_CANON_SIMD_H__
+#define GOOGLEURL_SRC_URL_CANON_SIMD_H__
+
+#include <stdint.h>
+
+#include "googleurl/base/string16.h"
+
+namespace url_canon {
+
+// Returns the index of the first tab, newline or carriage return in the
+// given input, or |input_len| if there is none.
+int FindRemovableURLWhitespace(const char* input, int input_len);
+int FindRemovableURLWhitespace(const char16* input, int input_len);
+
+// Returns the index of the first character that the path canonicalizer has to
+// look at (one with the SPECIAL flag in url_canon_path.cc), or |input_len| if
+// there is none. These are the control characters and space, DEL and
+// everything above it, and "\"#%.<>?\\^`{|}". Everything else is copied to
+// the output unchanged.
+int FindSpecialPathChar(const char* input, int input_len);
+int FindSpecialPathChar(const char16* input, int input_len);
+
+// Returns the index of the first '%' in the given input, or |input_len| if
+// there is none.
+int FindPercent(const char* input, int input_len);
+
+// Returns the index of the first character that encodeURIComponent has to
+// escape (one without the CHAR_COMPONENT flag), or |input_len| if there is
+// none.
+int FindNonComponentChar(const char* input, int input_len);
+
+// Copies the leading run of |input| that the host canonicalizer would keep
+// unchanged except for case to |output|, lowercased, and returns its length.
+// These are the ASCII letters and digits and "+-.:[]_" (the characters that
+// kHostCharLookup in url_canon_host.cc maps to themselves or their lowercase
+// version). |output| must have room for |input_len| characters; the ones
+// past the returned length may be overwritten.
+int LowerSimpleHostChars(const char* input, int input_len, char* output);
+int LowerSimpleHostChars(const char16* input, int input_len, char* output);
+
+// Sets bit (i % 64) of |mask[i / 64]| for every position i of the input that
+// holds one of the delimiters the standard URL parser splits on,
+// ":/\\?#@]", and clears all the others. |mask| must have room for
+// (input_len + 63) / 64 words; the bits past the end of the input in the last
+// word are cleared.
+void MarkURLDelimiters(const char* input, int input_len, uint64_t* mask);
+
+}  // namespace url_canon
+
+#endif  // GOOGLEURL_SRC_URL_CANON_SIMD_H__
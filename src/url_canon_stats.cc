@@ -0,0 +1,72 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "googleurl/src/url_canon_stats.h"
+
+namespace url_canon {
+
+#ifdef GURL_ENABLE_CANON_STATS
+
+std::atomic<unsigned long long> canon_stats[CANON_STAT_COUNT];
+
+CanonStats GetCanonStats() {
+  CanonStats stats;
+#define LOAD_STAT(name) \
+  stats.name = canon_stats[CANON_STAT_##name].load(std::memory_order_relaxed)
+  LOAD_STAT(output_grows);
+  LOAD_STAT(fixed_buffer_spills);
+  LOAD_STAT(complex_hosts);
+  LOAD_STAT(complex_host_ns);
+  LOAD_STAT(idn_conversions);
+  LOAD_STAT(idn_ns);
+  LOAD_STAT(charset_conversions);
+  LOAD_STAT(charset_conversion_ns);
+  LOAD_STAT(whitespace_copies);
+  LOAD_STAT(path_backtracks);
+#undef LOAD_STAT
+  return stats;
+}
+
+void ResetCanonStats() {
+  for (int i = 0; i < CANON_STAT_COUNT; i++)
+    canon_stats[i].store(0, std::memory_order_relaxed);
+}
+
+#else
+
+CanonStats GetCanonStats() {
+  return CanonStats();
+}
+
+void ResetCanonStats() {
+}
+
+#endif  // GURL_ENABLE_CANON_STATS
+
+}  // namespace url_canon
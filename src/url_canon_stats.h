@@ -0,0 +1,145 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Optional counters for the expensive paths of the canonicalizer, meant for
+// sizing buffers and finding pathological inputs. They are compiled in only
+// when GURL_ENABLE_CANON_STATS is defined for the whole build; otherwise the
+// recording macros expand to nothing and GetCanonStats() returns all zeros.
+
+#ifndef GOOGLEURL_SRC_URL_CANON_STATS_H__
+#define GOOGLEURL_SRC_URL_CANON_STATS_H__
+
+#include "googleurl/src/url_common.h"
+
+#ifdef GURL_ENABLE_CANON_STATS
+#include <atomic>
+#include <chrono>
+#endif
+
+namespace url_canon {
+
+// Counts and times summed over all threads since the last reset. Times are in
+// nanoseconds of wall clock.
+struct CanonStats {
+  CanonStats()
+      : output_grows(0),
+        fixed_buffer_spills(0),
+        complex_hosts(0),
+        complex_host_ns(0),
+        idn_conversions(0),
+        idn_ns(0),
+        charset_conversions(0),
+        charset_conversion_ns(0),
+        whitespace_copies(0),
+        path_backtracks(0) {
+  }
+
+  // Times a CanonOutput had to grow its buffer, and how many of those moved a
+  // RawCanonOutputT off its fixed stack buffer onto the heap.
+  unsigned long long output_grows;
+  unsigned long long fixed_buffer_spills;
+
+  // Hosts that needed unescaping or non-ASCII handling, and the time spent
+  // canonicalizing them. Hits in the IDN host cache are not included.
+  unsigned long long complex_hosts;
+  unsigned long long complex_host_ns;
+
+  // Calls to the IDN (punycode) conversion, and the time spent in it.
+  unsigned long long idn_conversions;
+  unsigned long long idn_ns;
+
+  // Non-ASCII queries run through a CharsetConverter, and the time spent in
+  // the converter.
+  unsigned long long charset_conversions;
+  unsigned long long charset_conversion_ns;
+
+  // Inputs that contained tabs or newlines and so had to be copied to remove
+  // them.
+  unsigned long long whitespace_copies;
+
+  // ".." path segments that removed a directory from the output.
+  unsigned long long path_backtracks;
+};
+GURL_API CanonStats GetCanonStats();
+GURL_API void ResetCanonStats();
+
+#ifdef GURL_ENABLE_CANON_STATS
+
+enum CanonStat {
+  CANON_STAT_output_grows,
+  CANON_STAT_fixed_buffer_spills,
+  CANON_STAT_complex_hosts,
+  CANON_STAT_complex_host_ns,
+  CANON_STAT_idn_conversions,
+  CANON_STAT_idn_ns,
+  CANON_STAT_charset_conversions,
+  CANON_STAT_charset_conversion_ns,
+  CANON_STAT_whitespace_copies,
+  CANON_STAT_path_backtracks,
+  CANON_STAT_COUNT
+};
+
+GURL_API extern std::atomic<unsigned long long> canon_stats[CANON_STAT_COUNT];
+
+inline void AddCanonStat(CanonStat stat, unsigned long long value) {
+  canon_stats[stat].fetch_add(value, std::memory_order_relaxed);
+}
+
+// Adds the time from construction to destruction to the given stat.
+class ScopedCanonStatTimer {
+ public:
+  explicit ScopedCanonStatTimer(CanonStat stat)
+      : stat_(stat), start_(std::chrono::steady_clock::now()) {
+  }
+  ~ScopedCanonStatTimer() {
+    AddCanonStat(stat_, std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_).count());
+  }
+
+ private:
+  CanonStat stat_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+#define CANON_STAT_INCREMENT(name) \
+    url_canon::AddCanonStat(url_canon::CANON_STAT_##name, 1)
+#define CANON_STAT_SCOPED_TIMER(name) \
+    url_canon::ScopedCanonStatTimer canon_stat_timer_##name( \
+        url_canon::CANON_STAT_##name)
+
+#else
+
+#define CANON_STAT_INCREMENT(name) ((void)0)
+#define CANON_STAT_SCOPED_TIMER(name) ((void)0)
+
+#endif  // GURL_ENABLE_CANON_STATS
+
+}  // namespace url_canon
+
+#endif  // GOOGLEURL_SRC_URL_CANON_STATS_H__
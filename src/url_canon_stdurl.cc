@@ -32,6 +32,8 @@
 
 #include "googleurl/src/url_canon.h"
 #include "googleurl/src/url_canon_internal.h"
+#include "googleurl/src/url_canon_simd.h"
+#include "googleurl/src/url_parse_internal.h"
 
 namespace url_canon {
 
@@ -114,6 +116,204 @@ bool DoCanonicalizeStandardURL(const URLComponentSource<CHAR>& source,
   return success;
 }
 
+// The host characters the single pass canonicalizer handles itself: the ones
+// DoSimpleHost writes as themselves or their lower case, except for the
+// brackets and colon of IPv6 literals.
+inline bool IsPlainHostChar(unsigned ch) {
+  return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+      (ch >= '0' && ch <= '9') || ch == '-' || ch == '.' || ch == '_' ||
+      ch == '+';
+}
+
+// Finds the end of the component starting at |begin| that runs up to the first
+// of the given delimiters, or |end|.
+template<typename CHAR>
+int FindComponentEnd(const CHAR* spec, int begin, int end,
+                     char delimiter1, char delimiter2) {
+  while (begin < end && spec[begin] != delimiter1 && spec[begin] != delimiter2)
+    begin++;
+  return begin;
+}
+
+// Writes the canonical form of the standard URL in |spec| in one forward pass,
+// doing what ParseStandardURL and DoCanonicalizeStandardURL do together. Runs
+// of characters that need no work are found and copied straight to the
+// output; the uncommon cases within a component with known bounds (dot
+// segments, escaping, IPv4 addresses) are handed to the same component
+// canonicalizers DoCanonicalizeStandardURL uses. Anything that would take
+// deciding about the URL as a whole (user info, IPv6 literals, invalid
+// components) makes this rewind the output and return false.
+template<typename CHAR, typename UCHAR>
+bool DoFusedCanonicalizeStandardURL(const CHAR* spec,
+                                    int spec_len,
+                                    const url_parse::Component& scheme,
+                                    CharsetConverter* query_converter,
+                                    CanonOutput* output,
+                                    url_parse::Parsed* new_parsed) {
+  const int output_begin = output->length();
+
+  // The parser ignores trailing spaces and control characters. The colon after
+  // the scheme stops this.
+  int end = spec_len;
+  while (end > scheme.end() && url_parse::ShouldTrimFromURL(spec[end - 1]))
+    end--;
+
+  // Scheme, followed by the authority separators whatever slashes (if any)
+  // the input has.
+  new_parsed->scheme = url_parse::Component(output_begin, scheme.len);
+  for (int i = scheme.begin; i < scheme.end(); i++) {
+    char ch = CanonicalSchemeChar(spec[i]);
+    if (!ch) {
+      output->set_length(output_begin);
+      return false;
+    }
+    output->push_back(ch);
+  }
+  output->Append("://", 3);
+  int cur = scheme.end() + 1;
+  while (cur < end && url_parse::IsURLSlash(spec[cur]))
+    cur++;
+
+  new_parsed->username.reset();
+  new_parsed->password.reset();
+
+  // Host, which must be followed by a port or the end of the authority.
+  int host_begin = cur;
+  bool all_ipv4_chars = true;
+  while (cur < end && static_cast<UCHAR>(spec[cur]) < 0x80 &&
+         IsPlainHostChar(static_cast<unsigned char>(spec[cur]))) {
+    all_ipv4_chars &= IsIPv4Char(static_cast<unsigned char>(spec[cur]));
+    cur++;
+  }
+  if (cur == host_begin ||
+      (cur < end && spec[cur] != ':' &&
+       !url_parse::IsAuthorityTerminator(spec[cur]))) {
+    output->set_length(output_begin);
+    return false;
+  }
+  int host_out_begin = output->length();
+  char* dest = output->ReserveSpan(cur - host_begin);
+  if (!dest) {
+    output->set_length(output_begin);
+    return false;
+  }
+  for (int i = host_begin; i < cur; i++) {
+    unsigned char ch = static_cast<unsigned char>(spec[i]);
+    dest[i - host_begin] = (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch;
+  }
+  output->CommitSpan(cur - host_begin);
+  if (all_ipv4_chars) {
+    // This may be an IPv4 address, which DoHost rewrites the same way.
+    RawCanonOutput<64> canon_ip;
+    CanonHostInfo host_info;
+    CanonicalizeIPAddress(output->data(),
+                          url_parse::MakeRange(host_out_begin,
+                                               output->length()),
+                          &canon_ip, &host_info);
+    if (host_info.family == CanonHostInfo::BROKEN) {
+      output->set_length(output_begin);
+      return false;
+    }
+    if (host_info.IsIPAddress()) {
+      output->set_length(host_out_begin);
+      output->Append(canon_ip.data(), canon_ip.length());
+    }
+  }
+  new_parsed->host = url_parse::MakeRange(host_out_begin, output->length());
+
+  // Port: only digits, so that the colon found is the last one.
+  if (cur < end && spec[cur] == ':') {
+    int port_begin = ++cur;
+    while (cur < end && spec[cur] >= '0' && spec[cur] <= '9')
+      cur++;
+    int default_port = DefaultPortForScheme(
+        &output->data()[new_parsed->scheme.begin], new_parsed->scheme.len);
+    if ((cur < end && !url_parse::IsAuthorityTerminator(spec[cur])) ||
+        !CanonicalizePort(spec, url_parse::MakeRange(port_begin, cur),
+                          default_port, output, &new_parsed->port)) {
+      output->set_length(output_begin);
+      return false;
+    }
+  } else {
+    new_parsed->port.reset();
+  }
+
+  // Path, up to the first '?' or '#'. The cases of DoPartialPath that only
+  // copy characters are done here, which includes a dot that doesn't follow a
+  // slash; it takes over from the first character that needs more.
+  if (cur < end && url_parse::IsURLSlash(spec[cur])) {
+    new_parsed->path.begin = output->length();
+    while (cur < end) {
+      int run_end = cur + FindSpecialPathChar(&spec[cur], end - cur);
+      AppendASCIIRun(&spec[cur], run_end - cur, output);
+      cur = run_end;
+      if (cur == end || spec[cur] == '?' || spec[cur] == '#')
+        break;
+      if (spec[cur] == '.' && output->at(output->length() - 1) != '/') {
+        output->push_back('.');
+        cur++;
+        continue;
+      }
+      int path_end = FindComponentEnd(spec, cur, end, '?', '#');
+      if (!CanonicalizePartialPath(spec, url_parse::MakeRange(cur, path_end),
+                                   new_parsed->path.begin, output)) {
+        output->set_length(output_begin);
+        return false;
+      }
+      cur = path_end;
+      break;
+    }
+    new_parsed->path.len = output->length() - new_parsed->path.begin;
+  } else {
+    // No path, or one that is only a query or ref: make up a slash.
+    new_parsed->path = url_parse::Component(output->length(), 1);
+    output->push_back('/');
+  }
+
+  // Query, up to the first '#'. Only a query of characters that are copied
+  // unchanged is done here.
+  if (cur < end && spec[cur] == '?') {
+    int query_begin = ++cur;
+    while (cur < end && static_cast<UCHAR>(spec[cur]) < 0x80 &&
+           IsQueryChar(static_cast<unsigned char>(spec[cur])))
+      cur++;
+    if (cur < end && spec[cur] != '#') {
+      cur = FindComponentEnd(spec, cur, end, '#', '#');
+      CanonicalizeQuery(spec, url_parse::MakeRange(query_begin, cur),
+                        query_converter, output, &new_parsed->query);
+    } else {
+      output->push_back('?');
+      new_parsed->query.begin = output->length();
+      AppendASCIIRun(&spec[query_begin], cur - query_begin, output);
+      new_parsed->query.len = output->length() - new_parsed->query.begin;
+    }
+  } else {
+    new_parsed->query.reset();
+  }
+
+  // Ref, the rest of the input. As in DoCanonicalizeRef, printable ASCII is
+  // copied unchanged.
+  if (cur < end) {
+    DCHECK(spec[cur] == '#');
+    int ref_begin = ++cur;
+    while (cur < end && static_cast<UCHAR>(spec[cur]) >= 0x20 &&
+           static_cast<UCHAR>(spec[cur]) < 0x80)
+      cur++;
+    if (cur < end) {
+      CanonicalizeRef(spec, url_parse::MakeRange(ref_begin, end), output,
+                      &new_parsed->ref);
+    } else {
+      output->push_back('#');
+      new_parsed->ref.begin = output->length();
+      AppendASCIIRun(&spec[ref_begin], end - ref_begin, output);
+      new_parsed->ref.len = output->length() - new_parsed->ref.begin;
+    }
+  } else {
+    new_parsed->ref.reset();
+  }
+  return true;
+}
+
 }  // namespace
 
 
@@ -170,6 +370,89 @@ bool CanonicalizeStandardURL(const char16* spec,
       output, new_parsed);
 }
 
+bool FusedCanonicalizeStandardURL(const char* spec,
+                                  int spec_len,
+                                  const url_parse::Component& scheme,
+                                  CharsetConverter* query_converter,
+                                  CanonOutput* output,
+                                  url_parse::Parsed* new_parsed) {
+  return DoFusedCanonicalizeStandardURL<char, unsigned char>(
+      spec, spec_len, scheme, query_converter, output, new_parsed);
+}
+
+bool FusedCanonicalizeStandardURL(const char16* spec,
+                                  int spec_len,
+                                  const url_parse::Component& scheme,
+                                  CharsetConverter* query_converter,
+                                  CanonOutput* output,
+                                  url_parse::Parsed* new_parsed) {
+  return DoFusedCanonicalizeStandardURL<char16, char16>(
+      spec, spec_len, scheme, query_converter, output, new_parsed);
+}
+
+bool IsCanonicalStandardURL(const char* spec,
+                            int spec_len,
+                            const url_parse::Parsed& parsed) {
+  // Walk the components in the order DoCanonicalizeStandardURL writes them,
+  // checking that each one starts right where its canonical version would.
+  if (parsed.scheme.begin != 0 || !IsCanonicalScheme(spec, parsed.scheme))
+    return false;
+  int cur = parsed.scheme.end();
+  if (spec_len - cur < 3 || spec[cur] != ':' ||
+      spec[cur + 1] != '/' || spec[cur + 2] != '/')
+    return false;
+  cur += 3;
+
+  if (parsed.username.is_valid() || parsed.password.is_valid()) {
+    if (!IsCanonicalUserInfo(spec, parsed.username, parsed.password) ||
+        parsed.username.begin != cur)
+      return false;
+    cur = parsed.username.end();
+    if (parsed.password.is_valid()) {
+      if (parsed.password.begin != cur + 1 || spec[cur] != ':')
+        return false;
+      cur = parsed.password.end();
+    }
+    if (cur >= spec_len || spec[cur] != '@')
+      return false;
+    cur++;
+  }
+
+  if (parsed.host.begin != cur || !IsCanonicalHost(spec, parsed.host))
+    return false;
+  cur = parsed.host.end();
+
+  if (parsed.port.is_valid()) {
+    if (parsed.port.begin != cur + 1 || spec[cur] != ':' ||
+        !IsCanonicalPort(spec, parsed.port,
+                         DefaultPortForScheme(&spec[parsed.scheme.begin],
+                                              parsed.scheme.len)))
+      return false;
+    cur = parsed.port.end();
+  }
+
+  if (parsed.path.begin != cur || !IsCanonicalPath(spec, parsed.path))
+    return false;
+  cur = parsed.path.end();
+
+  if (parsed.query.is_valid()) {
+    if (parsed.query.begin != cur + 1 || spec[cur] != '?' ||
+        !IsCanonicalQuery(spec, parsed.query))
+      return false;
+    cur = parsed.query.end();
+  }
+
+  if (parsed.ref.is_valid()) {
+    if (parsed.ref.begin != cur + 1 || spec[cur] != '#' ||
+        !IsCanonicalRef(spec, parsed.ref))
+      return false;
+    cur = parsed.ref.end();
+  }
+
+  // Anything left over was trimmed by the parser.
+  return cur == spec_len;
+}
+
 // It might be nice in the future to optimize this so unchanged components don't
 // need to be recanonicalized. This is especially true since the common case for
 // ReplaceComponents is removing things we don't want, like reference fragments
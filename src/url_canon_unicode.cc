@@ -0,0 +1,326 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "googleurl/src/url_canon_unicode.h"
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "googleurl/base/logging.h"
+#include "googleurl/src/url_canon_internal.h"
+
+#if !defined(GURL_NO_ICU)
+#include "googleurl/src/url_canon_icu.h"
+#endif
+
+namespace url_canon {
+
+namespace {
+
+// Punycode parameters, from RFC 3492.
+const uint32_t kPunycodeBase = 36;
+const uint32_t kPunycodeTMin = 1;
+const uint32_t kPunycodeTMax = 26;
+const uint32_t kPunycodeSkew = 38;
+const uint32_t kPunycodeDamp = 700;
+const uint32_t kPunycodeInitialBias = 72;
+const uint32_t kPunycodeInitialN = 0x80;
+
+// IDNA rejects labels longer than this, once encoded.
+const int kMaxLabelLen = 63;
+
+char PunycodeDigit(uint32_t digit) {
+  return static_cast<char>(digit < 26 ? 'a' + digit : '0' + digit - 26);
+}
+
+uint32_t AdaptPunycodeBias(uint32_t delta, uint32_t num_points,
+                           bool first_time) {
+  delta = first_time ? delta / kPunycodeDamp : delta / 2;
+  delta += delta / num_points;
+  uint32_t k = 0;
+  while (delta > ((kPunycodeBase - kPunycodeTMin) * kPunycodeTMax) / 2) {
+    delta /= kPunycodeBase - kPunycodeTMin;
+    k += kPunycodeBase;
+  }
+  return k + (kPunycodeBase - kPunycodeTMin + 1) * delta /
+             (delta + kPunycodeSkew);
+}
+
+// Appends the Punycode encoding of the given code points, without the "xn--"
+// prefix, to |output|. Returns false if the encoding would overflow, which
+// only happens for far longer labels than IDNA accepts.
+bool AppendPunycode(const uint32_t* input, int input_len,
+                    CanonOutputW* output) {
+  uint32_t basic_count = 0;
+  for (int i = 0; i < input_len; i++) {
+    if (input[i] < 0x80) {
+      output->push_back(static_cast<char16>(input[i]));
+      basic_count++;
+    }
+  }
+  if (basic_count > 0)
+    output->push_back('-');
+
+  uint32_t n = kPunycodeInitialN;
+  uint32_t delta = 0;
+  uint32_t bias = kPunycodeInitialBias;
+  for (uint32_t handled = basic_count;
+       handled < static_cast<uint32_t>(input_len); ) {
+    // The smallest code point not handled yet.
+    uint32_t m = UINT32_MAX;
+    for (int i = 0; i < input_len; i++) {
+      if (input[i] >= n && input[i] < m)
+        m = input[i];
+    }
+    if (m - n > (UINT32_MAX - delta) / (handled + 1))
+      return false;
+    delta += (m - n) * (handled + 1);
+    n = m;
+
+    for (int i = 0; i < input_len; i++) {
+      if (input[i] < n && ++delta == 0)
+        return false;
+      if (input[i] != n)
+        continue;
+
+      // Write |delta| as a variable length integer.
+      uint32_t q = delta;
+      for (uint32_t k = kPunycodeBase; ; k += kPunycodeBase) {
+        uint32_t t = k <= bias ? kPunycodeTMin :
+            k >= bias + kPunycodeTMax ? kPunycodeTMax : k - bias;
+        if (q < t)
+          break;
+        output->push_back(PunycodeDigit(t + (q - t) % (kPunycodeBase - t)));
+        q = (q - t) / (kPunycodeBase - t);
+      }
+      output->push_back(PunycodeDigit(q));
+      bias = AdaptPunycodeBias(delta, handled + 1, handled == basic_count);
+      delta = 0;
+      handled++;
+    }
+    delta++;
+    n++;
+  }
+  return true;
+}
+
+inline char ToLowerASCII(char c) {
+  return (c >= 'A' && c <= 'Z') ? (c + ('a' - 'A')) : c;
+}
+
+// Returns true for the usual names of UTF-8, compared ASCII case-insensitively.
+bool IsUTF8CharsetName(const char* name) {
+  static const char* const kNames[] = { "utf-8", "utf8" };
+  for (size_t i = 0; i < arraysize(kNames); i++) {
+    const char* expected = kNames[i];
+    const char* actual = name;
+    while (*expected && ToLowerASCII(*actual) == *expected) {
+      expected++;
+      actual++;
+    }
+    if (!*expected && !*actual)
+      return true;
+  }
+  return false;
+}
+
+// The label separators IDNA recognizes: '.' and the ideographic, fullwidth
+// and halfwidth ideographic full stops.
+bool IsLabelSeparator(char16 ch) {
+  return ch == '.' || ch == 0x3002 || ch == 0xff0e || ch == 0xff61;
+}
+
+// Appends the ASCII form of one label, see GetBuiltinUnicodeBackend.
+bool AppendASCIILabel(const char16* label, int label_len,
+                      CanonOutputW* output) {
+  // Decode the label and lowercase its ASCII letters. Labels IDNA accepts
+  // are short, so this rarely needs the heap.
+  RawCanonOutputT<uint32_t, kMaxLabelLen> code_points;
+  bool is_ascii = true;
+  for (int i = 0; i < label_len; i++) {
+    unsigned code_point;
+    if (!ReadUTFChar(label, &i, label_len, &code_point) ||
+        code_point == kUnicodeReplacementCharacter)
+      return false;
+    if (code_point >= 'A' && code_point <= 'Z')
+      code_point += 'a' - 'A';
+    is_ascii &= code_point < 0x80;
+    code_points.push_back(code_point);
+  }
+
+  int label_begin = output->length();
+  if (is_ascii) {
+    for (int i = 0; i < code_points.length(); i++)
+      output->push_back(static_cast<char16>(code_points.data()[i]));
+  } else {
+    static const char16 kPrefix[] = { 'x', 'n', '-', '-' };
+    output->Append(kPrefix, arraysize(kPrefix));
+    if (!AppendPunycode(code_points.data(), code_points.length(), output))
+      return false;
+  }
+  return output->length() - label_begin <= kMaxLabelLen;
+}
+
+class BuiltinUnicodeBackend : public UnicodeBackend {
+ public:
+  virtual bool NameToASCII(const char16* src, int src_len,
+                           CanonOutputW* output) {
+    int label_begin = 0;
+    for (int i = 0; i <= src_len; i++) {
+      if (i < src_len && !IsLabelSeparator(src[i]))
+        continue;
+      // Only the root label, after a final dot, may be empty.
+      if (i == label_begin && i < src_len)
+        return false;
+      if (!AppendASCIILabel(&src[label_begin], i - label_begin, output))
+        return false;
+      if (i < src_len)
+        output->push_back('.');
+      label_begin = i + 1;
+    }
+    return true;
+  }
+
+  virtual CharsetConverter* GetThreadCharsetConverter(
+      const char* charset_name) {
+    if (!charset_name)
+      return NULL;
+    if (!IsUTF8CharsetName(charset_name))
+      return NULL;
+    static UTF8CharsetConverter converter;
+    return &converter;
+  }
+
+ private:
+  // Writes UTF-8 with the invalid characters replaced, like ICU's UTF-8
+  // converter. It has no state, so one is shared by all threads.
+  class UTF8CharsetConverter : public CharsetConverter {
+   public:
+    virtual void ConvertFromUTF16(const char16* input, int input_len,
+                                  CanonOutput* output) {
+      ConvertUTF16ToUTF8(input, input_len, output);
+    }
+
+    virtual void ConvertFromUTF8(const char* input, int input_len,
+                                 CanonOutput* output) {
+      for (int i = 0; i < input_len; i++) {
+        unsigned code_point;
+        ReadUTFChar(input, &i, input_len, &code_point);
+        AppendUTF8Value(code_point, output);
+      }
+    }
+  };
+};
+
+UnicodeBackend* GetDefaultUnicodeBackend() {
+#if defined(GURL_NO_ICU)
+  return GetBuiltinUnicodeBackend();
+#else
+  return GetICUUnicodeBackend();
+#endif
+}
+
+std::atomic<UnicodeBackend*> unicode_backend(NULL);
+
+// Returns true if the given host label would come out of IDNA unchanged except
+// for case, which the host canonicalizer takes care of afterwards. This is any
+// nonempty ASCII label that isn't too long and isn't already punycode (which
+// IDNA validates). A dot means this is more than one label.
+bool IsPlainASCIILabel(const char16* label, int label_len) {
+  if (label_len == 0 || label_len > kMaxLabelLen)
+    return false;
+  for (int i = 0; i < label_len; i++) {
+    if (label[i] >= 0x80 || label[i] == '.')
+      return false;
+  }
+  return !(label_len >= 4 &&
+           (label[0] | 0x20) == 'x' && (label[1] | 0x20) == 'n' &&
+           label[2] == '-' && label[3] == '-');
+}
+
+}  // namespace
+
+UnicodeBackend* GetUnicodeBackend() {
+  UnicodeBackend* backend = unicode_backend.load(std::memory_order_acquire);
+  return backend ? backend : GetDefaultUnicodeBackend();
+}
+
+void SetUnicodeBackend(UnicodeBackend* backend) {
+  unicode_backend.store(backend, std::memory_order_release);
+}
+
+UnicodeBackend* GetBuiltinUnicodeBackend() {
+  static BuiltinUnicodeBackend backend;
+  return &backend;
+}
+
+CharsetConverter* GetThreadCharsetConverter(const char* charset_name) {
+  return GetUnicodeBackend()->GetThreadCharsetConverter(charset_name);
+}
+
+bool IDNToASCII(const char16* src, int src_len, CanonOutputW* output) {
+  DCHECK(output->length() == 0);  // Output buffer is assumed empty.
+
+  // Labels at either end that don't need IDNA are copied directly, and only
+  // the span between them goes to the backend. For a host like
+  // "shop.<idn>.jp" this keeps "shop." and ".jp" away from ICU entirely.
+  int idna_begin = 0;
+  for (;;) {
+    int dot = idna_begin;
+    while (dot < src_len && src[dot] != '.')
+      dot++;
+    if (dot == src_len ||
+        !IsPlainASCIILabel(&src[idna_begin], dot - idna_begin))
+      break;
+    idna_begin = dot + 1;
+  }
+  int idna_end = src_len;
+  while (idna_end > idna_begin) {
+    int dot = idna_end - 1;
+    while (dot >= idna_begin && src[dot] != '.')
+      dot--;
+    if (dot < idna_begin ||
+        !IsPlainASCIILabel(&src[dot + 1], idna_end - dot - 1))
+      break;
+    idna_end = dot;
+  }
+
+  if (IsPlainASCIILabel(&src[idna_begin], idna_end - idna_begin))
+    idna_end = idna_begin;  // The one label left doesn't need IDNA either.
+
+  output->Append(src, idna_begin);
+  if (idna_end > idna_begin &&
+      !GetUnicodeBackend()->NameToASCII(&src[idna_begin],
+                                        idna_end - idna_begin, output))
+    return false;
+  output->Append(&src[idna_end], src_len - idna_end);
+  return true;
+}
+
+}  // namespace url_canon
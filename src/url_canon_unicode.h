@@ -0,0 +1,93 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// The pluggable source of the Unicode services that canonicalization can't do
+// on its own: IDNA for hosts and conversions to legacy character sets.
+//
+// UTF-8 and UTF-16 are always handled by the library itself. A build with ICU
+// uses the ICU backend from url_canon_icu.h by default; a build with
+// GURL_NO_ICU defined (GOOGLEURL_NO_ICU=1 with googleurl.mk) doesn't link ICU
+// at all and uses the built-in backend below. Either way, the backend is only
+// reached for hosts that aren't plain ASCII and for explicit converter
+// lookups, so ICU isn't touched by programs that never see those.
+
+#ifndef GOOGLEURL_SRC_URL_CANON_UNICODE_H__
+#define GOOGLEURL_SRC_URL_CANON_UNICODE_H__
+
+#include "googleurl/src/url_canon.h"
+
+namespace url_canon {
+
+class UnicodeBackend {
+ public:
+  virtual ~UnicodeBackend() {}
+
+  // Converts the given host name, or the span of its labels that are not
+  // plain ASCII, to ASCII with IDNA and appends the result to |output|.
+  // IDNToASCII has already copied the plain ASCII labels around the span, so
+  // this is only called for hosts that need it. Returns false if the name is
+  // invalid, in which case the output is undefined.
+  virtual bool NameToASCII(const char16* src, int src_len,
+                           CanonOutputW* output) = 0;
+
+  // Returns a converter to the given character set for use on the calling
+  // thread, or NULL if the backend doesn't know it. See
+  // GetThreadCharsetConverter.
+  virtual CharsetConverter* GetThreadCharsetConverter(
+      const char* charset_name) = 0;
+};
+
+// Returns the backend in use.
+GURL_API UnicodeBackend* GetUnicodeBackend();
+
+// Installs the given backend, which must stay alive for as long as it is in
+// use, or the default one if |backend| is NULL. This is not synchronized with
+// canonicalization on other threads, and the IDN host cache isn't flushed, so
+// it should be called once on startup.
+GURL_API void SetUnicodeBackend(UnicodeBackend* backend);
+
+// Returns the built-in backend, which needs no data. Its IDNA encodes the
+// labels that aren't ASCII with Punycode as they are: it lowercases ASCII
+// letters and maps the ideographic full stops to '.', but doesn't do the rest
+// of the UTS #46 mapping and normalization, and doesn't check labels that are
+// already Punycode. It gives the same result as ICU for valid hosts that are
+// already in that form, such as the ones of canonical URLs decoded for
+// display, and a different but still well-formed one for the others. The only
+// character set it converts to is UTF-8.
+GURL_API UnicodeBackend* GetBuiltinUnicodeBackend();
+
+// Returns a converter to the given character set from the backend in use,
+// or NULL if it doesn't know it. With ICU, this can be any name or alias ICU
+// knows, such as "Shift_JIS" or "gbk". The converter belongs to the calling
+// thread, which keeps one per name for as long as it runs, and must only be
+// used on that thread.
+GURL_API CharsetConverter* GetThreadCharsetConverter(const char* charset_name);
+
+}  // namespace url_canon
+
+#endif  // GOOGLEURL_SRC_URL_CANON_UNICODE_H__
@@ -0,0 +1,130 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "googleurl/src/url_domain_set.h"
+
+namespace url_util {
+
+namespace {
+
+// ASCII-specific tolower. The standard library's tolower is locale sensitive,
+// so we don't want to use it here.
+inline char ToLowerASCII(char c) {
+  return (c >= 'A' && c <= 'Z') ? (c + ('a' - 'A')) : c;
+}
+
+}  // namespace
+
+DomainSet::DomainSet() {
+}
+
+DomainSet::~DomainSet() {
+}
+
+int DomainSet::Add(const char* domain, int domain_len) {
+  if (domain_len <= 0)
+    return -1;
+
+  // The domains and host suffixes are hashed from their last character to
+  // their first, so that the hashes of all the suffixes of a host come out of
+  // a single scan from its end.
+  std::string lower(domain, domain_len);
+  uint64_t hash = kFNVBasis;
+  for (int i = domain_len - 1; i >= 0; i--) {
+    lower[i] = ToLowerASCII(lower[i]);
+    hash = FNVHashStep(hash, lower[i]);
+  }
+
+  bool trailing_dot = lower[domain_len - 1] == '.';
+  int existing = Lookup(hash, lower.data(), domain_len, trailing_dot);
+  if (existing >= 0)
+    return existing;
+
+  Entry entry;
+  entry.hash = hash;
+  entry.offset = static_cast<int>(domains_.size());
+  entry.len = domain_len;
+  entry.trailing_dot = trailing_dot;
+  domains_.append(lower);
+  return entries_.Add(entry);
+}
+
+int DomainSet::FindMatch(const char* host, int host_len) const {
+  if (host_len <= 0 || entries_.empty())
+    return -1;
+
+  if (host[host_len - 1] != '.')
+    return FindSuffix(host, host_len, false);
+
+  // A trailing dot on the host is kept for domains ending with a dot, and
+  // ignored for the others.
+  int with_dot = FindSuffix(host, host_len, true);
+  int without_dot = FindSuffix(host, host_len - 1, false);
+  if (with_dot < 0)
+    return without_dot;
+  if (without_dot < 0 ||
+      entries_.entry(with_dot).len < entries_.entry(without_dot).len)
+    return with_dot;
+  return without_dot;
+}
+
+int DomainSet::Lookup(uint64_t hash, const char* suffix, int suffix_len,
+                      bool trailing_dot) const {
+  for (HashTable<Entry>::Probe probe(entries_, hash); !probe.done();
+       probe.Next()) {
+    const Entry& entry = probe.entry();
+    if (entry.len != suffix_len || entry.trailing_dot != trailing_dot)
+      continue;
+    const char* domain = &domains_[entry.offset];
+    int i = 0;
+    while (i < suffix_len && ToLowerASCII(suffix[i]) == domain[i])
+      i++;
+    if (i == suffix_len)
+      return probe.index();
+  }
+  return -1;
+}
+
+int DomainSet::FindSuffix(const char* host, int host_len,
+                          bool trailing_dot) const {
+  // A domain can only match a suffix starting at the beginning of the host,
+  // at a dot (for domains starting with a dot) or just after one.
+  uint64_t hash = kFNVBasis;
+  for (int i = host_len - 1; i >= 0; i--) {
+    hash = FNVHashStep(hash, ToLowerASCII(host[i]));
+    if (i == 0 || host[i] == '.' || host[i - 1] == '.') {
+      int found = Lookup(hash, &host[i], host_len - i, trailing_dot);
+      if (found >= 0)
+        return found;
+    }
+  }
+  return -1;
+}
+
+}  // namespace url_util
@@ -0,0 +1,123 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef GOOGLEURL_SRC_URL_DOMAIN_SET_H__
+#define GOOGLEURL_SRC_URL_DOMAIN_SET_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "googleurl/base/string_piece.h"
+#include "googleurl/src/url_common.h"
+#include "googleurl/src/url_parse.h"
+#include "googleurl/src/url_util_internal.h"
+
+namespace url_util {
+
+// A set of domains compiled for checking whether a host is equal to or a
+// subdomain of any of them, with the same rules as url_util::DomainIs (and so
+// GURL::DomainIs) applied to each domain in turn. A lookup scans the host once
+// from the end, so it costs time proportional to the length of the host no
+// matter how many domains are in the set.
+//
+// Domains are compared ASCII case-insensitively. A domain starting with a dot
+// matches any host ending with it, and a trailing dot on the host is ignored
+// unless the domain also ends with one, exactly like DomainIs.
+//
+// Adding domains is not threadsafe, but once built, a set can be used for
+// lookups from any number of threads.
+class DomainSet {
+ public:
+  GURL_API DomainSet();
+  GURL_API ~DomainSet();
+
+  // Adds the given domain, which need not be NULL terminated. Empty domains
+  // are ignored, since DomainIs never matches them, and adding a domain that
+  // is already in the set does nothing. Returns the index of the domain.
+  GURL_API int Add(const char* domain, int domain_len);
+  int Add(const char* domain) {
+    return Add(domain, static_cast<int>(strlen(domain)));
+  }
+
+  // The number of distinct domains in the set.
+  int size() const {
+    return static_cast<int>(entries_.size());
+  }
+
+  // The domain at the given index, which must be in [0, size()), lower-cased.
+  base::StringPiece domain(int i) const {
+    const Entry& entry = entries_.entry(i);
+    return base::StringPiece(&domains_[entry.offset], entry.len);
+  }
+
+  // Returns the index of a domain that the given host is equal to or a
+  // subdomain of, or -1 if there is none. When several domains match, the
+  // shortest one is returned: "com" rather than "google.com".
+  GURL_API int FindMatch(const char* host, int host_len) const;
+
+  // Returns true if the host is equal to or a subdomain of any domain in the
+  // set. This is the same as DomainIs returning true for any of them.
+  bool Matches(const char* host, int host_len) const {
+    return FindMatch(host, host_len) >= 0;
+  }
+
+  // Same as above for the host at the given component of a spec, usually
+  // the host of a parsed canonical URL.
+  bool Matches(const char* spec, const url_parse::Component& host) const {
+    return host.len > 0 && FindMatch(&spec[host.begin], host.len) >= 0;
+  }
+
+ private:
+  struct Entry {
+    uint64_t hash;
+    int offset;  // In domains_.
+    int len;
+    bool trailing_dot;
+  };
+
+  // Returns the index of the entry for the given suffix of a host, which has
+  // the given hash, or -1 if there is none. Only entries whose trailing dot
+  // matches |trailing_dot| are considered.
+  int Lookup(uint64_t hash, const char* suffix, int suffix_len,
+             bool trailing_dot) const;
+
+  // Scans |host| from the end for suffixes that are in the set.
+  int FindSuffix(const char* host, int host_len, bool trailing_dot) const;
+
+  // The lower-cased domains, one after the other.
+  std::string domains_;
+  HashTable<Entry> entries_;
+};
+
+}  // namespace url_util
+
+#endif  // GOOGLEURL_SRC_URL_DOMAIN_SET_H__
@@ -0,0 +1,214 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "googleurl/src/url_parallel.h"
+
+#include <algorithm>
+
+#include "googleurl/base/logging.h"
+
+namespace url_util {
+
+struct ParallelCanonicalizer::Worker {
+  Worker() : converter(NULL) {}
+  ~Worker() { delete converter; }
+
+  url_canon::CharsetConverter* converter;  // Owned, may be NULL.
+
+  // The output of every shard this worker did in the current batch, one after
+  // the other.
+  url_canon::RawCanonOutput<4096> output;
+};
+
+const int ParallelCanonicalizer::kShardSize;
+
+ParallelCanonicalizer::ParallelCanonicalizer(
+    int num_threads,
+    CharsetConverterFactory* converter_factory)
+    : inputs_(NULL),
+      inputs16_(NULL),
+      input_count_(0),
+      results_(NULL),
+      next_shard_(0),
+      generation_(0),
+      busy_threads_(0),
+      stopping_(false) {
+  if (num_threads < 1)
+    num_threads = 1;
+  for (int i = 0; i < num_threads; i++) {
+    Worker* worker = new Worker;
+    if (converter_factory)
+      worker->converter = converter_factory->CreateConverter();
+    workers_.push_back(worker);
+  }
+  // Worker 0 is the calling thread.
+  for (int i = 1; i < num_threads; i++)
+    threads_.push_back(std::thread(&ParallelCanonicalizer::WorkerLoop, this, i));
+}
+
+ParallelCanonicalizer::~ParallelCanonicalizer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_ready_.notify_all();
+  for (size_t i = 0; i < threads_.size(); i++)
+    threads_[i].join();
+  for (size_t i = 0; i < workers_.size(); i++)
+    delete workers_[i];
+}
+
+int ParallelCanonicalizer::Canonicalize(const BatchInput* inputs,
+                                        int input_count,
+                                        url_canon::CanonOutput* output,
+                                        BatchResult* results) {
+  inputs_ = inputs;
+  inputs16_ = NULL;
+  return DoCanonicalize(inputs, input_count, output, results);
+}
+
+int ParallelCanonicalizer::Canonicalize(const BatchInput16* inputs,
+                                        int input_count,
+                                        url_canon::CanonOutput* output,
+                                        BatchResult* results) {
+  inputs_ = NULL;
+  inputs16_ = inputs;
+  return DoCanonicalize(inputs, input_count, output, results);
+}
+
+template<typename CHAR>
+int ParallelCanonicalizer::DoCanonicalize(const BatchInputT<CHAR>* inputs,
+                                          int input_count,
+                                          url_canon::CanonOutput* output,
+                                          BatchResult* results) {
+  // Small batches aren't worth waking the threads for.
+  if (threads_.empty() || input_count <= kShardSize) {
+    return CanonicalizeBatch(inputs, input_count, workers_[0]->converter,
+                             output, results);
+  }
+
+  input_count_ = input_count;
+  results_ = results;
+  shards_.resize((input_count + kShardSize - 1) / kShardSize);
+  next_shard_.store(0);
+  for (size_t i = 0; i < workers_.size(); i++)
+    workers_[i]->output.set_length(0);
+
+  // Hand the batch to the threads, work on it here too, and wait for them.
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    busy_threads_ = static_cast<int>(threads_.size());
+  }
+  work_ready_.notify_all();
+  RunShards(0);
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (busy_threads_ > 0)
+      work_done_.wait(lock);
+  }
+
+  // Copy each shard's output into place, in input order, and move its
+  // components there with it.
+  int valid_count = 0;
+  for (size_t s = 0; s < shards_.size(); s++) {
+    const Shard& shard = shards_[s];
+    const url_canon::CanonOutput& shard_output =
+        workers_[shard.worker]->output;
+    int first = static_cast<int>(s) * kShardSize;
+    int last = std::min(first + kShardSize, input_count);
+    int shard_end = results[last - 1].spec.end();
+    int offset = output->length() - shard.output_begin;
+    output->Append(shard_output.data() + shard.output_begin,
+                   shard_end - shard.output_begin);
+    for (int i = first; i < last; i++) {
+      results[i].spec.begin += offset;
+      url_parse::OffsetParsed(offset, &results[i].parsed);
+    }
+    valid_count += shard.valid_count;
+  }
+
+  inputs_ = NULL;
+  inputs16_ = NULL;
+  results_ = NULL;
+  return valid_count;
+}
+
+void ParallelCanonicalizer::RunShards(int worker_index) {
+  Worker* worker = workers_[worker_index];
+  int shard_count = static_cast<int>(shards_.size());
+  for (;;) {
+    int s = next_shard_.fetch_add(1);
+    if (s >= shard_count)
+      return;
+
+    int first = s * kShardSize;
+    int count = std::min(kShardSize, input_count_ - first);
+    Shard& shard = shards_[s];
+    shard.worker = worker_index;
+    shard.output_begin = worker->output.length();
+    if (inputs_) {
+      shard.valid_count = CanonicalizeBatch(inputs_ + first, count,
+                                            worker->converter,
+                                            &worker->output,
+                                            results_ + first);
+    } else {
+      shard.valid_count = CanonicalizeBatch(inputs16_ + first, count,
+                                            worker->converter,
+                                            &worker->output,
+                                            results_ + first);
+    }
+  }
+}
+
+void ParallelCanonicalizer::WorkerLoop(int worker_index) {
+  int seen_generation = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (!stopping_ && generation_ == seen_generation)
+        work_ready_.wait(lock);
+      if (stopping_)
+        return;
+      seen_generation = generation_;
+    }
+
+    RunShards(worker_index);
+
+    bool last;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      last = --busy_threads_ == 0;
+    }
+    if (last)
+      work_done_.notify_one();
+  }
+}
+
+}  // namespace url_util
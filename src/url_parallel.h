@@ -0,0 +1,147 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef GOOGLEURL_SRC_URL_PARALLEL_H__
+#define GOOGLEURL_SRC_URL_PARALLEL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "googleurl/src/url_canon.h"
+#include "googleurl/src/url_common.h"
+#include "googleurl/src/url_util.h"
+
+namespace url_util {
+
+// Makes the charset converters of a ParallelCanonicalizer. Converters such as
+// url_canon::ICUCharsetConverter can't be shared between threads, so each
+// worker gets its own.
+class CharsetConverterFactory {
+ public:
+  virtual ~CharsetConverterFactory() {}
+
+  // Returns a new converter, owned by the caller. Only called from the thread
+  // that creates the ParallelCanonicalizer.
+  virtual url_canon::CharsetConverter* CreateConverter() = 0;
+};
+
+// Canonicalizes large batches of URLs on a pool of threads, producing the
+// same output as url_util::CanonicalizeBatch.
+//
+// A batch is cut into shards of kShardSize inputs that the workers claim one
+// at a time, so threads that get cheap URLs take more shards and the work
+// stays balanced. Each worker canonicalizes into its own output buffer, which
+// is kept from one batch to the next, with its own charset converter, and,
+// since the host cache is kept per thread (see
+// url_canon::SetIDNHostCacheCapacity), with its own IDN host cache. Once
+// every shard is done the outputs are copied to the caller's output in input
+// order.
+//
+// The threads are started by the constructor and wait for work between
+// batches. The calling thread works on each batch as well, so a pool of one
+// thread starts none. Only one batch may be canonicalized at a time.
+class ParallelCanonicalizer {
+ public:
+  // The number of inputs in a shard. Batches of at most this size are
+  // canonicalized by the calling thread alone.
+  static const int kShardSize = 256;
+
+  // Creates a pool of |num_threads| threads, including the calling one. The
+  // factory, if not NULL, is used right away to create one converter per
+  // thread, and is not kept. When it is NULL, queries are converted to UTF-8
+  // as with a NULL converter passed to Canonicalize.
+  GURL_API ParallelCanonicalizer(int num_threads,
+                                 CharsetConverterFactory* converter_factory);
+
+  // Stops and joins the threads.
+  GURL_API ~ParallelCanonicalizer();
+
+  int num_threads() const {
+    return static_cast<int>(workers_.size());
+  }
+
+  // Same as CanonicalizeBatch, see url_util.h.
+  GURL_API int Canonicalize(const BatchInput* inputs,
+                            int input_count,
+                            url_canon::CanonOutput* output,
+                            BatchResult* results);
+  GURL_API int Canonicalize(const BatchInput16* inputs,
+                            int input_count,
+                            url_canon::CanonOutput* output,
+                            BatchResult* results);
+
+ private:
+  struct Worker;
+
+  // The range of a batch's output written by each shard.
+  struct Shard {
+    int worker;
+    int output_begin;
+    int valid_count;
+  };
+
+  template<typename CHAR>
+  int DoCanonicalize(const BatchInputT<CHAR>* inputs,
+                     int input_count,
+                     url_canon::CanonOutput* output,
+                     BatchResult* results);
+
+  // Claims and canonicalizes shards of the current batch until none are left.
+  void RunShards(int worker_index);
+
+  // The body of each thread.
+  void WorkerLoop(int worker_index);
+
+  std::vector<Worker*> workers_;
+  std::vector<std::thread> threads_;
+
+  // The current batch. Only one of the input arrays is set.
+  const BatchInput* inputs_;
+  const BatchInput16* inputs16_;
+  int input_count_;
+  BatchResult* results_;
+  std::vector<Shard> shards_;
+  std::atomic<int> next_shard_;
+
+  // Protects the fields below, which hand batches to the threads and let the
+  // caller wait for them to finish.
+  std::mutex mutex_;
+  std::condition_variable work_ready_;
+  std::condition_variable work_done_;
+  int generation_;  // Incremented for each batch given to the threads.
+  int busy_threads_;  // Threads still working on the current batch.
+  bool stopping_;
+};
+
+}  // namespace url_util
+
+#endif  // GOOGLEURL_SRC_URL_PARALLEL_H__
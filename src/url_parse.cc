@@ -39,6 +39,7 @@
 #include <stdlib.h>
 
 #include "googleurl/base/logging.h"
+#include "googleurl/src/url_canon_simd.h"
 #include "googleurl/src/url_parse_internal.h"
 #include "googleurl/src/url_util.h"
 #include "googleurl/src/url_util_internal.h"
@@ -52,30 +53,108 @@ inline bool IsPortDigit(char16 ch) {
   return ch >= '0' && ch <= '9';
 }
 
+// The searches for delimiters below only look at the characters at the
+// positions given by one of these, which must include every ':', '/', '\\',
+// '?', '#', '@' and ']' in the spec.
+
+// Gives every position, so the searches look at each character in turn.
+class AllPositions {
+ public:
+  // Returns the first position in [begin, end), or a value >= |end| if there
+  // is none.
+  int Next(int begin, int /* end */) const {
+    return begin;
+  }
+
+  // Returns the last position in [begin, end), or a value < |begin| if there
+  // is none.
+  int Prev(int /* begin */, int end) const {
+    return end - 1;
+  }
+};
+
+#if !defined(GURL_NO_SIMD) && defined(__GNUC__)
+#define URL_PARSE_DELIMITER_MASK 1
+
+// Gives only the positions of the delimiters, which are found for the whole
+// spec in one vectorized pass, so that the searches skip straight from one
+// delimiter to the next.
+class DelimiterPositions {
+ public:
+  // Specs longer than this are parsed with AllPositions, to bound the stack
+  // space used by the mask.
+  static const int kMaxSpecLen = 16384;
+
+  DelimiterPositions(const char* spec, int spec_len) {
+    DCHECK(spec_len <= kMaxSpecLen);
+    url_canon::MarkURLDelimiters(spec, spec_len, mask_);
+  }
+
+  int Next(int begin, int end) const {
+    if (begin >= end)
+      return end;
+    int word = begin >> 6;
+    uint64_t bits = mask_[word] & (~static_cast<uint64_t>(0) << (begin & 63));
+    while (!bits) {
+      if (++word << 6 >= end)
+        return end;
+      bits = mask_[word];
+    }
+    return (word << 6) + __builtin_ctzll(bits);
+  }
+
+  int Prev(int begin, int end) const {
+    if (end <= begin)
+      return begin - 1;
+    int word = (end - 1) >> 6;
+    uint64_t bits =
+        mask_[word] & (~static_cast<uint64_t>(0) >> (63 - ((end - 1) & 63)));
+    while (!bits) {
+      if (word << 6 <= begin)
+        return begin - 1;
+      bits = mask_[--word];
+    }
+    return (word << 6) + 63 - __builtin_clzll(bits);
+  }
+
+ private:
+  // Only the words covering the spec are initialized.
+  uint64_t mask_[kMaxSpecLen / 64];
+
+  // Not copyable, it's big and only lives for one parse.
+  DelimiterPositions(const DelimiterPositions&);
+  void operator=(const DelimiterPositions&);
+};
+#endif  // !GURL_NO_SIMD && __GNUC__
+
 // Returns the offset of the next authority terminator in the input starting
 // from start_offset. If no terminator is found, the return value will be equal
 // to spec_len.
-template<typename CHAR>
+template<typename CHAR, typename POSITIONS>
 int FindNextAuthorityTerminator(const CHAR* spec,
                                 int start_offset,
-                                int spec_len) {
-  for (int i = start_offset; i < spec_len; i++) {
+                                int spec_len,
+                                const POSITIONS& positions) {
+  for (int i = positions.Next(start_offset, spec_len); i < spec_len;
+       i = positions.Next(i + 1, spec_len)) {
     if (IsAuthorityTerminator(spec[i]))
       return i;
   }
   return spec_len;  // Not found.
 }
 
-template<typename CHAR>
+template<typename CHAR, typename POSITIONS>
 void ParseUserInfo(const CHAR* spec,
                    const Component& user,
+                   const POSITIONS& positions,
                    Component* username,
                    Component* password) {
   // Find the first colon in the user section, which separates the username and
   // password.
-  int colon_offset = 0;
-  while (colon_offset < user.len && spec[user.begin + colon_offset] != ':')
-    colon_offset++;
+  int colon = positions.Next(user.begin, user.end());
+  while (colon < user.end() && spec[colon] != ':')
+    colon = positions.Next(colon + 1, user.end());
+  int colon_offset = (colon < user.end() ? colon : user.end()) - user.begin;
 
   if (colon_offset < user.len) {
     // Found separator: <username>:<password>
@@ -89,9 +168,10 @@ void ParseUserInfo(const CHAR* spec,
   }
 }
 
-template<typename CHAR>
+template<typename CHAR, typename POSITIONS>
 void ParseServerInfo(const CHAR* spec,
                      const Component& serverinfo,
+                     const POSITIONS& positions,
                      Component* hostname,
                      Component* port_num) {
   if (serverinfo.len == 0) {
@@ -111,7 +191,8 @@ void ParseServerInfo(const CHAR* spec,
   int colon = -1;
 
   // Find the last right-bracket, and the last colon.
-  for (int i = serverinfo.begin; i < serverinfo.end(); i++) {
+  for (int i = positions.Next(serverinfo.begin, serverinfo.end());
+       i < serverinfo.end(); i = positions.Next(i + 1, serverinfo.end())) {
     switch (spec[i]) {
       case ']':
         ipv6_terminator = i;
@@ -139,9 +220,10 @@ void ParseServerInfo(const CHAR* spec,
 // parts. The port number will be parsed and the resulting integer will be
 // filled into the given *port variable, or -1 if there is no port number or it
 // is invalid.
-template<typename CHAR>
+template<typename CHAR, typename POSITIONS>
 void DoParseAuthority(const CHAR* spec,
                       const Component& auth,
+                      const POSITIONS& positions,
                       Component* username,
                       Component* password,
                       Component* hostname,
@@ -157,27 +239,28 @@ void DoParseAuthority(const CHAR* spec,
 
   // Search backwards for @, which is the separator between the user info and
   // the server info.
-  int i = auth.begin + auth.len - 1;
-  while (i > auth.begin && spec[i] != '@')
-    i--;
+  int i = positions.Prev(auth.begin, auth.end());
+  while (i >= auth.begin && spec[i] != '@')
+    i = positions.Prev(auth.begin, i);
 
-  if (spec[i] == '@') {
+  if (i >= auth.begin) {
     // Found user info: <user-info>@<server-info>
-    ParseUserInfo(spec, Component(auth.begin, i - auth.begin),
+    ParseUserInfo(spec, Component(auth.begin, i - auth.begin), positions,
                   username, password);
-    ParseServerInfo(spec, MakeRange(i + 1, auth.begin + auth.len),
+    ParseServerInfo(spec, MakeRange(i + 1, auth.begin + auth.len), positions,
                     hostname, port_num);
   } else {
     // No user info, everything is server info.
     username->reset();
     password->reset();
-    ParseServerInfo(spec, auth, hostname, port_num);
+    ParseServerInfo(spec, auth, positions, hostname, port_num);
   }
 }
 
-template<typename CHAR>
+template<typename CHAR, typename POSITIONS>
 void ParsePath(const CHAR* spec,
                const Component& path,
+               const POSITIONS& positions,
                Component* filepath,
                Component* query,
                Component* ref) {
@@ -197,18 +280,19 @@ void ParsePath(const CHAR* spec,
 
   int query_separator = -1;  // Index of the '?'
   int ref_separator = -1;    // Index of the '#'
-  for (int i = path.begin; i < path_end; i++) {
+  for (int i = positions.Next(path.begin, path_end);
+       i < path_end && ref_separator < 0;
+       i = positions.Next(i + 1, path_end)) {
     switch (spec[i]) {
       case '?':
         // Only match the query string if it precedes the reference fragment
         // and when we haven't found one already.
-        if (ref_separator < 0 && query_separator < 0)
+        if (query_separator < 0)
           query_separator = i;
         break;
       case '#':
-        // Record the first # sign only.
-        if (ref_separator < 0)
-          ref_separator = i;
+        // Record the first # sign only; nothing after it matters.
+        ref_separator = i;
         break;
     }
   }
@@ -243,9 +327,10 @@ void ParsePath(const CHAR* spec,
     filepath->reset();
 }
 
-template<typename CHAR>
+template<typename CHAR, typename POSITIONS>
 bool DoExtractScheme(const CHAR* url,
                      int url_len,
+                     const POSITIONS& positions,
                      Component* scheme) {
   // Skip leading whitespace and control characters.
   int begin = 0;
@@ -255,7 +340,8 @@ bool DoExtractScheme(const CHAR* url,
     return false;  // Input is empty or all whitespace.
 
   // Find the first colon character.
-  for (int i = begin; i < url_len; i++) {
+  for (int i = positions.Next(begin, url_len); i < url_len;
+       i = positions.Next(i + 1, url_len)) {
     if (url[i] == ':') {
       *scheme = MakeRange(begin, i);
       return true;
@@ -264,6 +350,11 @@ bool DoExtractScheme(const CHAR* url,
   return false;  // No colon found: no scheme
 }
 
+template<typename CHAR>
+bool DoExtractScheme(const CHAR* url, int url_len, Component* scheme) {
+  return DoExtractScheme(url, url_len, AllPositions(), scheme);
+}
+
 // Fills in all members of the Parsed structure except for the scheme.
 //
 // |spec| is the full spec being parsed, of length |spec_len|.
@@ -282,10 +373,11 @@ bool DoExtractScheme(const CHAR* url,
 // (*) Interestingly, although IE fails to load these URLs, its history
 // canonicalizer handles them, meaning if you've been to the corresponding
 // "http://foo.com/" link, it will be colored.
-template <typename CHAR>
+template <typename CHAR, typename POSITIONS>
 void DoParseAfterScheme(const CHAR* spec,
                         int spec_len,
                         int after_scheme,
+                        const POSITIONS& positions,
                         Parsed* parsed) {
   int num_slashes = CountConsecutiveSlashes(spec, after_scheme, spec_len);
   int after_slashes = after_scheme + num_slashes;
@@ -298,7 +390,8 @@ void DoParseAfterScheme(const CHAR* spec,
   // Found "//<some data>", looks like an authority section. Treat everything
   // from there to the next slash (or end of spec) to be the authority. Note
   // that we ignore the number of slashes and treat it as the authority.
-  int end_auth = FindNextAuthorityTerminator(spec, after_slashes, spec_len);
+  int end_auth = FindNextAuthorityTerminator(spec, after_slashes, spec_len,
+                                             positions);
   authority = Component(after_slashes, end_auth - after_slashes);
 
   if (end_auth == spec_len)  // No beginning of path found.
@@ -307,23 +400,44 @@ void DoParseAfterScheme(const CHAR* spec,
     full_path = Component(end_auth, spec_len - end_auth);
 
   // Now parse those two sub-parts.
-  DoParseAuthority(spec, authority, &parsed->username, &parsed->password,
-                   &parsed->host, &parsed->port);
-  ParsePath(spec, full_path, &parsed->path, &parsed->query, &parsed->ref);
+  DoParseAuthority(spec, authority, positions, &parsed->username,
+                   &parsed->password, &parsed->host, &parsed->port);
+  ParsePath(spec, full_path, positions, &parsed->path, &parsed->query,
+            &parsed->ref);
 }
 
-// The main parsing function for standard URLs. Standard URLs have a scheme,
-// host, path, etc.
-template<typename CHAR>
-void DoParseStandardURL(const CHAR* spec, int spec_len, Parsed* parsed) {
-  DCHECK(spec_len >= 0);
+template <typename CHAR>
+void DoParseAfterScheme(const CHAR* spec,
+                        int spec_len,
+                        int after_scheme,
+                        Parsed* parsed) {
+  DoParseAfterScheme(spec, spec_len, after_scheme, AllPositions(), parsed);
+}
 
-  // Strip leading & trailing spaces and control characters.
-  int begin = 0;
-  TrimURL(spec, &begin, &spec_len);
+// 8-bit specs that fit get their delimiters found all at once.
+void DoParseAfterScheme(const char* spec,
+                        int spec_len,
+                        int after_scheme,
+                        Parsed* parsed) {
+#if defined(URL_PARSE_DELIMITER_MASK)
+  if (spec_len <= DelimiterPositions::kMaxSpecLen) {
+    DoParseAfterScheme(spec, spec_len, after_scheme,
+                       DelimiterPositions(spec, spec_len), parsed);
+    return;
+  }
+#endif
+  DoParseAfterScheme(spec, spec_len, after_scheme, AllPositions(), parsed);
+}
 
+// Splits a trimmed standard URL, see DoParseStandardURL below.
+template<typename CHAR, typename POSITIONS>
+void DoParseTrimmedStandardURL(const CHAR* spec,
+                               int begin,
+                               int spec_len,
+                               const POSITIONS& positions,
+                               Parsed* parsed) {
   int after_scheme;
-  if (DoExtractScheme(spec, spec_len, &parsed->scheme)) {
+  if (DoExtractScheme(spec, spec_len, positions, &parsed->scheme)) {
     after_scheme = parsed->scheme.end() + 1;  // Skip past the colon.
   } else {
     // Say there's no scheme when there is no colon. We could also say that
@@ -332,7 +446,36 @@ void DoParseStandardURL(const CHAR* spec, int spec_len, Parsed* parsed) {
     parsed->scheme.reset();
     after_scheme = begin;
   }
-  DoParseAfterScheme(spec, spec_len, after_scheme, parsed);
+  DoParseAfterScheme(spec, spec_len, after_scheme, positions, parsed);
+}
+
+// The main parsing function for standard URLs. Standard URLs have a scheme,
+// host, path, etc.
+template<typename CHAR>
+void DoParseStandardURL(const CHAR* spec, int spec_len, Parsed* parsed) {
+  DCHECK(spec_len >= 0);
+
+  // Strip leading & trailing spaces and control characters.
+  int begin = 0;
+  TrimURL(spec, &begin, &spec_len);
+
+  DoParseTrimmedStandardURL(spec, begin, spec_len, AllPositions(), parsed);
+}
+
+void DoParseStandardURL(const char* spec, int spec_len, Parsed* parsed) {
+  DCHECK(spec_len >= 0);
+
+  int begin = 0;
+  TrimURL(spec, &begin, &spec_len);
+
+#if defined(URL_PARSE_DELIMITER_MASK)
+  if (spec_len <= DelimiterPositions::kMaxSpecLen) {
+    DoParseTrimmedStandardURL(spec, begin, spec_len,
+                              DelimiterPositions(spec, spec_len), parsed);
+    return;
+  }
+#endif
+  DoParseTrimmedStandardURL(spec, begin, spec_len, AllPositions(), parsed);
 }
 
 template<typename CHAR>
@@ -722,6 +865,36 @@ Parsed::~Parsed() {
   delete inner_parsed_;
 }
 
+Parsed::Parsed(Parsed&& other) noexcept :
+    scheme(other.scheme),
+    username(other.username),
+    password(other.password),
+    host(other.host),
+    port(other.port),
+    path(other.path),
+    query(other.query),
+    ref(other.ref),
+    inner_parsed_(other.inner_parsed_) {
+  other.inner_parsed_ = NULL;
+}
+
+Parsed& Parsed::operator=(Parsed&& other) noexcept {
+  if (this != &other) {
+    scheme = other.scheme;
+    username = other.username;
+    password = other.password;
+    host = other.host;
+    port = other.port;
+    path = other.path;
+    query = other.query;
+    ref = other.ref;
+    delete inner_parsed_;
+    inner_parsed_ = other.inner_parsed_;
+    other.inner_parsed_ = NULL;
+  }
+  return *this;
+}
+
 int Parsed::Length() const {
   if (ref.is_valid())
     return ref.end();
@@ -791,6 +964,84 @@ int Parsed::CountCharactersBefore(ComponentType type,
   return cur;
 }
 
+const int CompactParsed::kMaxOffset;
+
+CompactParsed::CompactParsed() {
+  // Matches the default Components of a Parsed.
+  for (int i = 0; i < kNumComponents; i++) {
+    begin_[i] = 0;
+    len_[i] = 0;
+  }
+  valid_mask_ = 0;
+  padding_ = 0;
+}
+
+bool CompactParsed::Pack(const Parsed& parsed) {
+  if (parsed.inner_parsed())
+    return false;
+
+  const Component* components[kNumComponents] = {
+    &parsed.scheme, &parsed.username, &parsed.password, &parsed.host,
+    &parsed.port, &parsed.path, &parsed.query, &parsed.ref,
+  };
+  for (int i = 0; i < kNumComponents; i++) {
+    const Component& component = *components[i];
+    if (component.begin < 0 || component.len < -1 ||
+        component.begin + (component.len > 0 ? component.len : 0) >
+            kMaxOffset)
+      return false;
+  }
+
+  valid_mask_ = 0;
+  for (int i = 0; i < kNumComponents; i++) {
+    const Component& component = *components[i];
+    begin_[i] = static_cast<uint16>(component.begin);
+    if (component.is_valid()) {
+      len_[i] = static_cast<uint16>(component.len);
+      valid_mask_ |= static_cast<uint8>(1 << i);
+    } else {
+      len_[i] = 0;
+    }
+  }
+  return true;
+}
+
+Parsed CompactParsed::ToParsed() const {
+  Parsed parsed;
+  parsed.scheme = GetComponent(Parsed::SCHEME);
+  parsed.username = GetComponent(Parsed::USERNAME);
+  parsed.password = GetComponent(Parsed::PASSWORD);
+  parsed.host = GetComponent(Parsed::HOST);
+  parsed.port = GetComponent(Parsed::PORT);
+  parsed.path = GetComponent(Parsed::PATH);
+  parsed.query = GetComponent(Parsed::QUERY);
+  parsed.ref = GetComponent(Parsed::REF);
+  return parsed;
+}
+
+bool CompactParsed::operator==(const CompactParsed& other) const {
+  if (valid_mask_ != other.valid_mask_)
+    return false;
+  for (int i = 0; i < kNumComponents; i++) {
+    if (begin_[i] != other.begin_[i] || len_[i] != other.len_[i])
+      return false;
+  }
+  return true;
+}
+
+void OffsetParsed(int offset, Parsed* parsed) {
+  Component* components[] = {
+    &parsed->scheme, &parsed->username, &parsed->password, &parsed->host,
+    &parsed->port, &parsed->path, &parsed->query, &parsed->ref,
+  };
+  for (size_t i = 0; i < arraysize(components); i++) {
+    if (components[i]->is_valid())
+      components[i]->begin += offset;
+  }
+  if (parsed->inner_parsed())
+    OffsetParsed(offset, parsed->inner_parsed());
+}
+
 bool ExtractScheme(const char* url, int url_len, Component* scheme) {
   return DoExtractScheme(url, url_len, scheme);
 }
@@ -837,7 +1088,8 @@ void ParseAuthority(const char* spec,
                     Component* password,
                     Component* hostname,
                     Component* port_num) {
-  DoParseAuthority(spec, auth, username, password, hostname, port_num);
+  DoParseAuthority(spec, auth, AllPositions(), username, password, hostname,
+                   port_num);
 }
 
 void ParseAuthority(const char16* spec,
@@ -846,7 +1098,8 @@ void ParseAuthority(const char16* spec,
                     Component* password,
                     Component* hostname,
                     Component* port_num) {
-  DoParseAuthority(spec, auth, username, password, hostname, port_num);
+  DoParseAuthority(spec, auth, AllPositions(), username, password, hostname,
+                   port_num);
 }
 
 int ParsePort(const char* url, const Component& port) {
@@ -894,7 +1147,7 @@ void ParsePathInternal(const char* spec,
                        Component* filepath,
                        Component* query,
                        Component* ref) {
-  ParsePath(spec, path, filepath, query, ref);
+  ParsePath(spec, path, AllPositions(), filepath, query, ref);
 }
 
 void ParsePathInternal(const char16* spec,
@@ -902,7 +1155,7 @@ void ParsePathInternal(const char16* spec,
                        Component* filepath,
                        Component* query,
                        Component* ref) {
-  ParsePath(spec, path, filepath, query, ref);
+  ParsePath(spec, path, AllPositions(), filepath, query, ref);
 }
 
 void ParseAfterScheme(const char* spec,
@@ -126,6 +126,11 @@ struct Parsed {
   GURL_API Parsed& operator=(const Parsed&);
   GURL_API ~Parsed();
 
+  // Moving takes ownership of the other object's inner_parsed_ rather than
+  // copying it, leaving the other object without one.
+  GURL_API Parsed(Parsed&& other) noexcept;
+  GURL_API Parsed& operator=(Parsed&& other) noexcept;
+
   // Returns the length of the URL (the end of the last component).
   //
   // Note that for some invalid, non-canonical URLs, this may not be the length
@@ -229,6 +234,62 @@ struct Parsed {
   Parsed* inner_parsed_;  // This object is owned and managed by this struct.
 };
 
+// A packed copy of a Parsed for specs shorter than 64KB, for callers keeping
+// very many parsed URLs in memory. Each component is stored as 16-bit offsets
+// and its validity as a bit in a mask, taking 34 bytes rather than the 72 of a
+// Parsed on 64-bit systems.
+//
+// The conversion is lossless: ToParsed() returns exactly the Parsed given to
+// Pack(), including the offsets of invalid components. Only Parseds that have
+// no inner Parsed (that is, everything except filesystem: URLs) can be packed.
+class CompactParsed {
+ public:
+  // The largest component offset or end that can be stored.
+  static const int kMaxOffset = 0xffff;
+
+  // Equivalent to a default-constructed Parsed.
+  GURL_API CompactParsed();
+
+  // Stores |parsed|, returning true on success. Returns false, leaving this
+  // object unchanged, if some component ends past kMaxOffset, has a length
+  // below -1, or |parsed| has an inner Parsed.
+  GURL_API bool Pack(const Parsed& parsed);
+
+  // Returns the stored components as a Parsed.
+  GURL_API Parsed ToParsed() const;
+
+  // Returns a single stored component.
+  Component GetComponent(Parsed::ComponentType type) const {
+    if (valid_mask_ & (1 << type))
+      return Component(begin_[type], len_[type]);
+    return Component(begin_[type], -1);
+  }
+
+  GURL_API bool operator==(const CompactParsed& other) const;
+  bool operator!=(const CompactParsed& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  static const int kNumComponents = Parsed::REF + 1;
+
+  uint16 begin_[kNumComponents];
+  uint16 len_[kNumComponents];
+
+  // Bit (1 << type) is set when that component has a length of 0 or more.
+  uint8 valid_mask_;
+
+  // Always zero. Spelled out so that every byte of the object is defined, as
+  // the raw bytes may be written to a file (see url_util::URLTable).
+  uint8 padding_;
+};
+
+// Moves all the present components of |parsed|, and of its inner URL if any,
+// |offset| characters towards the end of the spec, or towards its start for a
+// negative offset. This keeps the components right when a spec is copied to
+// a different position in a buffer.
+GURL_API void OffsetParsed(int offset, Parsed* parsed);
+
 // Initialization functions ---------------------------------------------------
 //
 // These functions parse the given URL, filling in all of the structure's
@@ -0,0 +1,150 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "googleurl/src/url_path_router.h"
+
+#include "googleurl/src/url_canon.h"
+#include "googleurl/src/url_canon_stdstring.h"
+
+namespace url_util {
+
+namespace {
+
+// Segments are hashed starting from a basis that depends on the node they
+// leave so that all the edges can share one table.
+uint64_t HashSegment(int parent, const char* segment, int segment_len) {
+  uint64_t basis = (kFNVBasis ^ static_cast<uint32_t>(parent)) * kFNVPrime;
+  return FNVHash(basis, segment, segment_len);
+}
+
+}  // namespace
+
+PathRouter::PathRouter() : node_routes_(1, -1) {
+}
+
+PathRouter::~PathRouter() {
+}
+
+int PathRouter::Add(const char* route, int route_len) {
+  // A route that fails to canonicalize, because of a bad escape sequence for
+  // example, is still added as the canonicalizer wrote it: this is what the
+  // path of a URL with the same route will be.
+  std::string canon;
+  url_canon::StdStringCanonOutput output(&canon);
+  url_parse::Component ignored;
+  url_canon::CanonicalizePath(route, url_parse::Component(0, route_len),
+                              &output, &ignored);
+  output.Complete();
+  while (canon.size() > 1 && canon[canon.size() - 1] == '/')
+    canon.resize(canon.size() - 1);
+
+  // The edges created below point into the new text, so it is appended
+  // first and dropped again if the route turns out to be a duplicate.
+  int offset = static_cast<int>(text_.size());
+  text_.append(canon);
+
+  int node = 0;
+  url_parse::Component path(offset, static_cast<int>(canon.size()));
+  PathSegmentIterator iter(text_.data(), path);
+  while (iter.Next()) {
+    const url_parse::Component& segment = iter.segment();
+    if (segment.len == 0 && iter.at_end())
+      break;  // The root route.
+    const char* segment_text = &text_[segment.begin];
+    uint64_t hash = HashSegment(node, segment_text, segment.len);
+    int child = FindChild(node, hash, segment_text, segment.len);
+    if (child < 0) {
+      child = static_cast<int>(node_routes_.size());
+      node_routes_.push_back(-1);
+
+      Edge edge;
+      edge.hash = hash;
+      edge.parent = node;
+      edge.child = child;
+      edge.offset = segment.begin;
+      edge.len = segment.len;
+      edges_.Add(edge);
+    }
+    node = child;
+  }
+
+  if (node_routes_[node] >= 0) {
+    text_.resize(offset);
+    return node_routes_[node];
+  }
+
+  Route entry;
+  entry.offset = offset;
+  entry.len = static_cast<int>(canon.size());
+  routes_.push_back(entry);
+  node_routes_[node] = static_cast<int>(routes_.size()) - 1;
+  return node_routes_[node];
+}
+
+int PathRouter::FindMatch(const char* spec, const url_parse::Component& path,
+                          url_parse::Component* rest) const {
+  int best = node_routes_[0];
+  int best_end = path.begin;
+
+  int node = 0;
+  PathSegmentIterator iter(spec, path);
+  while (iter.Next()) {
+    const url_parse::Component& segment = iter.segment();
+    const char* segment_text = &spec[segment.begin];
+    node = FindChild(node, HashSegment(node, segment_text, segment.len),
+                     segment_text, segment.len);
+    if (node < 0)
+      break;
+    if (node_routes_[node] >= 0) {
+      best = node_routes_[node];
+      best_end = segment.end();
+    }
+  }
+
+  if (rest) {
+    if (best >= 0 && path.is_valid())
+      *rest = url_parse::MakeRange(best_end, path.end());
+    else
+      rest->reset();
+  }
+  return best;
+}
+
+int PathRouter::FindChild(int parent, uint64_t hash, const char* segment,
+                          int segment_len) const {
+  for (HashTable<Edge>::Probe probe(edges_, hash); !probe.done();
+       probe.Next()) {
+    const Edge& edge = probe.entry();
+    if (edge.parent == parent && edge.len == segment_len &&
+        memcmp(&text_[edge.offset], segment, segment_len) == 0)
+      return edge.child;
+  }
+  return -1;
+}
+
+}  // namespace url_util
@@ -0,0 +1,177 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef GOOGLEURL_SRC_URL_PATH_ROUTER_H__
+#define GOOGLEURL_SRC_URL_PATH_ROUTER_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "googleurl/base/string_piece.h"
+#include "googleurl/src/url_common.h"
+#include "googleurl/src/url_parse.h"
+#include "googleurl/src/url_util_internal.h"
+
+namespace url_util {
+
+// Walks the segments of a path within a spec, usually the path of a parsed
+// canonical URL, without copying anything. The segments are the pieces
+// between the slashes after the leading one: "/a/b" has "a" and "b", "/a/"
+// has "a" and an empty last segment, and "/" has a single empty one. An empty
+// path has no segments.
+//
+//   url_util::PathSegmentIterator iter(spec, parsed.path);
+//   while (iter.Next())
+//     Use(iter.segment());
+class PathSegmentIterator {
+ public:
+  PathSegmentIterator(const char* spec, const url_parse::Component& path)
+      : spec_(spec),
+        cur_(path.begin),
+        end_(path.end()) {
+    if (path.len <= 0)
+      cur_ = end_ + 1;
+    else if (spec[cur_] == '/')
+      cur_++;
+  }
+
+  // Moves to the next segment. Returns false, leaving segment() unchanged,
+  // once there are none left.
+  bool Next() {
+    if (cur_ > end_)
+      return false;
+    const void* slash = memchr(&spec_[cur_], '/', end_ - cur_);
+    int segment_end = slash ?
+        static_cast<int>(static_cast<const char*>(slash) - spec_) : end_;
+    segment_ = url_parse::MakeRange(cur_, segment_end);
+    cur_ = segment_end + 1;
+    return true;
+  }
+
+  // The current segment, within the spec.
+  const url_parse::Component& segment() const {
+    return segment_;
+  }
+
+  // Returns true if the current segment is the last one of the path.
+  bool at_end() const {
+    return cur_ > end_;
+  }
+
+ private:
+  const char* spec_;
+  int cur_;  // Beginning of the next segment.
+  int end_;
+  url_parse::Component segment_;
+};
+
+// A set of path prefixes compiled for finding the longest one that a path
+// starts with, segment by segment: "/api" matches "/api", "/api/" and
+// "/api/v1" but not "/apis". The routes form a trie keyed on their segments,
+// so a lookup costs time proportional to the length of the path no matter how
+// many routes there are.
+//
+// Routes are canonicalized with url_canon::CanonicalizePath when they are
+// added, and then compared byte for byte with the path, so the path should be
+// the one of a canonical URL. Trailing slashes on a route are ignored, and
+// the route "/" matches every path.
+//
+// Adding routes is not threadsafe, but once built, a router can be used for
+// lookups from any number of threads.
+class PathRouter {
+ public:
+  GURL_API PathRouter();
+  GURL_API ~PathRouter();
+
+  // Adds the given route, which need not be NULL terminated. Adding a route
+  // that is already in the router, once canonicalized, does nothing. Returns
+  // the index of the route.
+  GURL_API int Add(const char* route, int route_len);
+  int Add(const char* route) {
+    return Add(route, static_cast<int>(strlen(route)));
+  }
+
+  // The number of distinct routes.
+  int size() const {
+    return static_cast<int>(routes_.size());
+  }
+
+  // The canonical route at the given index, which must be in [0, size()),
+  // without its trailing slashes.
+  base::StringPiece route(int i) const {
+    return base::StringPiece(&text_[routes_[i].offset], routes_[i].len);
+  }
+
+  // Returns the index of the longest route that the path at the given
+  // component of |spec| starts with, or -1 if there is none. When |rest| is
+  // non-NULL, it is set to the part of the path after the route, which is
+  // empty or starts with a slash.
+  GURL_API int FindMatch(const char* spec, const url_parse::Component& path,
+                         url_parse::Component* rest) const;
+  int FindMatch(const char* spec, const url_parse::Component& path) const {
+    return FindMatch(spec, path, NULL);
+  }
+
+ private:
+  struct Route {
+    int offset;  // In text_.
+    int len;
+  };
+
+  // A trie edge, leading from node |parent| to node |child| for the segment
+  // at |offset| in text_. The root is node 0.
+  struct Edge {
+    uint64_t hash;
+    int parent;
+    int child;
+    int offset;
+    int len;
+  };
+
+  // Returns the child of |parent| for the given segment, which has the given
+  // hash, or -1 if there is none.
+  int FindChild(int parent, uint64_t hash, const char* segment,
+                int segment_len) const;
+
+  // The canonical routes, one after the other. Edges point into them for
+  // their segments.
+  std::string text_;
+  std::vector<Route> routes_;
+
+  // The index of the route ending at each node, or -1.
+  std::vector<int> node_routes_;
+
+  HashTable<Edge> edges_;
+};
+
+}  // namespace url_util
+
+#endif  // GOOGLEURL_SRC_URL_PATH_ROUTER_H__
@@ -0,0 +1,417 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "googleurl/src/url_public_suffix.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "googleurl/base/basictypes.h"
+#include "googleurl/src/url_canon.h"
+#include "googleurl/src/url_canon_internal.h"
+#include "googleurl/src/url_util_internal.h"
+
+namespace url_util {
+
+namespace {
+
+// The built-in rules, in the format of the Public Suffix List. This is the
+// part of the ICANN section covering the generic TLDs and the country code
+// TLDs with the most widely used second-level registries. Applications that
+// need the full list, including the private section, can load it with
+// LoadPublicSuffixList.
+const char kBuiltinPublicSuffixList[] =
+    "// Generic and sponsored TLDs.\n"
+    "aero\n" "app\n" "arpa\n" "asia\n" "biz\n" "blog\n" "cat\n" "cloud\n"
+    "com\n" "coop\n" "dev\n" "edu\n" "gov\n" "info\n" "int\n" "jobs\n"
+    "mil\n" "mobi\n" "museum\n" "name\n" "net\n" "online\n" "org\n" "page\n"
+    "pro\n" "shop\n" "site\n" "store\n" "tech\n" "tel\n" "top\n" "travel\n"
+    "xxx\n" "xyz\n"
+    "// Country code TLDs.\n"
+    "ac\n" "ad\n" "ae\n" "af\n" "ag\n" "ai\n" "al\n" "am\n" "ao\n" "aq\n"
+    "as\n" "at\n" "aw\n" "ax\n" "az\n" "ba\n" "bb\n" "be\n" "bf\n" "bg\n"
+    "bh\n" "bi\n" "bj\n" "bm\n" "bn\n" "bo\n" "bs\n" "bt\n" "bw\n" "by\n"
+    "bz\n" "ca\n" "cc\n" "cd\n" "cf\n" "cg\n" "ch\n" "ci\n" "cl\n" "cm\n"
+    "cn\n" "co\n" "cr\n" "cu\n" "cv\n" "cw\n" "cx\n" "cz\n" "de\n" "dj\n"
+    "dk\n" "dm\n" "do\n" "dz\n" "ec\n" "ee\n" "eg\n" "es\n" "eu\n" "fi\n"
+    "fm\n" "fo\n" "fr\n" "ga\n" "gd\n" "ge\n" "gf\n" "gg\n" "gh\n" "gi\n"
+    "gl\n" "gm\n" "gn\n" "gp\n" "gq\n" "gr\n" "gs\n" "gt\n" "gw\n" "gy\n"
+    "hk\n" "hm\n" "hn\n" "hr\n" "ht\n" "hu\n" "id\n" "ie\n" "il\n" "im\n"
+    "in\n" "io\n" "iq\n" "ir\n" "is\n" "it\n" "je\n" "jo\n" "jp\n" "ke\n"
+    "kg\n" "ki\n" "km\n" "kn\n" "kp\n" "kr\n" "kw\n" "ky\n" "kz\n" "la\n"
+    "lb\n" "lc\n" "li\n" "lk\n" "lr\n" "ls\n" "lt\n" "lu\n" "lv\n" "ly\n"
+    "ma\n" "mc\n" "md\n" "me\n" "mg\n" "mh\n" "mk\n" "ml\n" "mn\n" "mo\n"
+    "mp\n" "mq\n" "mr\n" "ms\n" "mt\n" "mu\n" "mv\n" "mw\n" "mx\n" "my\n"
+    "mz\n" "na\n" "nc\n" "ne\n" "nf\n" "ng\n" "ni\n" "nl\n" "no\n" "nr\n"
+    "nu\n" "nz\n" "om\n" "pa\n" "pe\n" "pf\n" "ph\n" "pk\n" "pl\n" "pm\n"
+    "pn\n" "pr\n" "ps\n" "pt\n" "pw\n" "py\n" "qa\n" "re\n" "ro\n" "rs\n"
+    "ru\n" "rw\n" "sa\n" "sb\n" "sc\n" "sd\n" "se\n" "sg\n" "sh\n" "si\n"
+    "sk\n" "sl\n" "sm\n" "sn\n" "so\n" "sr\n" "st\n" "su\n" "sv\n" "sx\n"
+    "sy\n" "sz\n" "tc\n" "td\n" "tf\n" "tg\n" "th\n" "tj\n" "tk\n" "tl\n"
+    "tm\n" "tn\n" "to\n" "tr\n" "tt\n" "tv\n" "tw\n" "tz\n" "ua\n" "ug\n"
+    "uk\n" "us\n" "uy\n" "uz\n" "va\n" "vc\n" "ve\n" "vg\n" "vi\n" "vn\n"
+    "vu\n" "wf\n" "ws\n" "yt\n" "za\n" "zm\n" "zw\n"
+    "// Second-level registries.\n"
+    "com.ar\n" "edu.ar\n" "gob.ar\n" "net.ar\n" "org.ar\n"
+    "com.au\n" "net.au\n" "org.au\n" "edu.au\n" "gov.au\n" "asn.au\n"
+    "id.au\n"
+    "com.br\n" "net.br\n" "org.br\n" "gov.br\n" "edu.br\n" "art.br\n"
+    "blog.br\n"
+    "ab.ca\n" "bc.ca\n" "on.ca\n" "qc.ca\n"
+    "com.cn\n" "net.cn\n" "org.cn\n" "gov.cn\n" "edu.cn\n" "ac.cn\n"
+    "com.co\n" "net.co\n" "org.co\n" "edu.co\n" "gov.co\n"
+    "com.eg\n" "edu.eg\n" "gov.eg\n"
+    "com.es\n" "nom.es\n" "org.es\n" "gob.es\n" "edu.es\n"
+    "com.hk\n" "net.hk\n" "org.hk\n" "edu.hk\n" "gov.hk\n"
+    "co.id\n" "or.id\n" "ac.id\n" "go.id\n" "web.id\n"
+    "co.il\n" "org.il\n" "ac.il\n" "gov.il\n" "net.il\n"
+    "co.in\n" "net.in\n" "org.in\n" "firm.in\n" "gen.in\n" "ind.in\n"
+    "ac.in\n" "edu.in\n" "res.in\n" "gov.in\n"
+    "co.jp\n" "ne.jp\n" "or.jp\n" "ac.jp\n" "ad.jp\n" "ed.jp\n" "go.jp\n"
+    "gr.jp\n" "lg.jp\n" "tokyo.jp\n" "osaka.jp\n"
+    "*.kawasaki.jp\n" "!city.kawasaki.jp\n"
+    "*.kobe.jp\n" "!city.kobe.jp\n"
+    "co.kr\n" "ne.kr\n" "or.kr\n" "re.kr\n" "ac.kr\n" "go.kr\n"
+    "com.mx\n" "net.mx\n" "org.mx\n" "gob.mx\n" "edu.mx\n"
+    "com.my\n" "net.my\n" "org.my\n" "gov.my\n" "edu.my\n"
+    "co.nz\n" "net.nz\n" "org.nz\n" "ac.nz\n" "govt.nz\n" "school.nz\n"
+    "com.pl\n" "net.pl\n" "org.pl\n" "gov.pl\n" "edu.pl\n"
+    "com.pt\n" "org.pt\n" "gov.pt\n" "edu.pt\n"
+    "com.ru\n" "net.ru\n" "org.ru\n" "msk.ru\n" "spb.ru\n"
+    "com.sg\n" "net.sg\n" "org.sg\n" "gov.sg\n" "edu.sg\n"
+    "com.tr\n" "net.tr\n" "org.tr\n" "gov.tr\n" "edu.tr\n" "gen.tr\n"
+    "com.tw\n" "net.tw\n" "org.tw\n" "gov.tw\n" "edu.tw\n" "idv.tw\n"
+    "com.ua\n" "net.ua\n" "org.ua\n" "gov.ua\n" "edu.ua\n" "kiev.ua\n"
+    "co.uk\n" "org.uk\n" "me.uk\n" "ltd.uk\n" "plc.uk\n" "net.uk\n"
+    "ac.uk\n" "gov.uk\n" "sch.uk\n" "nhs.uk\n" "police.uk\n"
+    "ak.us\n" "ca.us\n" "ny.us\n" "tx.us\n" "wa.us\n"
+    "co.za\n" "net.za\n" "org.za\n" "gov.za\n" "edu.za\n" "ac.za\n"
+    "web.za\n"
+    "// Wildcard registries.\n"
+    "*.bd\n" "*.ck\n" "!www.ck\n" "*.er\n" "*.fk\n" "*.jm\n" "*.kh\n"
+    "*.mm\n" "*.np\n" "*.pg\n";
+
+// Rule flags for a suffix.
+enum {
+  RULE_EXACT = 1,      // The suffix itself is a rule.
+  RULE_WILDCARD = 2,   // "*." followed by the suffix is a rule.
+  RULE_EXCEPTION = 4,  // "!" followed by the suffix is a rule.
+};
+
+// ASCII-specific tolower. The standard library's tolower is locale sensitive,
+// so we don't want to use it here.
+inline char ToLowerASCII(char c) {
+  return (c >= 'A' && c <= 'Z') ? (c + ('a' - 'A')) : c;
+}
+
+// A compiled list: an open-addressed table of the suffixes that have rules,
+// with their flags. An entry takes 12 bytes and the names are packed into one
+// string, so a few thousand rules stay within a few cache-friendly blocks.
+struct PublicSuffixTable {
+  struct Entry {
+    uint32_t hash;
+    uint32_t offset;  // In names.
+    uint16_t len;
+    uint16_t flags;
+  };
+
+  PublicSuffixTable() : previous(NULL) {}
+  ~PublicSuffixTable() {
+    delete previous;
+  }
+
+  // Returns the flags for the given suffix, which has the given hash, or 0
+  // if it has no rules.
+  int Lookup(uint32_t hash, const char* suffix, int suffix_len) const {
+    for (HashTable<Entry>::Probe probe(entries, hash); !probe.done();
+         probe.Next()) {
+      const Entry& entry = probe.entry();
+      if (entry.len != suffix_len)
+        continue;
+      const char* name = &names[entry.offset];
+      int i = 0;
+      while (i < suffix_len && ToLowerASCII(suffix[i]) == name[i])
+        i++;
+      if (i == suffix_len)
+        return entry.flags;
+    }
+    return 0;
+  }
+
+  // Adds |flags| to the given lower-case suffix.
+  void AddRule(const char* suffix, int suffix_len, int flags) {
+    uint32_t hash = kFNVBasis32;
+    for (int i = suffix_len - 1; i >= 0; i--)
+      hash = FNVHashStep32(hash, suffix[i]);
+
+    for (HashTable<Entry>::Probe probe(entries, hash); !probe.done();
+         probe.Next()) {
+      const Entry& entry = probe.entry();
+      if (entry.len == suffix_len &&
+          memcmp(&names[entry.offset], suffix, suffix_len) == 0) {
+        entries.entry(probe.index()).flags |= flags;
+        return;
+      }
+    }
+
+    Entry entry;
+    entry.hash = hash;
+    entry.offset = static_cast<uint32_t>(names.size());
+    entry.len = static_cast<uint16_t>(suffix_len);
+    entry.flags = static_cast<uint16_t>(flags);
+    names.append(suffix, suffix_len);
+    entries.Add(entry);
+  }
+
+  std::string names;
+  HashTable<Entry> entries;
+
+  // The table this one replaced, kept alive for lookups that may still be
+  // using it.
+  const PublicSuffixTable* previous;
+};
+
+// Converts a rule to the form it has in canonical hosts: lower-case ASCII,
+// with non-ASCII labels in punycode. Returns false if it can't be converted.
+bool CanonicalizeRule(const char* rule, int rule_len, std::string* output) {
+  bool ascii = true;
+  for (int i = 0; i < rule_len; i++) {
+    if (static_cast<unsigned char>(rule[i]) >= 0x80)
+      ascii = false;
+  }
+  if (ascii) {
+    output->resize(rule_len);
+    for (int i = 0; i < rule_len; i++)
+      (*output)[i] = ToLowerASCII(rule[i]);
+    return true;
+  }
+
+  url_canon::RawCanonOutputW<256> wide;
+  url_canon::RawCanonOutputW<256> punycode;
+  if (!url_canon::ConvertUTF8ToUTF16(rule, rule_len, &wide) ||
+      !url_canon::IDNToASCII(wide.data(), wide.length(), &punycode))
+    return false;
+  output->resize(punycode.length());
+  for (int i = 0; i < punycode.length(); i++) {
+    // at() returns a char, which would cut the character down to its low
+    // byte.
+    char16 ch = punycode.data()[i];
+    if (ch >= 0x80)
+      return false;
+    (*output)[i] = ToLowerASCII(static_cast<char>(ch));
+  }
+  return true;
+}
+
+// Compiles a list in the Public Suffix List format. Each line holds one rule,
+// which ends at the first whitespace; lines starting with "//" are comments.
+// Returns NULL if there are no rules.
+PublicSuffixTable* CompileList(const char* data, int data_len) {
+  struct Rule {
+    int begin;
+    int len;
+    int flags;
+  };
+  std::vector<Rule> rules;
+  int i = 0;
+  while (i < data_len) {
+    int line_end = i;
+    while (line_end < data_len && data[line_end] != '\n')
+      line_end++;
+    int rule_end = i;
+    while (rule_end < line_end && data[rule_end] != ' ' &&
+           data[rule_end] != '\t' && data[rule_end] != '\r')
+      rule_end++;
+
+    Rule rule;
+    rule.begin = i;
+    rule.len = rule_end - i;
+    rule.flags = RULE_EXACT;
+    if (rule.len >= 2 && data[i] == '/' && data[i + 1] == '/') {
+      rule.len = 0;  // Comment.
+    } else if (rule.len >= 1 && data[i] == '!') {
+      rule.begin++;
+      rule.len--;
+      rule.flags = RULE_EXCEPTION;
+    } else if (rule.len >= 2 && data[i] == '*' && data[i + 1] == '.') {
+      rule.begin += 2;
+      rule.len -= 2;
+      rule.flags = RULE_WILDCARD;
+    }
+    if (rule.len > 0)
+      rules.push_back(rule);
+    i = line_end + 1;
+  }
+  if (rules.empty())
+    return NULL;
+
+  PublicSuffixTable* table = new PublicSuffixTable;
+  table->entries.Reserve(rules.size());
+
+  std::string suffix;
+  for (size_t r = 0; r < rules.size(); r++) {
+    if (CanonicalizeRule(&data[rules[r].begin], rules[r].len, &suffix) &&
+        !suffix.empty() && suffix.size() <= 0xffff)
+      table->AddRule(suffix.data(), static_cast<int>(suffix.size()),
+                     rules[r].flags);
+  }
+  return table;
+}
+
+std::atomic<const PublicSuffixTable*> public_suffix_table(NULL);
+
+const PublicSuffixTable* GetTable() {
+  const PublicSuffixTable* table =
+      public_suffix_table.load(std::memory_order_acquire);
+  if (table)
+    return table;
+
+  PublicSuffixTable* builtin = CompileList(
+      kBuiltinPublicSuffixList, arraysize(kBuiltinPublicSuffixList) - 1);
+  const PublicSuffixTable* expected = NULL;
+  if (public_suffix_table.compare_exchange_strong(
+          expected, builtin, std::memory_order_acq_rel)) {
+    return builtin;
+  }
+  // Another thread got there first.
+  delete builtin;
+  return expected;
+}
+
+// Returns true if the host looks like an IP address: an IPv6 literal, or a
+// last label made of digits only, which no top-level domain is. Canonical
+// IPv4 addresses are always dotted decimal.
+bool IsIPAddress(const char* host, int host_len) {
+  if (host[0] == '[')
+    return true;
+  int i = host_len - 1;
+  while (i >= 0 && host[i] >= '0' && host[i] <= '9')
+    i--;
+  return i < host_len - 1 && (i < 0 || host[i] == '.');
+}
+
+// Finds the public suffix and the registrable domain of the given host, as
+// offsets from its beginning. |*registrable_begin| is -1 if there is no
+// registrable domain. Returns the length of the host without its trailing
+// dot, or 0 if it has no public suffix.
+int FindPublicSuffix(const char* host, int host_len, int* suffix_begin,
+                     int* registrable_begin) {
+  if (host_len > 0 && host[host_len - 1] == '.')
+    host_len--;
+  if (host_len <= 0 || IsIPAddress(host, host_len))
+    return 0;
+
+  const PublicSuffixTable* table = GetTable();
+
+  // The longest matching rule wins, with exceptions winning over all others.
+  // The default rule makes the last label a public suffix.
+  int begin = -1;
+  int parent = host_len;   // The beginning of the previous suffix.
+  int parent_flags = 0;
+  // Suffixes are hashed from their last character to their first, so that
+  // the hashes of all the suffixes of the host come out of a single scan from
+  // its end.
+  uint32_t hash = kFNVBasis32;
+  for (int i = host_len - 1; i >= 0; i--) {
+    hash = FNVHashStep32(hash, ToLowerASCII(host[i]));
+    if (i > 0 && host[i - 1] != '.')
+      continue;
+
+    int flags = table->Lookup(hash, &host[i], host_len - i);
+    if (flags & RULE_EXCEPTION) {
+      begin = parent;
+      break;
+    }
+    if (begin < 0 || (flags & RULE_EXACT) || (parent_flags & RULE_WILDCARD))
+      begin = i;
+    parent = i;
+    parent_flags = flags;
+  }
+  if (begin >= host_len)
+    return 0;  // Empty last label.
+  *suffix_begin = begin;
+
+  // The registrable domain adds the label before the suffix, if it isn't
+  // empty.
+  *registrable_begin = -1;
+  if (begin >= 2) {
+    int label = begin - 1;
+    while (label > 0 && host[label - 1] != '.')
+      label--;
+    if (label < begin - 1)
+      *registrable_begin = label;
+  }
+  return host_len;
+}
+
+}  // namespace
+
+url_parse::Component GetPublicSuffix(const char* spec,
+                                     const url_parse::Component& host) {
+  int suffix_begin, registrable_begin;
+  int host_len = host.len > 0 ? FindPublicSuffix(&spec[host.begin], host.len,
+                                                 &suffix_begin,
+                                                 &registrable_begin) : 0;
+  if (host_len == 0)
+    return url_parse::Component();
+  return url_parse::MakeRange(host.begin + suffix_begin,
+                              host.begin + host_len);
+}
+
+url_parse::Component GetRegistrableDomain(const char* spec,
+                                          const url_parse::Component& host) {
+  int suffix_begin, registrable_begin;
+  int host_len = host.len > 0 ? FindPublicSuffix(&spec[host.begin], host.len,
+                                                 &suffix_begin,
+                                                 &registrable_begin) : 0;
+  if (host_len == 0 || registrable_begin < 0)
+    return url_parse::Component();
+  return url_parse::MakeRange(host.begin + registrable_begin,
+                              host.begin + host_len);
+}
+
+bool LoadPublicSuffixList(const char* data, int data_len) {
+  PublicSuffixTable* table = CompileList(data, data_len);
+  if (!table)
+    return false;
+
+  table->previous = GetTable();
+  const PublicSuffixTable* expected = table->previous;
+  while (!public_suffix_table.compare_exchange_weak(
+             expected, table, std::memory_order_acq_rel)) {
+    table->previous = expected;
+  }
+  return true;
+}
+
+}  // namespace url_util
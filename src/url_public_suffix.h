@@ -0,0 +1,71 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Public suffix ("effective TLD") and registrable domain lookup on the host of
+// a canonical URL, following the rules of the Public Suffix List
+// (https://publicsuffix.org/list/). The lookups work on the host component
+// within the spec and return components of the same spec, so nothing is
+// copied.
+
+#ifndef GOOGLEURL_SRC_URL_PUBLIC_SUFFIX_H__
+#define GOOGLEURL_SRC_URL_PUBLIC_SUFFIX_H__
+
+#include "googleurl/src/url_common.h"
+#include "googleurl/src/url_parse.h"
+
+namespace url_util {
+
+// Returns the public suffix of the host at |host| within |spec|: the longest
+// suffix matched by a rule of the list, or the last label if no rule matches.
+// For "www.example.co.uk" this is "co.uk". A trailing dot on the host is not
+// part of the result. Returns an invalid component for empty hosts and for IP
+// addresses, which have no public suffix.
+GURL_API url_parse::Component GetPublicSuffix(
+    const char* spec, const url_parse::Component& host);
+
+// Returns the registrable domain (the "eTLD+1") of the host at |host| within
+// |spec|: its public suffix plus the label before it. For "www.example.co.uk"
+// this is "example.co.uk". Returns an invalid component when the host has no
+// such label, for example when the host is itself a public suffix, and for IP
+// addresses.
+GURL_API url_parse::Component GetRegistrableDomain(
+    const char* spec, const url_parse::Component& host);
+
+// Replaces the built-in rules with the given list in the format of the Public
+// Suffix List. Rules with non-ASCII labels are converted to punycode so that
+// they match canonical hosts. Returns false, leaving the current rules in
+// place, if the data contains no rules.
+//
+// Lookups on other threads may keep using the rules being replaced, so those
+// are never freed. This is meant to be called once at startup.
+GURL_API bool LoadPublicSuffixList(const char* data, int data_len);
+
+}  // namespace url_util
+
+#endif  // GOOGLEURL_SRC_URL_PUBLIC_SUFFIX_H__
@@ -0,0 +1,141 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "googleurl/src/url_query_index.h"
+
+#include "googleurl/src/url_canon_internal.h"
+
+namespace url_util {
+
+namespace {
+
+// ASCII-specific tolower. The standard library's tolower is locale sensitive,
+// so we don't want to use it here.
+inline char ToLowerASCII(char c) {
+  return (c >= 'A' && c <= 'Z') ? (c + ('a' - 'A')) : c;
+}
+
+}  // namespace
+
+QueryIndex::QueryIndex() : spec_(NULL), size_(0) {
+}
+
+QueryIndex::QueryIndex(const char* spec, const url_parse::Component& query)
+    : spec_(NULL), size_(0) {
+  Init(spec, query);
+}
+
+void QueryIndex::Init(const char* spec, const url_parse::Component& query) {
+  spec_ = spec;
+  size_ = 0;
+  overflow_params_.clear();
+  if (!query.is_nonempty())
+    return;
+
+  // This splits the query the same way ExtractQueryKeyValue does, but finds
+  // each separator in the same scan: a pair ends at the next '&', and the key
+  // ends at the first '=' in it.
+  int end = query.end();
+  int cur = query.begin;
+  while (cur < end) {
+    url_parse::Component key(cur, 0);
+    while (cur < end && spec[cur] != '&' && spec[cur] != '=')
+      cur++;
+    key.len = cur - key.begin;
+
+    // Skip the separator after the key (if any).
+    if (cur < end && spec[cur] == '=')
+      cur++;
+
+    url_parse::Component value(cur, 0);
+    while (cur < end && spec[cur] != '&')
+      cur++;
+    value.len = cur - value.begin;
+
+    AddParam(key, value);
+
+    // Skip the next separator if any.
+    if (cur < end)
+      cur++;
+  }
+}
+
+int QueryIndex::Find(const char* key, int key_len, int start) const {
+  for (int i = start < 0 ? 0 : start; i < size_; i++) {
+    const url_parse::Component& comp = param(i).key;
+    if (comp.len == key_len &&
+        (key_len == 0 || memcmp(spec_ + comp.begin, key, key_len) == 0))
+      return i;
+  }
+  return -1;
+}
+
+int QueryIndex::FindIgnoringCase(const char* key, int key_len,
+                                 int start) const {
+  for (int i = start < 0 ? 0 : start; i < size_; i++) {
+    const url_parse::Component& comp = param(i).key;
+    if (comp.len != key_len)
+      continue;
+    const char* candidate = spec_ + comp.begin;
+    int j = 0;
+    while (j < key_len && ToLowerASCII(candidate[j]) == ToLowerASCII(key[j]))
+      j++;
+    if (j == key_len)
+      return i;
+  }
+  return -1;
+}
+
+void QueryIndex::DecodeValue(int i, url_canon::CanonOutput* output) const {
+  const url_parse::Component& comp = param(i).value;
+  int end = comp.end();
+  for (int cur = comp.begin; cur < end; cur++) {
+    unsigned char ch;
+    if (spec_[cur] == '%' && url_canon::DecodeEscaped(spec_, &cur, end, &ch))
+      output->push_back(static_cast<char>(ch));
+    else if (spec_[cur] == '+')
+      output->push_back(' ');
+    else
+      output->push_back(spec_[cur]);  // Includes the '%' of invalid escapes.
+  }
+}
+
+void QueryIndex::AddParam(const url_parse::Component& key,
+                          const url_parse::Component& value) {
+  Param param;
+  param.key = key;
+  param.value = value;
+  if (size_ < kInlineParams)
+    inline_params_[size_] = param;
+  else
+    overflow_params_.push_back(param);
+  size_++;
+}
+
+}  // namespace url_util
@@ -0,0 +1,144 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef GOOGLEURL_SRC_URL_QUERY_INDEX_H__
+#define GOOGLEURL_SRC_URL_QUERY_INDEX_H__
+
+#include <string.h>
+
+#include <vector>
+
+#include "googleurl/base/string_piece.h"
+#include "googleurl/src/url_canon.h"
+#include "googleurl/src/url_common.h"
+#include "googleurl/src/url_parse.h"
+
+namespace url_util {
+
+// An index of the key/value pairs of a query, built with one scan of the
+// query so that looking up many keys doesn't rescan it each time the way
+// repeated url_parse::ExtractQueryKeyValue calls would.
+//
+// The pairs are exactly the ones ExtractQueryKeyValue returns, in the same
+// order, including pairs where the key, the value or both are empty. Keys are
+// compared as they appear in the spec, without unescaping. Values can be
+// unescaped on demand with DecodeValue.
+//
+// The index stores only components, and refers to the spec given to Init,
+// which must stay alive and unchanged while the index is used. Queries with up
+// to kInlineParams pairs are indexed without any heap allocation.
+class QueryIndex {
+ public:
+  struct Param {
+    url_parse::Component key;
+    url_parse::Component value;
+  };
+
+  static const int kInlineParams = 32;
+
+  // Creates an empty index.
+  GURL_API QueryIndex();
+
+  // Creates an index of the given query within |spec|, see Init.
+  GURL_API QueryIndex(const char* spec, const url_parse::Component& query);
+
+  // (Re)builds the index for the given query within |spec|. The query should
+  // not include the '?' (this is the default for parsed URLs). An invalid or
+  // empty query gives an empty index.
+  GURL_API void Init(const char* spec, const url_parse::Component& query);
+
+  // The number of key/value pairs.
+  int size() const {
+    return size_;
+  }
+
+  // The key/value pair at the given index, which must be in [0, size()).
+  const Param& param(int i) const {
+    return i < kInlineParams ? inline_params_[i]
+                             : overflow_params_[i - kInlineParams];
+  }
+
+  base::StringPiece key(int i) const {
+    return Piece(param(i).key);
+  }
+  base::StringPiece value(int i) const {
+    return Piece(param(i).value);
+  }
+
+  // Returns the index of the first pair at or after |start| whose key is
+  // exactly |key|, or -1 if there is none. Call again with the result plus one
+  // to find repeated keys.
+  GURL_API int Find(const char* key, int key_len, int start) const;
+  int Find(const char* key) const {
+    return Find(key, static_cast<int>(strlen(key)), 0);
+  }
+
+  // Like Find, but compares ASCII letters case-insensitively.
+  GURL_API int FindIgnoringCase(const char* key, int key_len,
+                                int start) const;
+  int FindIgnoringCase(const char* key) const {
+    return FindIgnoringCase(key, static_cast<int>(strlen(key)), 0);
+  }
+
+  // Looks up the first value for |key|, returning false if the key isn't
+  // present. A key without a value ("?a&b") gives an empty value.
+  bool GetValue(const char* key, base::StringPiece* value) const {
+    int i = Find(key);
+    if (i < 0)
+      return false;
+    *value = this->value(i);
+    return true;
+  }
+
+  // Appends the value of the given pair to |output|, unescaping %-escapes and
+  // turning '+' into a space as HTML forms encode them. Invalid escapes are
+  // copied as-is. The result is 8-bit and usually, but not necessarily, UTF-8.
+  GURL_API void DecodeValue(int i, url_canon::CanonOutput* output) const;
+
+ private:
+  base::StringPiece Piece(const url_parse::Component& comp) const {
+    if (comp.len <= 0)
+      return base::StringPiece();
+    return base::StringPiece(spec_ + comp.begin, comp.len);
+  }
+
+  void AddParam(const url_parse::Component& key,
+                const url_parse::Component& value);
+
+  const char* spec_;
+  int size_;
+  Param inline_params_[kInlineParams];
+
+  // The pairs past the first kInlineParams ones.
+  std::vector<Param> overflow_params_;
+};
+
+}  // namespace url_util
+
+#endif  // GOOGLEURL_SRC_URL_QUERY_INDEX_H__
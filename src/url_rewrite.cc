@@ -0,0 +1,393 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "googleurl/src/url_rewrite.h"
+
+#include "googleurl/base/logging.h"
+#include "googleurl/src/url_canon_stdstring.h"
+
+namespace url_util {
+
+namespace {
+
+// Schemes whose URLs are canonicalized by the standard URL canonicalizer,
+// which is what the rule splices into. File and filesystem URLs are standard
+// too but are canonicalized differently.
+bool IsSpliceableScheme(SchemeID id) {
+  return id != SCHEME_FILE && id != SCHEME_FILESYSTEM &&
+      IsStandardSchemeID(id);
+}
+
+// Appends the |component| of |source| and returns where it went in |output|.
+url_parse::Component CopyComponent(const char* source,
+                                   const url_parse::Component& component,
+                                   url_canon::CanonOutput* output) {
+  url_parse::Component out(output->length(), component.len);
+  output->Append(&source[component.begin], component.len);
+  return out;
+}
+
+// Appends |delimiter| and the present |component| of |source|, setting
+// |*out| to where it went, or resets |*out| if |component| is not present.
+void CopyDelimitedComponent(char delimiter,
+                            const char* source,
+                            const url_parse::Component& component,
+                            url_canon::CanonOutput* output,
+                            url_parse::Component* out) {
+  if (!component.is_valid()) {
+    out->reset();
+    return;
+  }
+  output->push_back(delimiter);
+  *out = CopyComponent(source, component, output);
+}
+
+}  // namespace
+
+URLRewriteRule::URLRewriteRule(
+    const url_canon::Replacements<char>& replacements,
+    url_canon::CharsetConverter* charset_converter)
+    : charset_converter_(charset_converter),
+      overridden_(0),
+      path_is_valid_(true),
+      can_splice_(false) {
+  const url_canon::URLComponentSource<char>& sources = replacements.sources();
+  const url_parse::Parsed& components = replacements.components();
+
+  // Copy all the replacement strings first, so that |raw_| doesn't move
+  // once |replacements_| points into it.
+  url_parse::Parsed raw_parsed;
+  CopyReplacement(SCHEME, sources.scheme, components.scheme,
+                  &raw_parsed.scheme);
+  CopyReplacement(USERNAME, sources.username, components.username,
+                  &raw_parsed.username);
+  CopyReplacement(PASSWORD, sources.password, components.password,
+                  &raw_parsed.password);
+  CopyReplacement(HOST, sources.host, components.host, &raw_parsed.host);
+  CopyReplacement(PORT, sources.port, components.port, &raw_parsed.port);
+  CopyReplacement(PATH, sources.path, components.path, &raw_parsed.path);
+  CopyReplacement(QUERY, sources.query, components.query, &raw_parsed.query);
+  CopyReplacement(REF, sources.ref, components.ref, &raw_parsed.ref);
+
+  // A non-NULL source with an invalid component clears the component, which
+  // is how cleared components were copied.
+  const char* raw = raw_.data();
+  if (overridden_ & SCHEME)
+    replacements_.SetScheme(raw, raw_parsed.scheme);
+  if (overridden_ & USERNAME)
+    replacements_.SetUsername(raw, raw_parsed.username);
+  if (overridden_ & PASSWORD)
+    replacements_.SetPassword(raw, raw_parsed.password);
+  if (overridden_ & HOST)
+    replacements_.SetHost(raw, raw_parsed.host);
+  if (overridden_ & PORT)
+    replacements_.SetPort(raw, raw_parsed.port);
+  if (overridden_ & PATH)
+    replacements_.SetPath(raw, raw_parsed.path);
+  if (overridden_ & QUERY)
+    replacements_.SetQuery(raw, raw_parsed.query);
+  if (overridden_ & REF)
+    replacements_.SetRef(raw, raw_parsed.ref);
+
+  can_splice_ = CanonicalizeReplacements();
+}
+
+void URLRewriteRule::CopyReplacement(int component, const char* source,
+                                     const url_parse::Component& replacement,
+                                     url_parse::Component* raw_component) {
+  if (!source)
+    return;
+  overridden_ |= component;
+  if (!replacement.is_valid()) {
+    raw_component->reset();
+    return;
+  }
+  *raw_component = url_parse::Component(static_cast<int>(raw_.size()),
+                                        replacement.len);
+  raw_.append(&source[replacement.begin], replacement.len);
+}
+
+bool URLRewriteRule::CanonicalizeReplacements() {
+  const char* raw = raw_.data();
+  const url_parse::Parsed& raw_parsed = replacements_.components();
+  url_canon::StdStringCanonOutput output(&canonical_);
+  bool success = true;
+
+  // The scheme can't be cleared, and must keep URLs standard.
+  if (overridden_ & SCHEME) {
+    success &= url_canon::CanonicalizeScheme(raw, raw_parsed.scheme, &output,
+                                             &canonical_parsed_.scheme);
+    output.set_length(output.length() - 1);  // The colon.
+    success &= IsSpliceableScheme(FindSchemeID(output.data(),
+                                               canonical_parsed_.scheme));
+  }
+
+  // The user info is canonicalized as a whole when it is applied, since the
+  // delimiters depend on both parts. Canonicalizing canonical user info again
+  // gives the same string, so each part is canonicalized here on its own and
+  // only the delimiters are left.
+  if (overridden_ & USERNAME) {
+    url_parse::Component unused;
+    int begin = output.length();
+    url_canon::CanonicalizeUserInfo(raw, raw_parsed.username,
+                                    "", url_parse::Component(), &output,
+                                    &canonical_parsed_.username, &unused);
+    if (canonical_parsed_.username.is_valid())
+      output.set_length(canonical_parsed_.username.end());  // The '@'.
+    else if (raw_parsed.username.is_valid())
+      canonical_parsed_.username = url_parse::Component(begin, 0);
+  }
+  if (overridden_ & PASSWORD) {
+    url_parse::Component unused;
+    int begin = output.length();
+    url_canon::CanonicalizeUserInfo("", url_parse::Component(),
+                                    raw, raw_parsed.password, &output,
+                                    &unused, &canonical_parsed_.password);
+    if (canonical_parsed_.password.is_valid()) {
+      // Drop the ':' and '@' around the password.
+      canonical_parsed_.password.begin--;
+      memmove(&canonical_[canonical_parsed_.password.begin],
+              &canonical_[canonical_parsed_.password.begin + 1],
+              canonical_parsed_.password.len);
+      output.set_length(canonical_parsed_.password.end());
+    } else if (raw_parsed.password.is_valid()) {
+      canonical_parsed_.password = url_parse::Component(begin, 0);
+    }
+  }
+
+  // Standard URLs must have a host.
+  if (overridden_ & HOST) {
+    success &= raw_parsed.host.is_nonempty() &&
+        url_canon::CanonicalizeHost(raw, raw_parsed.host, &output,
+                                    &canonical_parsed_.host);
+  }
+
+  // The default port depends on the scheme, so it can only be dropped when
+  // the rule is applied. Canonicalizing without a default gives the port
+  // number without leading zeros, or nothing when the replacement is empty.
+  if (overridden_ & PORT) {
+    success &= url_canon::CanonicalizePort(raw, raw_parsed.port,
+                                           url_parse::PORT_UNSPECIFIED,
+                                           &output, &canonical_parsed_.port);
+    if (canonical_parsed_.port.is_valid()) {
+      // Drop the colon.
+      canonical_parsed_.port.begin--;
+      memmove(&canonical_[canonical_parsed_.port.begin],
+              &canonical_[canonical_parsed_.port.begin + 1],
+              canonical_parsed_.port.len);
+      output.set_length(canonical_parsed_.port.end());
+    }
+  }
+
+  // A cleared path becomes "/", since standard URLs have an authority. An
+  // empty one also becomes "/" but, as in ReplaceComponents, leaves the
+  // output path component invalid, so the span written is kept instead.
+  if (overridden_ & PATH) {
+    if (raw_parsed.path.is_valid()) {
+      int begin = output.length();
+      success &= url_canon::CanonicalizePath(raw, raw_parsed.path, &output,
+                                             &canonical_parsed_.path);
+      path_is_valid_ = canonical_parsed_.path.is_valid();
+      canonical_parsed_.path =
+          url_parse::Component(begin, output.length() - begin);
+    } else {
+      canonical_parsed_.path = url_parse::Component(output.length(), 1);
+      output.push_back('/');
+    }
+  }
+
+  if (overridden_ & QUERY) {
+    url_canon::CanonicalizeQuery(raw, raw_parsed.query, charset_converter_,
+                                 &output, &canonical_parsed_.query);
+    if (canonical_parsed_.query.is_valid()) {
+      // Include the '?'.
+      canonical_parsed_.query.begin--;
+      canonical_parsed_.query.len++;
+    }
+  }
+  if (overridden_ & REF) {
+    url_canon::CanonicalizeRef(raw, raw_parsed.ref, &output,
+                               &canonical_parsed_.ref);
+    if (canonical_parsed_.ref.is_valid()) {
+      // Include the '#'.
+      canonical_parsed_.ref.begin--;
+      canonical_parsed_.ref.len++;
+    }
+  }
+
+  output.Complete();
+  return success;
+}
+
+bool URLRewriteRule::Apply(const char* spec,
+                           int spec_len,
+                           const url_parse::Parsed& parsed,
+                           bool is_valid,
+                           url_canon::CanonOutput* output,
+                           url_parse::Parsed* out_parsed) const {
+  if (can_splice_ && is_valid &&
+      IsSpliceableScheme(FindSchemeID(spec, parsed.scheme)))
+    return Splice(spec, parsed, output, out_parsed);
+  return ReplaceComponents(spec, spec_len, parsed, replacements_,
+                           charset_converter_, output, out_parsed);
+}
+
+int URLRewriteRule::ApplyBatch(const char* specs,
+                               const BatchResult* inputs,
+                               int input_count,
+                               url_canon::CanonOutput* output,
+                               BatchResult* results) const {
+  int valid_count = 0;
+  for (int i = 0; i < input_count; i++) {
+    // The rewriting works on specs that start at the beginning of the
+    // buffer, the output is then moved to where it was appended.
+    url_parse::Parsed parsed = inputs[i].parsed;
+    url_parse::OffsetParsed(-inputs[i].spec.begin, &parsed);
+
+    BatchResult& result = results[i];
+    result.parsed = url_parse::Parsed();
+    result.spec.begin = output->length();
+    url_canon::RawCanonOutput<1024> rewritten;
+    result.is_valid = Apply(&specs[inputs[i].spec.begin], inputs[i].spec.len,
+                            parsed, inputs[i].is_valid, &rewritten,
+                            &result.parsed);
+    output->Append(rewritten.data(), rewritten.length());
+    url_parse::OffsetParsed(result.spec.begin, &result.parsed);
+    result.spec.len = output->length() - result.spec.begin;
+    if (result.is_valid)
+      valid_count++;
+  }
+  return valid_count;
+}
+
+bool URLRewriteRule::Splice(const char* spec,
+                            const url_parse::Parsed& parsed,
+                            url_canon::CanonOutput* output,
+                            url_parse::Parsed* out_parsed) const {
+  const char* canonical = canonical_.data();
+  const url_parse::Parsed& replaced = canonical_parsed_;
+  bool success = true;
+
+  // Scheme.
+  if (overridden_ & SCHEME)
+    out_parsed->scheme = CopyComponent(canonical, replaced.scheme, output);
+  else
+    out_parsed->scheme = CopyComponent(spec, parsed.scheme, output);
+  output->Append("://", 3);
+
+  // User info, which is copied with its delimiters when untouched.
+  if (overridden_ & (USERNAME | PASSWORD)) {
+    const char* username_source = spec;
+    url_parse::Component username = parsed.username;
+    if (overridden_ & USERNAME) {
+      username_source = canonical;
+      username = replaced.username;
+    }
+    const char* password_source = spec;
+    url_parse::Component password = parsed.password;
+    if (overridden_ & PASSWORD) {
+      password_source = canonical;
+      password = replaced.password;
+    }
+    success &= url_canon::CanonicalizeUserInfo(username_source, username,
+                                               password_source, password,
+                                               output, &out_parsed->username,
+                                               &out_parsed->password);
+  } else if (parsed.username.is_valid() || parsed.password.is_valid()) {
+    int begin = parsed.scheme.end() + 3;
+    int offset = output->length() - begin;
+    output->Append(&spec[begin], parsed.host.begin - begin);
+    out_parsed->username = parsed.username;
+    if (out_parsed->username.is_valid())
+      out_parsed->username.begin += offset;
+    out_parsed->password = parsed.password;
+    if (out_parsed->password.is_valid())
+      out_parsed->password.begin += offset;
+  } else {
+    out_parsed->username.reset();
+    out_parsed->password.reset();
+  }
+
+  // Host.
+  if (overridden_ & HOST)
+    out_parsed->host = CopyComponent(canonical, replaced.host, output);
+  else
+    out_parsed->host = CopyComponent(spec, parsed.host, output);
+
+  // Port, which needs canonicalizing again when the default port could have
+  // changed.
+  if (overridden_ & (SCHEME | PORT)) {
+    const char* port_source = spec;
+    url_parse::Component port = parsed.port;
+    if (overridden_ & PORT) {
+      port_source = canonical;
+      port = replaced.port;
+    }
+    int default_port = url_canon::DefaultPortForScheme(
+        &output->data()[out_parsed->scheme.begin], out_parsed->scheme.len);
+    success &= url_canon::CanonicalizePort(port_source, port, default_port,
+                                           output, &out_parsed->port);
+  } else {
+    CopyDelimitedComponent(':', spec, parsed.port, output, &out_parsed->port);
+  }
+
+  // Path, query and ref. The replacements include their delimiters.
+  if (overridden_ & PATH) {
+    out_parsed->path = CopyComponent(canonical, replaced.path, output);
+    if (!path_is_valid_)
+      out_parsed->path.reset();
+  } else {
+    out_parsed->path = CopyComponent(spec, parsed.path, output);
+  }
+
+  if (!(overridden_ & QUERY)) {
+    CopyDelimitedComponent('?', spec, parsed.query, output,
+                           &out_parsed->query);
+  } else if (replaced.query.is_valid()) {
+    out_parsed->query = CopyComponent(canonical, replaced.query, output);
+    out_parsed->query.begin++;
+    out_parsed->query.len--;
+  } else {
+    out_parsed->query.reset();
+  }
+
+  if (!(overridden_ & REF)) {
+    CopyDelimitedComponent('#', spec, parsed.ref, output, &out_parsed->ref);
+  } else if (replaced.ref.is_valid()) {
+    out_parsed->ref = CopyComponent(canonical, replaced.ref, output);
+    out_parsed->ref.begin++;
+    out_parsed->ref.len--;
+  } else {
+    out_parsed->ref.reset();
+  }
+
+  return success;
+}
+
+}  // namespace url_util
@@ -0,0 +1,141 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef GOOGLEURL_SRC_URL_REWRITE_H__
+#define GOOGLEURL_SRC_URL_REWRITE_H__
+
+#include <string>
+
+#include "googleurl/src/url_canon.h"
+#include "googleurl/src/url_common.h"
+#include "googleurl/src/url_parse.h"
+#include "googleurl/src/url_util.h"
+
+namespace url_util {
+
+// The same component replacements applied to many canonical URLs, such as
+// forcing https or dropping the query and ref. The replacement components
+// are canonicalized once, when the rule is built. Applying the rule to a
+// standard URL then copies its untouched components straight from the source
+// spec and splices in the replacements, rather than re-canonicalizing the
+// whole URL the way ReplaceComponents does.
+//
+// The result is always what ReplaceComponents would produce. File,
+// filesystem and non-standard URLs, invalid URLs, and rules that change one
+// of those in or out (a non-standard scheme, clearing the host, a
+// replacement that doesn't canonicalize) go through ReplaceComponents.
+class GURL_API URLRewriteRule {
+ public:
+  // The replacement strings are copied, so |replacements| need not outlive
+  // the rule. As with ReplaceComponents, |charset_converter| is used for a
+  // replacement query and may be NULL for UTF-8; if not NULL it must outlive
+  // the rule.
+  URLRewriteRule(const url_canon::Replacements<char>& replacements,
+                 url_canon::CharsetConverter* charset_converter);
+
+  // Appends the rewritten form of the canonical URL |spec| to |output| and
+  // identifies its components in |*out_parsed|, relative to the start of
+  // |output|'s buffer, as ReplaceComponents does. |is_valid| is the validity
+  // of |spec| as reported by the canonicalizer. Returns true if the
+  // rewritten URL is valid.
+  bool Apply(const char* spec,
+             int spec_len,
+             const url_parse::Parsed& parsed,
+             bool is_valid,
+             url_canon::CanonOutput* output,
+             url_parse::Parsed* out_parsed) const;
+
+  // Rewrites the |input_count| URLs described by |inputs|, whose components
+  // are offsets into |specs|, one after the other into |output|, filling in
+  // the corresponding element of |results|. This fits the output of
+  // CanonicalizeBatch. Returns the number of valid rewritten URLs.
+  int ApplyBatch(const char* specs,
+                 const BatchResult* inputs,
+                 int input_count,
+                 url_canon::CanonOutput* output,
+                 BatchResult* results) const;
+
+ private:
+  // Each kind of component the rule replaces or clears.
+  enum {
+    SCHEME = 1 << 0,
+    USERNAME = 1 << 1,
+    PASSWORD = 1 << 2,
+    HOST = 1 << 3,
+    PORT = 1 << 4,
+    PATH = 1 << 5,
+    QUERY = 1 << 6,
+    REF = 1 << 7,
+  };
+
+  // Copies the replacement of one component into |raw_|.
+  void CopyReplacement(int component, const char* source,
+                       const url_parse::Component& replacement,
+                       url_parse::Component* raw_component);
+
+  // Canonicalizes the replacements into |canonical_|, returning false if
+  // they can't be spliced into standard URLs.
+  bool CanonicalizeReplacements();
+
+  // The splicing version of Apply, for a valid standard URL.
+  bool Splice(const char* spec,
+              const url_parse::Parsed& parsed,
+              url_canon::CanonOutput* output,
+              url_parse::Parsed* out_parsed) const;
+
+  // The copied replacement strings, and the replacements pointing into them
+  // for ReplaceComponents.
+  std::string raw_;
+  url_canon::Replacements<char> replacements_;
+  url_canon::CharsetConverter* charset_converter_;
+
+  // Bits of the above enum for the components the rule sets or clears.
+  int overridden_;
+
+  // The canonical form of each replacement, as it would appear in the output
+  // without its delimiters, with its components relative to |canonical_|. A
+  // cleared component is invalid.
+  std::string canonical_;
+  url_parse::Parsed canonical_parsed_;
+
+  // Whether a replaced path gives a valid path component. An empty
+  // replacement path is written as "/" but leaves the component invalid.
+  bool path_is_valid_;
+
+  // Whether the replacements can be spliced into standard URLs.
+  bool can_splice_;
+
+  // Not copyable, |replacements_| points into |raw_|.
+  URLRewriteRule(const URLRewriteRule&);
+  void operator=(const URLRewriteRule&);
+};
+
+}  // namespace url_util
+
+#endif  // GOOGLEURL_SRC_URL_REWRITE_H__
@@ -0,0 +1,108 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "googleurl/src/url_stream.h"
+
+#include <limits.h>
+#include <string.h>
+
+#include "googleurl/src/url_util.h"
+
+namespace url_util {
+
+namespace {
+
+// Whether a record is made only of characters the parser trims or the
+// canonicalizer removes, so has no URL in it.
+bool IsBlankRecord(const char* record, size_t record_len) {
+  for (size_t i = 0; i < record_len; i++) {
+    if (static_cast<unsigned char>(record[i]) > ' ')
+      return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+URLStreamCanonicalizer::URLStreamCanonicalizer(
+    char delimiter,
+    url_canon::CharsetConverter* converter)
+    : delimiter_(delimiter),
+      converter_(converter),
+      record_count_(0),
+      valid_count_(0) {
+}
+
+URLStreamCanonicalizer::~URLStreamCanonicalizer() {
+}
+
+size_t URLStreamCanonicalizer::Process(const char* data, size_t data_len,
+                                       bool is_final, URLStreamSink* sink) {
+  size_t begin = 0;
+  while (begin < data_len) {
+    const char* found = static_cast<const char*>(
+        memchr(data + begin, delimiter_, data_len - begin));
+    size_t end;
+    size_t next;
+    if (found) {
+      end = found - data;
+      next = end + 1;
+    } else if (is_final) {
+      end = data_len;
+      next = data_len;
+    } else {
+      break;  // Wait for the rest of the record.
+    }
+
+    bool keep_going = ProcessRecord(data + begin, end - begin, sink);
+    begin = next;
+    if (!keep_going)
+      break;
+  }
+  return begin;
+}
+
+bool URLStreamCanonicalizer::ProcessRecord(const char* record,
+                                           size_t record_len,
+                                           URLStreamSink* sink) {
+  if (record_len > INT_MAX || IsBlankRecord(record, record_len))
+    return true;
+
+  output_.set_length(0);
+  parsed_ = url_parse::Parsed();
+  bool is_valid = Canonicalize(record, static_cast<int>(record_len),
+                               converter_, &output_, &parsed_);
+  record_count_++;
+  if (is_valid)
+    valid_count_++;
+  return sink->OnURL(base::StringPiece(record, record_len),
+                     output_.data(), output_.length(), parsed_, is_valid);
+}
+
+}  // namespace url_util
@@ -0,0 +1,117 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef GOOGLEURL_SRC_URL_STREAM_H__
+#define GOOGLEURL_SRC_URL_STREAM_H__
+
+#include <stddef.h>
+
+#include "googleurl/base/string_piece.h"
+#include "googleurl/src/url_canon.h"
+#include "googleurl/src/url_common.h"
+#include "googleurl/src/url_parse.h"
+
+namespace url_util {
+
+// Receives the URLs canonicalized by URLStreamCanonicalizer.
+class URLStreamSink {
+ public:
+  virtual ~URLStreamSink() {}
+
+  // Called for each record, in order. |input| is the record as it appears in
+  // the stream, without its delimiter. The canonical spec and |parsed|, whose
+  // components are relative to |spec|, are in a buffer that is reused for
+  // the next record, so they are only valid during the call; they can be
+  // wrapped in a GURLView, or copied into a GURL. Returns false to stop the
+  // stream after this record.
+  virtual bool OnURL(const base::StringPiece& input,
+                     const char* spec, int spec_len,
+                     const url_parse::Parsed& parsed,
+                     bool is_valid) = 0;
+};
+
+// Canonicalizes URLs read from a large buffer, such as a log file read in
+// chunks or mapped into memory, where they are separated by newlines or some
+// other delimiter. Each record is canonicalized in place, the same way
+// url_util::Canonicalize would, and passed to a sink. The canonical output
+// buffer is reused, so after the first few records nothing is allocated.
+//
+// Empty records, and those made only of whitespace, are skipped, as are
+// records too long for the canonicalizer's int lengths. "\r\n" line endings
+// need no special handling since the canonicalizer removes the "\r". Typical
+// usage with a mapped file:
+//
+//   void* data = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+//   url_util::URLStreamCanonicalizer stream('\n', NULL);
+//   stream.Process(static_cast<const char*>(data), file_size, true, &sink);
+//
+// One object must not be used from several threads at once.
+class URLStreamCanonicalizer {
+ public:
+  // See url_util::Canonicalize for the charset converter, which may be NULL.
+  GURL_API URLStreamCanonicalizer(char delimiter,
+                                  url_canon::CharsetConverter* converter);
+  GURL_API ~URLStreamCanonicalizer();
+
+  // Canonicalizes every record of the given data, which is not copied, and
+  // returns how many bytes were consumed. When |is_final| is false the data
+  // is one chunk of a longer stream and a last record with no delimiter after
+  // it may be incomplete, so it is left for the caller to pass again at the
+  // start of the next chunk. Otherwise it is processed too. If the sink asks
+  // to stop, the return value is the end of the record it stopped at.
+  GURL_API size_t Process(const char* data, size_t data_len, bool is_final,
+                          URLStreamSink* sink);
+
+  // Totals over every call to Process: the records passed to the sink, and
+  // how many of them produced a valid URL.
+  size_t record_count() const {
+    return record_count_;
+  }
+  size_t valid_count() const {
+    return valid_count_;
+  }
+
+ private:
+  // Canonicalizes one record. Returns what the sink returned.
+  bool ProcessRecord(const char* record, size_t record_len,
+                     URLStreamSink* sink);
+
+  char delimiter_;
+  url_canon::CharsetConverter* converter_;
+
+  url_canon::RawCanonOutput<1024> output_;
+  url_parse::Parsed parsed_;
+
+  size_t record_count_;
+  size_t valid_count_;
+};
+
+}  // namespace url_util
+
+#endif  // GOOGLEURL_SRC_URL_STREAM_H__
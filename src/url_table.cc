@@ -0,0 +1,248 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "googleurl/src/url_table.h"
+
+#include <string.h>
+
+#include "googleurl/base/logging.h"
+#include "googleurl/src/gurl.h"
+#include "googleurl/src/gurl_view.h"
+
+namespace url_util {
+
+namespace {
+
+// The start of every table. It is followed by these sections, in this order,
+// each padded to a multiple of 8 bytes:
+//   spec ends     uint64_t per URL
+//   hashes        uint64_t per URL, only with URLTable::HASHES
+//   components    url_parse::CompactParsed per URL
+//   scheme IDs    uint16_t per URL, only with URLTable::SCHEME_IDS
+//   validity      one byte per URL
+//   blob          the specs, blob_size bytes
+struct TableHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;  // kByteOrderMark as written by the builder.
+  uint32_t columns;
+  uint32_t reserved;
+  uint64_t count;
+  uint64_t blob_size;
+};
+
+const char kMagic[8] = { 'G', 'U', 'R', 'L', 'T', 'A', 'B', 'L' };
+const uint32_t kVersion = 1;
+const uint32_t kByteOrderMark = 0x01020304;
+
+inline uint64_t PaddedSize(uint64_t size) {
+  return (size + 7) & ~static_cast<uint64_t>(7);
+}
+
+// Appends |size| bytes followed by padding up to a multiple of 8.
+void AppendSection(const void* data, size_t size, std::string* output) {
+  output->append(static_cast<const char*>(data), size);
+  output->append(static_cast<size_t>(PaddedSize(size) - size), '\0');
+}
+
+// Sizes of the sections, padding included, for a table with the given header.
+struct SectionSizes {
+  uint64_t spec_ends;
+  uint64_t hashes;
+  uint64_t parsed;
+  uint64_t scheme_ids;
+  uint64_t valid;
+  uint64_t blob;
+
+  // Returns false if the sizes overflow.
+  bool Init(const TableHeader& header) {
+    uint64_t count = header.count;
+    spec_ends = PaddedSize(count * sizeof(uint64_t));
+    hashes = header.columns & URLTable::HASHES ?
+        PaddedSize(count * sizeof(uint64_t)) : 0;
+    parsed = PaddedSize(count * sizeof(url_parse::CompactParsed));
+    scheme_ids = header.columns & URLTable::SCHEME_IDS ?
+        PaddedSize(count * sizeof(uint16_t)) : 0;
+    valid = PaddedSize(count);
+    blob = PaddedSize(header.blob_size);
+    // Fail if any of the sizes above wrapped around.
+    return count <= (static_cast<uint64_t>(-1) >> 8) &&
+           blob >= header.blob_size;
+  }
+
+  uint64_t Total() const {
+    return sizeof(TableHeader) + spec_ends + hashes + parsed + scheme_ids +
+           valid + blob;
+  }
+
+  // Returns true if the header and the sections fit in |data_len| bytes.
+  // Each section is checked against what is left, since with sizes read from
+  // a corrupt header Total() could wrap around.
+  bool FitIn(uint64_t data_len) const {
+    const uint64_t sizes[] = {
+      sizeof(TableHeader), spec_ends, hashes, parsed, scheme_ids, valid, blob
+    };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      if (sizes[i] > data_len)
+        return false;
+      data_len -= sizes[i];
+    }
+    return true;
+  }
+};
+
+}  // namespace
+
+// URLTableBuilder -------------------------------------------------------------
+
+URLTableBuilder::URLTableBuilder(int columns) : columns_(columns) {
+}
+
+URLTableBuilder::~URLTableBuilder() {
+}
+
+bool URLTableBuilder::Add(const char* spec, int spec_len,
+                          const url_parse::Parsed& parsed, bool is_valid) {
+  url_parse::CompactParsed compact;
+  if (!compact.Pack(parsed))
+    return false;
+
+  blob_.append(spec, spec_len);
+  spec_ends_.push_back(blob_.size());
+  parsed_.push_back(compact);
+  valid_.push_back(is_valid ? 1 : 0);
+  if (columns_ & URLTable::SCHEME_IDS) {
+    scheme_ids_.push_back(static_cast<uint16_t>(
+        FindSchemeID(spec, parsed.scheme)));
+  }
+  if (columns_ & URLTable::HASHES)
+    hashes_.push_back(HashSpec(spec, spec_len));
+  return true;
+}
+
+bool URLTableBuilder::Add(const GURL& url) {
+  const std::string& spec = url.possibly_invalid_spec();
+  return Add(spec.data(), static_cast<int>(spec.length()),
+             url.parsed_for_possibly_invalid_spec(), url.is_valid());
+}
+
+void URLTableBuilder::Serialize(std::string* output) const {
+  TableHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byte_order = kByteOrderMark;
+  header.columns = columns_ & (URLTable::SCHEME_IDS | URLTable::HASHES);
+  header.reserved = 0;
+  header.count = parsed_.size();
+  header.blob_size = blob_.size();
+
+  SectionSizes sizes;
+  sizes.Init(header);
+  output->reserve(output->size() + static_cast<size_t>(sizes.Total()));
+
+  size_t count = parsed_.size();
+  output->append(reinterpret_cast<const char*>(&header), sizeof(header));
+  AppendSection(spec_ends_.data(), count * sizeof(uint64_t), output);
+  if (header.columns & URLTable::HASHES)
+    AppendSection(hashes_.data(), count * sizeof(uint64_t), output);
+  AppendSection(parsed_.data(), count * sizeof(url_parse::CompactParsed),
+                output);
+  if (header.columns & URLTable::SCHEME_IDS)
+    AppendSection(scheme_ids_.data(), count * sizeof(uint16_t), output);
+  AppendSection(valid_.data(), count, output);
+  AppendSection(blob_.data(), blob_.size(), output);
+}
+
+// URLTable --------------------------------------------------------------------
+
+URLTable::URLTable()
+    : count_(0),
+      columns_(0),
+      spec_ends_(NULL),
+      parsed_(NULL),
+      valid_(NULL),
+      scheme_ids_(NULL),
+      hashes_(NULL),
+      blob_(NULL) {
+}
+
+bool URLTable::Init(const char* data, size_t data_len) {
+  *this = URLTable();
+  if (data_len < sizeof(TableHeader) ||
+      reinterpret_cast<uintptr_t>(data) % 8 != 0)
+    return false;
+
+  TableHeader header;
+  memcpy(&header, data, sizeof(header));
+  SectionSizes sizes;
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.byte_order != kByteOrderMark ||
+      !sizes.Init(header) || !sizes.FitIn(data_len))
+    return false;
+
+  const char* cur = data + sizeof(TableHeader);
+  const uint64_t* spec_ends = reinterpret_cast<const uint64_t*>(cur);
+  cur += sizes.spec_ends;
+  if (header.columns & HASHES)
+    hashes_ = reinterpret_cast<const uint64_t*>(cur);
+  cur += sizes.hashes;
+  parsed_ = reinterpret_cast<const url_parse::CompactParsed*>(cur);
+  cur += sizes.parsed;
+  if (header.columns & SCHEME_IDS)
+    scheme_ids_ = reinterpret_cast<const uint16_t*>(cur);
+  cur += sizes.scheme_ids;
+  valid_ = reinterpret_cast<const uint8_t*>(cur);
+  cur += sizes.valid;
+  blob_ = cur;
+
+  // The last spec must end at the end of the blob. Checking the others would
+  // mean reading the whole column.
+  if (header.count && spec_ends[header.count - 1] != header.blob_size) {
+    *this = URLTable();
+    return false;
+  }
+
+  spec_ends_ = spec_ends;
+  count_ = static_cast<size_t>(header.count);
+  columns_ = static_cast<int>(header.columns);
+  return true;
+}
+
+GURL URLTable::GetURL(size_t i) const {
+  base::StringPiece s = spec(i);
+  return GURL(s.data(), s.length(), parsed_[i].ToParsed(), is_valid(i));
+}
+
+GURLView URLTable::GetView(size_t i) const {
+  base::StringPiece s = spec(i);
+  return GURLView(s.data(), static_cast<int>(s.length()), parsed_[i],
+                  is_valid(i));
+}
+
+}  // namespace url_util
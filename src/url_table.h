@@ -0,0 +1,187 @@
+// Copyright 2007, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef GOOGLEURL_SRC_URL_TABLE_H__
+#define GOOGLEURL_SRC_URL_TABLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "googleurl/base/string_piece.h"
+#include "googleurl/src/url_common.h"
+#include "googleurl/src/url_parse.h"
+#include "googleurl/src/url_util.h"
+
+class GURL;
+class GURLView;
+
+namespace url_util {
+
+// A serialized table of canonical URLs that can be used in place, for example
+// straight out of an mmapped file, so reloading millions of URLs costs no more
+// than touching the pages that are used. URLTableBuilder writes a table and
+// URLTable reads one.
+//
+// The table holds the specs one after the other in a single blob, together with
+// the packed components of each (see url_parse::CompactParsed) and whether it
+// is valid, so URLs come back out through the GURL(spec, len, parsed, is_valid)
+// constructor, or as GURLViews into the blob, without being parsed again.
+// Optionally it also stores the scheme ID and the hash (as computed by
+// HashSpec and returned by GURL::hash) of each URL.
+//
+// The format uses the byte order and layout of the machine that wrote it;
+// URLTable::Init rejects tables written with a different byte order.
+class URLTableBuilder {
+ public:
+  // Which optional columns to store, as a combination of URLTable::Columns.
+  GURL_API explicit URLTableBuilder(int columns);
+  GURL_API ~URLTableBuilder();
+
+  // Adds a URL given its canonical spec and the components of that spec, as
+  // from url_util::Canonicalize or GURL. Returns false, adding nothing, if
+  // the components can't be packed (specs of 64KB or more, and filesystem:
+  // URLs).
+  GURL_API bool Add(const char* spec, int spec_len,
+                    const url_parse::Parsed& parsed, bool is_valid);
+  GURL_API bool Add(const GURL& url);
+
+  // The number of URLs added so far.
+  size_t size() const {
+    return parsed_.size();
+  }
+
+  // Appends the serialized table to |output|. Each section of the table is
+  // aligned to 8 bytes from its start, so to be read in place the output
+  // must be copied to (or mapped at) an 8-byte aligned address.
+  GURL_API void Serialize(std::string* output) const;
+
+ private:
+  int columns_;
+
+  // The specs and their end offsets in the blob.
+  std::string blob_;
+  std::vector<uint64_t> spec_ends_;
+
+  std::vector<url_parse::CompactParsed> parsed_;
+  std::vector<uint8_t> valid_;
+  std::vector<uint16_t> scheme_ids_;
+  std::vector<uint64_t> hashes_;
+};
+
+// Reads a table written by URLTableBuilder, without copying it. Typical usage
+// with a table file mapped into memory:
+//
+//   void* data = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+//   url_util::URLTable table;
+//   if (!table.Init(static_cast<const char*>(data), file_size))
+//     return TABLE_IS_CORRUPT;
+//   for (size_t i = 0; i < table.size(); i++)
+//     Process(table.GetView(i));
+//
+// Init only checks the header and the section sizes, so it does not touch the
+// rest of the data. A table that passes is assumed to be as the builder wrote
+// it. The accessors only need const access and may be used from any number
+// of threads.
+class URLTable {
+ public:
+  // The optional columns.
+  enum Columns {
+    SCHEME_IDS = 1,
+    HASHES = 2,
+  };
+
+  GURL_API URLTable();
+
+  // Points this table at the serialized data, which must be 8-byte aligned and
+  // outlive the table. Returns false, leaving the table empty, if the data is
+  // not a table of the right version and byte order or is truncated.
+  GURL_API bool Init(const char* data, size_t data_len);
+
+  size_t size() const {
+    return count_;
+  }
+
+  // Returns which of the optional columns the table has.
+  int columns() const {
+    return columns_;
+  }
+
+  // The canonical spec of the URL at index |i|, in [0, size()).
+  base::StringPiece spec(size_t i) const {
+    uint64_t begin = i ? spec_ends_[i - 1] : 0;
+    return base::StringPiece(blob_ + begin,
+                             static_cast<size_t>(spec_ends_[i] - begin));
+  }
+
+  // The components of spec(i), and whether the URL is valid.
+  const url_parse::CompactParsed& compact_parsed(size_t i) const {
+    return parsed_[i];
+  }
+  url_parse::Parsed parsed(size_t i) const {
+    return parsed_[i].ToParsed();
+  }
+  bool is_valid(size_t i) const {
+    return valid_[i] != 0;
+  }
+
+  // The scheme ID, only if the table has the SCHEME_IDS column. Custom scheme
+  // IDs are only meaningful if the reader added the same schemes in the same
+  // order as the writer; see AddStandardScheme.
+  SchemeID scheme_id(size_t i) const {
+    return static_cast<SchemeID>(scheme_ids_[i]);
+  }
+
+  // The hash of spec(i), only if the table has the HASHES column.
+  uint64_t hash(size_t i) const {
+    return hashes_[i];
+  }
+
+  // Returns the URL at index |i| as a GURL owning a copy of its spec, or as a
+  // view of the spec in the table.
+  GURL_API GURL GetURL(size_t i) const;
+  GURL_API GURLView GetView(size_t i) const;
+
+ private:
+  size_t count_;
+  int columns_;
+
+  const uint64_t* spec_ends_;
+  const url_parse::CompactParsed* parsed_;
+  const uint8_t* valid_;
+  const uint16_t* scheme_ids_;
+  const uint64_t* hashes_;
+  const char* blob_;
+};
+
+}  // namespace url_util
+
+#endif  // GOOGLEURL_SRC_URL_TABLE_H__
@@ -28,12 +28,17 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <string.h>
+#include <algorithm>
+#include <atomic>
 #include <vector>
 
 #include "googleurl/src/url_util.h"
 
 #include "googleurl/base/logging.h"
 #include "googleurl/src/url_canon_internal.h"
+#include "googleurl/src/url_canon_query_filter.h"
+#include "googleurl/src/url_canon_sampler.h"
+#include "googleurl/src/url_canon_simd.h"
 #include "googleurl/src/url_file.h"
 #include "googleurl/src/url_util_internal.h"
 
@@ -61,40 +66,179 @@ inline bool DoLowerCaseEqualsASCII(Iter a_begin, Iter a_end, const char* b) {
   return *b == 0;
 }
 
+// The schemes the registry knows about from the start. They are registered in
+// this order so that each gets the SchemeID listed here.
+struct BuiltinScheme {
+  const char* name;
+  SchemeID id;
+  bool is_standard;
+};
+const BuiltinScheme kBuiltinSchemes[] = {
+  {"http", SCHEME_HTTP, true},
+  {"https", SCHEME_HTTPS, true},
+  {kFileScheme, SCHEME_FILE, true},  // Yes, file urls can have a hostname!
+  {"ftp", SCHEME_FTP, true},
+  {"gopher", SCHEME_GOPHER, true},
+  {"ws", SCHEME_WS, true},  // WebSocket.
+  {"wss", SCHEME_WSS, true},  // WebSocket secure.
 #ifdef FULL_FILESYSTEM_URL_SUPPORT
-const int kNumStandardURLSchemes = 8;
+  {kFileSystemScheme, SCHEME_FILESYSTEM, true},
 #else
-const int kNumStandardURLSchemes = 7;
-#endif
-const char* kStandardURLSchemes[kNumStandardURLSchemes] = {
-  "http",
-  "https",
-  kFileScheme,  // Yes, file urls can have a hostname!
-  "ftp",
-  "gopher",
-  "ws",  // WebSocket.
-  "wss",  // WebSocket secure.
-#ifdef FULL_FILESYSTEM_URL_SUPPORT
-  kFileSystemScheme,
+  {kFileSystemScheme, SCHEME_FILESYSTEM, false},
 #endif
+  {kMailtoScheme, SCHEME_MAILTO, false},
+};
+
+// One scheme known to the registry.
+struct SchemeEntry {
+  const char* name;  // Canonical (lower-case) form of the scheme.
+  int name_len;
+  bool is_standard;
+};
+
+// The registry of known schemes. Its list of schemes is indexed by SchemeID,
+// with a placeholder at SCHEME_UNKNOWN. Lookups hash the input scheme,
+// lower-casing it as they go, into an open-addressed table holding the IDs,
+// in which 0 marks an empty bucket. The table is kept at most half full.
+//
+// A registry is immutable once published. Updates copy the current one,
+// change the copy and swap it in, so readers never need a lock.
+struct SchemeRegistry {
+  SchemeRegistry() : previous(NULL) {}
+  ~SchemeRegistry() { delete previous; }
+
+  std::vector<SchemeEntry> schemes;
+  std::vector<int> buckets;  // The size is always a power of two.
+
+  // The registry this one replaced. Readers may still be using it, so it is
+  // kept alive until Shutdown.
+  const SchemeRegistry* previous;
 };
 
-// List of the currently installed standard schemes. This list is lazily
-// initialized by InitStandardSchemes and is leaked on shutdown to prevent
-// any destructors from being called that will slow us down or cause problems.
-std::vector<const char*>* standard_schemes = NULL;
+// The currently published registry. It is lazily initialized by
+// InitStandardSchemes and the custom scheme names are leaked on shutdown to
+// prevent any destructors from being called that will slow us down or cause
+// problems.
+std::atomic<const SchemeRegistry*> scheme_registry(NULL);
 
 // See the LockStandardSchemes declaration in the header.
-bool standard_schemes_locked = false;
+std::atomic<bool> standard_schemes_locked(false);
 
-// Ensures that the standard_schemes list is initialized, does nothing if it
-// already has values.
-void InitStandardSchemes() {
-  if (standard_schemes)
-    return;
-  standard_schemes = new std::vector<const char*>;
-  for (int i = 0; i < kNumStandardURLSchemes; i++)
-    standard_schemes->push_back(kStandardURLSchemes[i]);
+// FNV-1a, which is fast for the short strings that schemes are.
+const unsigned kSchemeHashSeed = 2166136261u;
+inline unsigned HashSchemeChar(unsigned hash, unsigned char ch) {
+  return (hash ^ ch) * 16777619u;
+}
+
+// Places the given registered scheme in the hash table.
+void InsertSchemeBucket(SchemeRegistry* registry, int id) {
+  const SchemeEntry& entry = registry->schemes[id];
+  unsigned hash = kSchemeHashSeed;
+  for (int i = 0; i < entry.name_len; i++)
+    hash = HashSchemeChar(hash, static_cast<unsigned char>(entry.name[i]));
+
+  size_t mask = registry->buckets.size() - 1;
+  size_t bucket = hash & mask;
+  while (registry->buckets[bucket])
+    bucket = (bucket + 1) & mask;
+  registry->buckets[bucket] = id;
+}
+
+// Returns the ID of the given lower-case scheme, or SCHEME_UNKNOWN.
+template<typename CHAR>
+SchemeID LookupScheme(const SchemeRegistry& registry,
+                      const CHAR* scheme, int scheme_len) {
+  // Non-ASCII characters are truncated by the hash. They will never compare
+  // equal to a registered scheme below, so this is harmless.
+  unsigned hash = kSchemeHashSeed;
+  for (int i = 0; i < scheme_len; i++) {
+    hash = HashSchemeChar(
+        hash, static_cast<unsigned char>(ToLowerASCII(scheme[i])));
+  }
+
+  size_t mask = registry.buckets.size() - 1;
+  for (size_t bucket = hash & mask; ; bucket = (bucket + 1) & mask) {
+    int id = registry.buckets[bucket];
+    if (!id)
+      return SCHEME_UNKNOWN;
+    const SchemeEntry& entry = registry.schemes[id];
+    if (entry.name_len == scheme_len &&
+        DoLowerCaseEqualsASCII(scheme, scheme + scheme_len, entry.name))
+      return static_cast<SchemeID>(id);
+  }
+}
+
+// Adds the given lower-case scheme to the registry, or updates its standard
+// flag if it is already there, and returns its ID. The name is not copied.
+SchemeID RegisterScheme(SchemeRegistry* registry,
+                        const char* name, bool is_standard) {
+  int name_len = static_cast<int>(strlen(name));
+  SchemeID existing = LookupScheme(*registry, name, name_len);
+  if (existing != SCHEME_UNKNOWN) {
+    registry->schemes[existing].is_standard |= is_standard;
+    return existing;
+  }
+
+  SchemeEntry entry = { name, name_len, is_standard };
+  registry->schemes.push_back(entry);
+  int id = static_cast<int>(registry->schemes.size()) - 1;
+
+  if (registry->schemes.size() * 2 > registry->buckets.size()) {
+    // Too full, rebuild the table at twice the size.
+    registry->buckets.assign(registry->buckets.size() * 2, 0);
+    for (size_t i = 1; i < registry->schemes.size(); i++)
+      InsertSchemeBucket(registry, static_cast<int>(i));
+  } else {
+    InsertSchemeBucket(registry, id);
+  }
+  return static_cast<SchemeID>(id);
+}
+
+// Returns the published scheme registry, creating it with the built-in
+// schemes if necessary. This is safe to call from any number of threads: if
+// several race to create the registry, one wins and the others discard theirs.
+const SchemeRegistry* InitStandardSchemes() {
+  const SchemeRegistry* current =
+      scheme_registry.load(std::memory_order_acquire);
+  if (current)
+    return current;
+
+  SchemeRegistry* registry = new SchemeRegistry;
+  SchemeEntry unknown = { "", 0, false };
+  registry->schemes.push_back(unknown);
+  registry->buckets.assign(32, 0);
+  for (size_t i = 0; i < arraysize(kBuiltinSchemes); i++) {
+    SchemeID id = RegisterScheme(registry, kBuiltinSchemes[i].name,
+                                 kBuiltinSchemes[i].is_standard);
+    DCHECK(id == kBuiltinSchemes[i].id);
+  }
+
+  if (!scheme_registry.compare_exchange_strong(current, registry,
+                                               std::memory_order_acq_rel,
+                                               std::memory_order_acquire)) {
+    // Another thread published first, |current| now holds its registry.
+    delete registry;
+    return current;
+  }
+  return registry;
+}
+
+// Backend for FindSchemeID.
+template<typename CHAR>
+SchemeID DoFindSchemeID(const CHAR* spec, const url_parse::Component& scheme) {
+  if (!scheme.is_nonempty())
+    return SCHEME_UNKNOWN;  // Empty or invalid schemes are never registered.
+
+  return LookupScheme(*InitStandardSchemes(), &spec[scheme.begin],
+                      scheme.len);
+}
+
+// Backend for IsStandardSchemeID.
+bool DoIsStandardSchemeID(SchemeID id) {
+  const SchemeRegistry* registry = InitStandardSchemes();
+  return id > SCHEME_UNKNOWN &&
+      static_cast<size_t>(id) < registry->schemes.size() &&
+      registry->schemes[id].is_standard;
 }
 
 // Given a string and a range inside the string, compares it to the given
@@ -114,16 +258,7 @@ inline bool DoCompareSchemeComponent(const CHAR* spec,
 // of the registered "standard" schemes.
 template<typename CHAR>
 bool DoIsStandard(const CHAR* spec, const url_parse::Component& scheme) {
-  if (!scheme.is_nonempty())
-    return false;  // Empty or invalid schemes are non-standard.
-
-  InitStandardSchemes();
-  for (size_t i = 0; i < standard_schemes->size(); i++) {
-    if (LowerCaseEqualsASCII(&spec[scheme.begin], &spec[scheme.end()],
-                             standard_schemes->at(i)))
-      return true;
-  }
-  return false;
+  return DoIsStandardSchemeID(DoFindSchemeID(spec, scheme));
 }
 
 template<typename CHAR>
@@ -150,17 +285,91 @@ bool DoFindAndCompareScheme(const CHAR* str,
   return DoCompareSchemeComponent(spec, our_scheme, compare);
 }
 
+// The canonicalizer that DoCanonicalize hands a URL off to, as determined by
+// its scheme.
+enum SchemeType {
+  SCHEME_TYPE_FILE,
+  SCHEME_TYPE_FILESYSTEM,
+  SCHEME_TYPE_STANDARD,
+  SCHEME_TYPE_MAILTO,
+  SCHEME_TYPE_PATH,
+};
+
+// Classifies a scheme given its registry ID. The order of the checks matters
+// since "file" is also a standard scheme.
+SchemeType ClassifySchemeID(SchemeID id) {
+  if (id == SCHEME_FILE)
+    return SCHEME_TYPE_FILE;
+#ifdef FULL_FILESYSTEM_URL_SUPPORT
+  if (id == SCHEME_FILESYSTEM)
+    return SCHEME_TYPE_FILESYSTEM;
+#endif
+  if (DoIsStandardSchemeID(id))
+    return SCHEME_TYPE_STANDARD;
+  if (id == SCHEME_MAILTO)
+    return SCHEME_TYPE_MAILTO;
+  return SCHEME_TYPE_PATH;
+}
+
+// Classifies the given (possibly empty) scheme with a single registry lookup.
 template<typename CHAR>
-bool DoCanonicalize(const CHAR* in_spec, int in_spec_len,
-                    url_canon::CharsetConverter* charset_converter,
-                    url_canon::CanonOutput* output,
-                    url_parse::Parsed* output_parsed) {
+SchemeType DoClassifyScheme(const CHAR* spec,
+                            const url_parse::Component& scheme) {
+  return ClassifySchemeID(DoFindSchemeID(spec, scheme));
+}
+
+// Returns true for the schemes DoCanonicalizeWithBuffer tries to canonicalize
+// in a single pass with FusedCanonicalizeStandardURL: the ones nearly all
+// traffic uses.
+inline bool IsFusedSchemeID(SchemeID id) {
+  return id == SCHEME_HTTP || id == SCHEME_HTTPS ||
+      id == SCHEME_WS || id == SCHEME_WSS;
+}
+
+// Returns true if any component of |parsed|, or of its inner URL, is longer
+// than |max_len|.
+bool HasComponentLongerThan(const url_parse::Parsed& parsed, int max_len) {
+  if (parsed.scheme.len > max_len || parsed.username.len > max_len ||
+      parsed.password.len > max_len || parsed.host.len > max_len ||
+      parsed.port.len > max_len || parsed.path.len > max_len ||
+      parsed.query.len > max_len || parsed.ref.len > max_len)
+    return true;
+  return parsed.inner_parsed() &&
+      HasComponentLongerThan(*parsed.inner_parsed(), max_len);
+}
+
+// Returns true, setting |*too_large|, if |max_component_len| is a limit (not
+// 0) that some component of |parsed| exceeds.
+inline bool ExceedsComponentLimit(const url_parse::Parsed& parsed,
+                                  int max_component_len,
+                                  bool* too_large) {
+  if (max_component_len <= 0 ||
+      !HasComponentLongerThan(parsed, max_component_len))
+    return false;
+  *too_large = true;
+  return true;
+}
+
+// Backend for Canonicalize and CanonicalizeBatch. The |whitespace_buffer| is
+// scratch space for the whitespace-stripped copy of the input; it is cleared
+// before use so that callers canonicalizing many URLs can share one.
+//
+// If |max_component_len| is not 0, inputs with a longer component are
+// rejected after parsing with |*too_large| set; see CanonicalizeWithLimits.
+template<typename CHAR>
+bool DoCanonicalizeWithBuffer(const CHAR* in_spec, int in_spec_len,
+                              url_canon::CanonOutputT<CHAR>* whitespace_buffer,
+                              url_canon::CharsetConverter* charset_converter,
+                              url_canon::CanonOutput* output,
+                              url_parse::Parsed* output_parsed,
+                              int max_component_len,
+                              bool* too_large) {
   // Remove any whitespace from the middle of the relative URL, possibly
   // copying to the new buffer.
-  url_canon::RawCanonOutputT<CHAR> whitespace_buffer;
+  whitespace_buffer->set_length(0);
   int spec_len;
   const CHAR* spec = RemoveURLWhitespace(in_spec, in_spec_len,
-                                         &whitespace_buffer, &spec_len);
+                                         whitespace_buffer, &spec_len);
 
   url_parse::Parsed parsed_input;
 #ifdef WIN32
@@ -177,6 +386,8 @@ bool DoCanonicalize(const CHAR* in_spec, int in_spec_len,
   if (url_parse::DoesBeginUNCPath(spec, 0, spec_len, false) ||
       url_parse::DoesBeginWindowsDriveSpec(spec, 0, spec_len)) {
     url_parse::ParseFileURL(spec, spec_len, &parsed_input);
+    if (ExceedsComponentLimit(parsed_input, max_component_len, too_large))
+      return false;
     return url_canon::CanonicalizeFileURL(spec, spec_len, parsed_input,
                                           charset_converter,
                                           output, output_parsed);
@@ -190,48 +401,237 @@ bool DoCanonicalize(const CHAR* in_spec, int in_spec_len,
   // This is the parsed version of the input URL, we have to canonicalize it
   // before storing it in our object.
   bool success;
-  if (DoCompareSchemeComponent(spec, scheme, kFileScheme)) {
-    // File URLs are special.
-    url_parse::ParseFileURL(spec, spec_len, &parsed_input);
-    success = url_canon::CanonicalizeFileURL(spec, spec_len, parsed_input,
-                                             charset_converter, output,
-                                             output_parsed);
+  SchemeID scheme_id = DoFindSchemeID(spec, scheme);
+  switch (ClassifySchemeID(scheme_id)) {
+    case SCHEME_TYPE_FILE:
+      // File URLs are special.
+      url_parse::ParseFileURL(spec, spec_len, &parsed_input);
+      if (ExceedsComponentLimit(parsed_input, max_component_len, too_large))
+        return false;
+      success = url_canon::CanonicalizeFileURL(spec, spec_len, parsed_input,
+                                               charset_converter, output,
+                                               output_parsed);
+      break;
 #ifdef FULL_FILESYSTEM_URL_SUPPORT
-  } else if (DoCompareSchemeComponent(spec, scheme, kFileSystemScheme)) {
-    // Filesystem URLs are special.
-    url_parse::ParseFileSystemURL(spec, spec_len, &parsed_input);
-    success = url_canon::CanonicalizeFileSystemURL(spec, spec_len,
+    case SCHEME_TYPE_FILESYSTEM:
+      // Filesystem URLs are special.
+      url_parse::ParseFileSystemURL(spec, spec_len, &parsed_input);
+      if (ExceedsComponentLimit(parsed_input, max_component_len, too_large))
+        return false;
+      success = url_canon::CanonicalizeFileSystemURL(spec, spec_len,
+                                                     parsed_input,
+                                                     charset_converter,
+                                                     output, output_parsed);
+      break;
+#endif
+    case SCHEME_TYPE_STANDARD:
+      // All "normal" URLs. The most common ones are usually done in a single
+      // pass, with no separate parse. That does not apply when components
+      // must be checked against a limit before they are canonicalized.
+      if (max_component_len <= 0 && IsFusedSchemeID(scheme_id) &&
+          url_canon::FusedCanonicalizeStandardURL(spec, spec_len, scheme,
+                                                  charset_converter, output,
+                                                  output_parsed)) {
+        success = true;
+        break;
+      }
+      url_parse::ParseStandardURL(spec, spec_len, &parsed_input);
+      if (ExceedsComponentLimit(parsed_input, max_component_len, too_large))
+        return false;
+      success = url_canon::CanonicalizeStandardURL(spec, spec_len,
                                                    parsed_input,
                                                    charset_converter,
                                                    output, output_parsed);
-
-#endif
-  } else if (DoIsStandard(spec, scheme)) {
-    // All "normal" URLs.
-    url_parse::ParseStandardURL(spec, spec_len, &parsed_input);
-    success = url_canon::CanonicalizeStandardURL(spec, spec_len, parsed_input,
-                                                 charset_converter,
+      break;
+    case SCHEME_TYPE_MAILTO:
+      // Mailto are treated like a standard url with only a scheme, path, query
+      url_parse::ParseMailtoURL(spec, spec_len, &parsed_input);
+      if (ExceedsComponentLimit(parsed_input, max_component_len, too_large))
+        return false;
+      success = url_canon::CanonicalizeMailtoURL(spec, spec_len, parsed_input,
                                                  output, output_parsed);
-
-  } else if (DoCompareSchemeComponent(spec, scheme, kMailtoScheme)) {
-    // Mailto are treated like a standard url with only a scheme, path, query
-    url_parse::ParseMailtoURL(spec, spec_len, &parsed_input);
-    success = url_canon::CanonicalizeMailtoURL(spec, spec_len, parsed_input,
+      break;
+    default:
+      // "Weird" URLs like data: and javascript:
+      url_parse::ParsePathURL(spec, spec_len, &parsed_input);
+      if (ExceedsComponentLimit(parsed_input, max_component_len, too_large))
+        return false;
+      success = url_canon::CanonicalizePathURL(spec, spec_len, parsed_input,
                                                output, output_parsed);
+      break;
+  }
+  return success;
+}
 
-  } else {
-    // "Weird" URLs like data: and javascript:
-    url_parse::ParsePathURL(spec, spec_len, &parsed_input);
-    success = url_canon::CanonicalizePathURL(spec, spec_len, parsed_input,
-                                             output, output_parsed);
+template<typename CHAR>
+bool DoCanonicalize(const CHAR* in_spec, int in_spec_len,
+                    url_canon::CharsetConverter* charset_converter,
+                    url_canon::CanonOutput* output,
+                    url_parse::Parsed* output_parsed) {
+  url_canon::RawCanonOutputT<CHAR> whitespace_buffer;
+  return DoCanonicalizeWithBuffer(in_spec, in_spec_len, &whitespace_buffer,
+                                  charset_converter, output, output_parsed,
+                                  0, NULL);
+}
+
+// Returns the url_canon::SlowURLPath bit of the canonicalizer DoCanonicalize
+// hands |spec| to, or 0 if it has no scheme.
+template<typename CHAR>
+int SlowURLPathOf(const CHAR* spec, int spec_len) {
+#ifdef WIN32
+  if (url_parse::DoesBeginUNCPath(spec, 0, spec_len, false) ||
+      url_parse::DoesBeginWindowsDriveSpec(spec, 0, spec_len))
+    return url_canon::SLOW_URL_FILE;
+#endif
+  url_parse::Component scheme;
+  if (!url_parse::ExtractScheme(spec, spec_len, &scheme))
+    return 0;
+  switch (DoClassifyScheme(spec, scheme)) {
+    case SCHEME_TYPE_FILE:
+      return url_canon::SLOW_URL_FILE;
+    case SCHEME_TYPE_FILESYSTEM:
+      return url_canon::SLOW_URL_FILESYSTEM;
+    case SCHEME_TYPE_STANDARD:
+      return url_canon::SLOW_URL_STANDARD;
+    case SCHEME_TYPE_MAILTO:
+      return url_canon::SLOW_URL_MAILTO;
+    default:
+      return url_canon::SLOW_URL_PATH;
   }
+}
+
+// DoCanonicalize for the public entry points, under the slow URL sampler
+// when it is on.
+template<typename CHAR>
+bool DoSampledCanonicalize(const CHAR* spec, int spec_len,
+                           url_canon::CharsetConverter* charset_converter,
+                           url_canon::CanonOutput* output,
+                           url_parse::Parsed* output_parsed) {
+  url_canon::ScopedSlowURLSample sample(spec, spec_len);
+  bool success = DoCanonicalize(spec, spec_len, charset_converter,
+                                output, output_parsed);
+  if (sample.sampling())
+    sample.Finish(SlowURLPathOf(spec, spec_len));
   return success;
 }
 
 template<typename CHAR>
-bool DoResolveRelative(const char* base_spec,
-                       int base_spec_len,
-                       const url_parse::Parsed& base_parsed,
+CanonResult DoCanonicalizeWithLimits(const CHAR* spec, int spec_len,
+                                     const CanonLimits& limits,
+                                     url_canon::CharsetConverter* converter,
+                                     url_canon::CanonOutput* output,
+                                     url_parse::Parsed* output_parsed) {
+  if (limits.max_input_len > 0 && spec_len > limits.max_input_len) {
+    *output_parsed = url_parse::Parsed();
+    return CANON_TOO_LARGE;
+  }
+
+  // The output limit is enforced by not letting the buffer grow past it,
+  // which makes any further output a no-op, and by checking the final length
+  // in case the buffer was already big enough.
+  int output_begin = output->length();
+  int old_max_capacity = output->max_capacity();
+  int max_capacity = old_max_capacity;
+  if (limits.max_output_len > 0 &&
+      limits.max_output_len < old_max_capacity - output_begin)
+    max_capacity = output_begin + limits.max_output_len;
+  output->set_max_capacity(max_capacity);
+
+  url_canon::RawCanonOutputT<CHAR> whitespace_buffer;
+  bool too_large = false;
+  bool success = DoCanonicalizeWithBuffer(spec, spec_len, &whitespace_buffer,
+                                          converter, output, output_parsed,
+                                          limits.max_component_len,
+                                          &too_large);
+  if (output->truncated() ||
+      (limits.max_output_len > 0 &&
+       output->length() - output_begin > limits.max_output_len))
+    too_large = true;
+  output->set_max_capacity(old_max_capacity);
+
+  if (too_large) {
+    output->set_length(output_begin);
+    *output_parsed = url_parse::Parsed();
+    return CANON_TOO_LARGE;
+  }
+  return success ? CANON_VALID : CANON_INVALID;
+}
+
+bool DoIsCanonical(const char* spec, int spec_len,
+                   url_parse::Parsed* parsed) {
+#ifdef WIN32
+  // These are canonicalized as file URLs, see DoCanonicalizeWithBuffer.
+  if (url_parse::DoesBeginUNCPath(spec, 0, spec_len, false) ||
+      url_parse::DoesBeginWindowsDriveSpec(spec, 0, spec_len))
+    return false;
+#endif
+
+  url_parse::Component scheme;
+  if (!url_parse::ExtractScheme(spec, spec_len, &scheme))
+    return false;
+
+  // Whitespace needing removal is never canonical, so the input can be parsed
+  // as is.
+  switch (DoClassifyScheme(spec, scheme)) {
+    case SCHEME_TYPE_FILE:
+      url_parse::ParseFileURL(spec, spec_len, parsed);
+      return url_canon::IsCanonicalFileURL(spec, spec_len, *parsed);
+    case SCHEME_TYPE_STANDARD:
+      url_parse::ParseStandardURL(spec, spec_len, parsed);
+      return url_canon::IsCanonicalStandardURL(spec, spec_len, *parsed);
+    case SCHEME_TYPE_PATH:
+      url_parse::ParsePathURL(spec, spec_len, parsed);
+      return url_canon::IsCanonicalPathURL(spec, spec_len, *parsed);
+    default:
+      return false;
+  }
+}
+
+template<typename CHAR>
+int DoCanonicalizeBatch(const BatchInputT<CHAR>* inputs,
+                        int input_count,
+                        url_canon::CharsetConverter* charset_converter,
+                        url_canon::CanonOutput* output,
+                        BatchResult* results) {
+  // The scheme list is initialized up front so the per-URL lookups don't need
+  // to check for it, and the whitespace buffer is shared by every input.
+  InitStandardSchemes();
+  url_canon::RawCanonOutputT<CHAR> whitespace_buffer;
+
+  int valid_count = 0;
+  for (int i = 0; i < input_count; i++) {
+    // Inputs with no scheme fail without touching the parsed structure, so
+    // reset it rather than leaving the previous contents of |results|.
+    BatchResult& result = results[i];
+    result.parsed = url_parse::Parsed();
+    result.spec.begin = output->length();
+    result.is_valid = DoCanonicalizeWithBuffer(inputs[i].spec,
+                                               inputs[i].spec_len,
+                                               &whitespace_buffer,
+                                               charset_converter,
+                                               output, &result.parsed,
+                                               0, NULL);
+    result.spec.len = output->length() - result.spec.begin;
+    if (result.is_valid)
+      valid_count++;
+  }
+  return valid_count;
+}
+
+// Prepares |*base| for resolving relative URLs against the given base URL
+// with the registered scheme |scheme_id|.
+void DoInitRelativeBase(const char* base_spec,
+                        const url_parse::Parsed& base_parsed,
+                        SchemeID scheme_id,
+                        url_canon::RelativeBase* base) {
+  // See if our base URL should be treated as "standard".
+  bool standard_base_scheme = DoIsStandardSchemeID(scheme_id);
+  url_canon::InitRelativeBase(base_spec, base_parsed, standard_base_scheme,
+                              scheme_id == SCHEME_FILE, base);
+}
+
+template<typename CHAR>
+bool DoResolveRelative(const url_canon::RelativeBase& base,
                        const CHAR* in_relative,
                        int in_relative_length,
                        url_canon::CharsetConverter* charset_converter,
@@ -245,30 +645,19 @@ bool DoResolveRelative(const char* base_spec,
                                              &whitespace_buffer,
                                              &relative_length);
 
-  // See if our base URL should be treated as "standard".
-  bool standard_base_scheme =
-      base_parsed.scheme.is_nonempty() &&
-      DoIsStandard(base_spec, base_parsed.scheme);
-
   bool is_relative;
   url_parse::Component relative_component;
-  if (!url_canon::IsRelativeURL(base_spec, base_parsed,
-                                relative, relative_length,
-                                standard_base_scheme,
-                                &is_relative,
-                                &relative_component)) {
+  if (!url_canon::IsRelativeURL(base, relative, relative_length,
+                                &is_relative, &relative_component)) {
     // Error resolving.
     return false;
   }
 
   if (is_relative) {
     // Relative, resolve and canonicalize.
-    bool file_base_scheme = base_parsed.scheme.is_nonempty() &&
-        DoCompareSchemeComponent(base_spec, base_parsed.scheme, kFileScheme);
-    return url_canon::ResolveRelativeURL(base_spec, base_parsed,
-                                         file_base_scheme, relative,
-                                         relative_component, charset_converter,
-                                         output, output_parsed);
+    return url_canon::ResolveRelativeURL(base, relative, relative_component,
+                                         charset_converter, output,
+                                         output_parsed);
   }
 
   // Not relative, canonicalize the input.
@@ -346,29 +735,222 @@ bool DoReplaceComponents(const char* spec,
 
   // If we get here, then we know the scheme doesn't need to be replaced, so can
   // just key off the scheme in the spec to know how to do the replacements.
-  if (DoCompareSchemeComponent(spec, parsed.scheme, kFileScheme)) {
-    return url_canon::ReplaceFileURL(spec, parsed, replacements,
-                                     charset_converter, output, out_parsed);
-  }
+  switch (DoClassifyScheme(spec, parsed.scheme)) {
+    case SCHEME_TYPE_FILE:
+      return url_canon::ReplaceFileURL(spec, parsed, replacements,
+                                       charset_converter, output, out_parsed);
 #ifdef FULL_FILESYSTEM_URL_SUPPORT
-  if (DoCompareSchemeComponent(spec, parsed.scheme, kFileSystemScheme)) {
-    return url_canon::ReplaceFileSystemURL(spec, parsed, replacements,
+    case SCHEME_TYPE_FILESYSTEM:
+      return url_canon::ReplaceFileSystemURL(spec, parsed, replacements,
+                                             charset_converter, output,
+                                             out_parsed);
+#endif
+    case SCHEME_TYPE_STANDARD:
+      return url_canon::ReplaceStandardURL(spec, parsed, replacements,
                                            charset_converter, output,
                                            out_parsed);
+    case SCHEME_TYPE_MAILTO:
+      return url_canon::ReplaceMailtoURL(spec, parsed, replacements,
+                                         output, out_parsed);
+    default:
+      // Default is a path URL.
+      return url_canon::ReplacePathURL(spec, parsed, replacements,
+                                       output, out_parsed);
   }
+}
+
+// Computes HashSpec of a spec that is given in several pieces, so that a
+// spec can be hashed in a different order than it is stored without copying
+// it. The total length must be known up front since it seeds the hash.
+class SpecHasher {
+ public:
+  explicit SpecHasher(int total_len)
+      : h_(kSeed ^ (static_cast<uint64_t>(total_len) * kMul)),
+        pending_len_(0) {
+  }
+
+  void Update(const char* data, int len) {
+    int i = 0;
+    if (pending_len_ > 0) {
+      // Top up the partial word from a previous piece first.
+      while (i < len && pending_len_ < 8)
+        pending_[pending_len_++] = data[i++];
+      if (pending_len_ < 8)
+        return;
+      MixWord(pending_);
+      pending_len_ = 0;
+    }
+    for (; i + 8 <= len; i += 8)
+      MixWord(&data[i]);
+    while (i < len)
+      pending_[pending_len_++] = data[i++];
+  }
+
+  uint64_t Finish() {
+    uint64_t h = h_;
+    if (pending_len_ > 0) {
+      for (int j = pending_len_ - 1; j >= 0; j--)
+        h ^= static_cast<uint64_t>(static_cast<unsigned char>(pending_[j])) <<
+            (8 * j);
+      h *= kMul;
+    }
+    h ^= h >> kShift;
+    h *= kMul;
+    h ^= h >> kShift;
+    return h;
+  }
+
+ private:
+  // MurmurHash64A, reading the input as little-endian words.
+  static const uint64_t kSeed = 0x9e3779b97f4a7c15ULL;
+  static const uint64_t kMul = 0xc6a4a7935bd1e995ULL;
+  static const int kShift = 47;
+
+  void MixWord(const char* word) {
+    uint64_t k;
+    memcpy(&k, word, sizeof(k));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    k = __builtin_bswap64(k);
 #endif
-  if (DoIsStandard(spec, parsed.scheme)) {
-    return url_canon::ReplaceStandardURL(spec, parsed, replacements,
-                                         charset_converter, output, out_parsed);
+    k *= kMul;
+    k ^= k >> kShift;
+    k *= kMul;
+    h_ ^= k;
+    h_ *= kMul;
+  }
+
+  uint64_t h_;
+  char pending_[8];
+  int pending_len_;
+};
+
+// Orders the '&'-separated pieces of a query by their key, the part before
+// any '='. Pieces with the same key keep their order, since that can matter
+// to the server ("?a=1&a=2" is not "?a=2&a=1").
+class QueryPieceLess {
+ public:
+  explicit QueryPieceLess(const char* spec) : spec_(spec) {
+  }
+
+  bool operator()(const url_parse::Component& a,
+                  const url_parse::Component& b) const {
+    int a_key_len = KeyLength(a);
+    int b_key_len = KeyLength(b);
+    int cmp = memcmp(&spec_[a.begin], &spec_[b.begin],
+                     std::min(a_key_len, b_key_len));
+    if (cmp != 0)
+      return cmp < 0;
+    if (a_key_len != b_key_len)
+      return a_key_len < b_key_len;
+    return a.begin < b.begin;
+  }
+
+ private:
+  int KeyLength(const url_parse::Component& piece) const {
+    const void* equals = memchr(&spec_[piece.begin], '=', piece.len);
+    if (!equals)
+      return piece.len;
+    return static_cast<int>(static_cast<const char*>(equals) -
+                            &spec_[piece.begin]);
+  }
+
+  const char* spec_;
+};
+
+// Feeds the given non-empty query of |spec| to |hasher| with its pieces
+// sorted by QueryPieceLess. The result has the same length as the query.
+void HashSortedQuery(const char* spec,
+                     const url_parse::Component& query,
+                     SpecHasher* hasher) {
+  // Queries usually have few pieces, so those are sorted on the stack.
+  static const int kInlinePieces = 32;
+  url_parse::Component inline_pieces[kInlinePieces];
+  std::vector<url_parse::Component> overflow_pieces;
+  url_parse::Component* pieces = inline_pieces;
+
+  int piece_count = 1;
+  int end = query.end();
+  for (int i = query.begin; i < end; i++) {
+    if (spec[i] == '&')
+      piece_count++;
+  }
+  if (piece_count > kInlinePieces) {
+    overflow_pieces.resize(piece_count);
+    pieces = &overflow_pieces[0];
+  }
+
+  int piece_begin = query.begin;
+  int cur_piece = 0;
+  for (int i = query.begin; i <= end; i++) {
+    if (i == end || spec[i] == '&') {
+      pieces[cur_piece++] = url_parse::MakeRange(piece_begin, i);
+      piece_begin = i + 1;
+    }
   }
-  if (DoCompareSchemeComponent(spec, parsed.scheme, kMailtoScheme)) {
-     return url_canon::ReplaceMailtoURL(spec, parsed, replacements,
-                                        output, out_parsed);
+  DCHECK(cur_piece == piece_count);
+
+  // The comparison breaks ties by position, so an unstable sort gives the
+  // same result as a stable one, without its scratch allocation.
+  std::sort(pieces, pieces + piece_count, QueryPieceLess(spec));
+  for (int i = 0; i < piece_count; i++) {
+    if (i > 0)
+      hasher->Update("&", 1);
+    hasher->Update(&spec[pieces[i].begin], pieces[i].len);
   }
+}
+
+// Returns the fingerprint of the canonical |spec| (see FingerprintURL) with
+// the normalizations in |options| applied.
+uint64_t HashNormalizedSpec(const char* spec,
+                            int spec_len,
+                            const url_parse::Parsed& parsed,
+                            const FingerprintOptions& options) {
+  int end = spec_len;
+  if (options.strip_ref && parsed.ref.is_valid())
+    end = parsed.ref.begin - 1;  // Also drop the '#'.
 
-  // Default is a path URL.
-  return url_canon::ReplacePathURL(spec, parsed, replacements,
-                                   output, out_parsed);
+  if (!options.sort_query || !parsed.query.is_nonempty())
+    return HashSpec(spec, end);
+
+  SpecHasher hasher(end);
+  hasher.Update(spec, parsed.query.begin);
+  HashSortedQuery(spec, parsed.query, &hasher);
+  hasher.Update(&spec[parsed.query.end()], end - parsed.query.end());
+  return hasher.Finish();
+}
+
+template<typename CHAR>
+bool DoCanonicalizeWithQueryFilter(const CHAR* spec, int spec_len,
+                                   const url_canon::QueryFilter& filter,
+                                   url_canon::CharsetConverter* converter,
+                                   url_canon::CanonOutput* output,
+                                   url_parse::Parsed* output_parsed) {
+  // Inputs without a scheme fail without touching the parsed structure, so
+  // clear it rather than filtering a stale query.
+  *output_parsed = url_parse::Parsed();
+  bool success = DoCanonicalize(spec, spec_len, converter, output,
+                                output_parsed);
+  filter.Apply(output, &output_parsed->query, &output_parsed->ref);
+  return success;
+}
+
+template<typename CHAR>
+bool DoFingerprintURL(const CHAR* spec,
+                      int spec_len,
+                      const FingerprintOptions& options,
+                      url_canon::CharsetConverter* charset_converter,
+                      uint64_t* fingerprint) {
+  // The canonicalizers read back what they have written (to remove dot
+  // segments, for instance), so the URL does need to be written out, but to
+  // a stack buffer that is big enough for nearly all URLs. The normalizations
+  // are applied while hashing rather than by building another copy.
+  url_canon::RawCanonOutput<1024> canonical;
+  url_parse::Parsed parsed;
+  bool success = DoCanonicalize(spec, spec_len, charset_converter,
+                                &canonical, &parsed);
+  *fingerprint = HashNormalizedSpec(canonical.data(), canonical.length(),
+                                    parsed, options);
+  return success;
 }
 
 }  // namespace
@@ -378,10 +960,8 @@ void Initialize() {
 }
 
 void Shutdown() {
-  if (standard_schemes) {
-    delete standard_schemes;
-    standard_schemes = NULL;
-  }
+  // Deleting the registry also deletes every version it replaced.
+  delete scheme_registry.exchange(NULL, std::memory_order_acq_rel);
 }
 
 void AddStandardScheme(const char* new_scheme) {
@@ -393,24 +973,69 @@ void AddStandardScheme(const char* new_scheme) {
   // in your application's init process. Locate where your app does this
   // initialization and calls LockStandardScheme, and add your new standard
   // scheme there.
-  DCHECK(!standard_schemes_locked) <<
+  DCHECK(!standard_schemes_locked.load(std::memory_order_relaxed)) <<
       "Trying to add a standard scheme after the list has been locked.";
 
   size_t scheme_len = strlen(new_scheme);
   if (scheme_len == 0)
     return;
 
-  // Dulicate the scheme into a new buffer and add it to the list of standard
-  // schemes. This pointer will be leaked on shutdown.
+  // Dulicate the scheme into a new buffer in canonical (lower-case) form. This
+  // pointer will be leaked on shutdown.
   char* dup_scheme = new char[scheme_len + 1];
-  memcpy(dup_scheme, new_scheme, scheme_len + 1);
+  for (size_t i = 0; i <= scheme_len; i++)
+    dup_scheme[i] = ToLowerASCII(new_scheme[i]);
 
-  InitStandardSchemes();
-  standard_schemes->push_back(dup_scheme);
+  // Publish an updated copy of the registry. If another thread published a
+  // new version in the mean time, start over from that one so its change is
+  // not lost.
+  const SchemeRegistry* current = InitStandardSchemes();
+  for (;;) {
+    SchemeID existing = LookupScheme(*current, dup_scheme,
+                                     static_cast<int>(scheme_len));
+    if (existing != SCHEME_UNKNOWN && current->schemes[existing].is_standard) {
+      delete[] dup_scheme;  // Nothing to do.
+      return;
+    }
+
+    // Existing entries keep their names, so |dup_scheme| is only referenced
+    // when the scheme was not known before.
+    SchemeRegistry* updated = new SchemeRegistry;
+    updated->schemes = current->schemes;
+    updated->buckets = current->buckets;
+    updated->previous = current;
+    RegisterScheme(updated, dup_scheme, true);
+
+    if (scheme_registry.compare_exchange_strong(current, updated,
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_acquire)) {
+      if (existing != SCHEME_UNKNOWN)
+        delete[] dup_scheme;
+      return;
+    }
+
+    // Lost the race, |current| now holds the winner's registry. Our copy was
+    // never published, so it can simply be freed (without its predecessor).
+    updated->previous = NULL;
+    delete updated;
+  }
 }
 
 void LockStandardSchemes() {
-  standard_schemes_locked = true;
+  standard_schemes_locked.store(true, std::memory_order_relaxed);
+}
+
+SchemeID FindSchemeID(const char* spec, const url_parse::Component& scheme) {
+  return DoFindSchemeID(spec, scheme);
+}
+
+SchemeID FindSchemeID(const char16* spec,
+                      const url_parse::Component& scheme) {
+  return DoFindSchemeID(spec, scheme);
+}
+
+bool IsStandardSchemeID(SchemeID id) {
+  return DoIsStandardSchemeID(id);
 }
 
 bool IsStandard(const char* spec, const url_parse::Component& scheme) {
@@ -440,8 +1065,8 @@ bool Canonicalize(const char* spec,
                   url_canon::CharsetConverter* charset_converter,
                   url_canon::CanonOutput* output,
                   url_parse::Parsed* output_parsed) {
-  return DoCanonicalize(spec, spec_len, charset_converter,
-                        output, output_parsed);
+  return DoSampledCanonicalize(spec, spec_len, charset_converter,
+                               output, output_parsed);
 }
 
 bool Canonicalize(const char16* spec,
@@ -449,8 +1074,85 @@ bool Canonicalize(const char16* spec,
                   url_canon::CharsetConverter* charset_converter,
                   url_canon::CanonOutput* output,
                   url_parse::Parsed* output_parsed) {
-  return DoCanonicalize(spec, spec_len, charset_converter,
-                        output, output_parsed);
+  return DoSampledCanonicalize(spec, spec_len, charset_converter,
+                               output, output_parsed);
+}
+
+bool IsCanonical(const char* spec,
+                 int spec_len,
+                 url_parse::Parsed* parsed) {
+  return DoIsCanonical(spec, spec_len, parsed);
+}
+
+bool CanonicalizeIfNeeded(const char* spec,
+                          int spec_len,
+                          url_canon::CharsetConverter* charset_converter,
+                          url_canon::CanonOutput* output,
+                          url_parse::Parsed* output_parsed,
+                          bool* already_canonical) {
+  *already_canonical = DoIsCanonical(spec, spec_len, output_parsed);
+  if (*already_canonical)
+    return true;
+  return DoSampledCanonicalize(spec, spec_len, charset_converter,
+                               output, output_parsed);
+}
+
+CanonResult CanonicalizeWithLimits(const char* spec,
+                                   int spec_len,
+                                   const CanonLimits& limits,
+                                   url_canon::CharsetConverter* converter,
+                                   url_canon::CanonOutput* output,
+                                   url_parse::Parsed* output_parsed) {
+  return DoCanonicalizeWithLimits(spec, spec_len, limits, converter,
+                                  output, output_parsed);
+}
+
+CanonResult CanonicalizeWithLimits(const char16* spec,
+                                   int spec_len,
+                                   const CanonLimits& limits,
+                                   url_canon::CharsetConverter* converter,
+                                   url_canon::CanonOutput* output,
+                                   url_parse::Parsed* output_parsed) {
+  return DoCanonicalizeWithLimits(spec, spec_len, limits, converter,
+                                  output, output_parsed);
+}
+
+bool CanonicalizeWithQueryFilter(const char* spec,
+                                 int spec_len,
+                                 const url_canon::QueryFilter& filter,
+                                 url_canon::CharsetConverter* converter,
+                                 url_canon::CanonOutput* output,
+                                 url_parse::Parsed* output_parsed) {
+  return DoCanonicalizeWithQueryFilter(spec, spec_len, filter, converter,
+                                       output, output_parsed);
+}
+
+bool CanonicalizeWithQueryFilter(const char16* spec,
+                                 int spec_len,
+                                 const url_canon::QueryFilter& filter,
+                                 url_canon::CharsetConverter* converter,
+                                 url_canon::CanonOutput* output,
+                                 url_parse::Parsed* output_parsed) {
+  return DoCanonicalizeWithQueryFilter(spec, spec_len, filter, converter,
+                                       output, output_parsed);
+}
+
+int CanonicalizeBatch(const BatchInput* inputs,
+                      int input_count,
+                      url_canon::CharsetConverter* charset_converter,
+                      url_canon::CanonOutput* output,
+                      BatchResult* results) {
+  return DoCanonicalizeBatch(inputs, input_count, charset_converter,
+                             output, results);
+}
+
+int CanonicalizeBatch(const BatchInput16* inputs,
+                      int input_count,
+                      url_canon::CharsetConverter* charset_converter,
+                      url_canon::CanonOutput* output,
+                      BatchResult* results) {
+  return DoCanonicalizeBatch(inputs, input_count, charset_converter,
+                             output, results);
 }
 
 bool ResolveRelative(const char* base_spec,
@@ -461,8 +1163,10 @@ bool ResolveRelative(const char* base_spec,
                      url_canon::CharsetConverter* charset_converter,
                      url_canon::CanonOutput* output,
                      url_parse::Parsed* output_parsed) {
-  return DoResolveRelative(base_spec, base_spec_len, base_parsed,
-                           relative, relative_length,
+  url_canon::RelativeBase base;
+  DoInitRelativeBase(base_spec, base_parsed,
+                     DoFindSchemeID(base_spec, base_parsed.scheme), &base);
+  return DoResolveRelative(base, relative, relative_length,
                            charset_converter, output, output_parsed);
 }
 
@@ -474,8 +1178,44 @@ bool ResolveRelative(const char* base_spec,
                      url_canon::CharsetConverter* charset_converter,
                      url_canon::CanonOutput* output,
                      url_parse::Parsed* output_parsed) {
-  return DoResolveRelative(base_spec, base_spec_len, base_parsed,
-                           relative, relative_length,
+  url_canon::RelativeBase base;
+  DoInitRelativeBase(base_spec, base_parsed,
+                     DoFindSchemeID(base_spec, base_parsed.scheme), &base);
+  return DoResolveRelative(base, relative, relative_length,
+                           charset_converter, output, output_parsed);
+}
+
+ResolvedBase::ResolvedBase() {
+  Init("", 0, url_parse::Parsed());
+}
+
+ResolvedBase::ResolvedBase(const char* base_spec, int base_spec_len,
+                           const url_parse::Parsed& base_parsed) {
+  Init(base_spec, base_spec_len, base_parsed);
+}
+
+void ResolvedBase::Init(const char* base_spec, int base_spec_len,
+                        const url_parse::Parsed& base_parsed) {
+  base_spec_len_ = base_spec_len;
+  scheme_id_ = DoFindSchemeID(base_spec, base_parsed.scheme);
+  DoInitRelativeBase(base_spec, base_parsed, scheme_id_, &base_);
+}
+
+bool ResolvedBase::Resolve(const char* relative,
+                           int relative_length,
+                           url_canon::CharsetConverter* charset_converter,
+                           url_canon::CanonOutput* output,
+                           url_parse::Parsed* output_parsed) const {
+  return DoResolveRelative(base_, relative, relative_length,
+                           charset_converter, output, output_parsed);
+}
+
+bool ResolvedBase::Resolve(const char16* relative,
+                           int relative_length,
+                           url_canon::CharsetConverter* charset_converter,
+                           url_canon::CanonOutput* output,
+                           url_parse::Parsed* output_parsed) const {
+  return DoResolveRelative(base_, relative, relative_length,
                            charset_converter, output, output_parsed);
 }
 
@@ -526,23 +1266,95 @@ bool LowerCaseEqualsASCII(const char16* a_begin,
   return DoLowerCaseEqualsASCII(a_begin, a_end, b);
 }
 
-void DecodeURLEscapeSequences(const char* input, int length,
-                              url_canon::CanonOutputW* output) {
-  url_canon::RawCanonOutputT<char> unescaped_chars;
-  for (int i = 0; i < length; i++) {
-    if (input[i] == '%') {
-      unsigned char ch;
-      if (url_canon::DecodeEscaped(input, &i, length, &ch)) {
-        unescaped_chars.push_back(ch);
-      } else {
-        // Invalid escape sequence, copy the percent literal.
-        unescaped_chars.push_back('%');
-      }
+bool DomainIs(const char* host,
+              int host_len,
+              const char* lower_ascii_domain,
+              int domain_len) {
+  if (host_len <= 0 || domain_len <= 0)
+    return false;
+
+  // Check whether the host name is end with a dot. If yes, treat it
+  // the same as no-dot unless the input comparison domain is end
+  // with dot.
+  const char* last_pos = host + host_len - 1;
+  if ('.' == *last_pos && '.' != lower_ascii_domain[domain_len - 1]) {
+    last_pos--;
+    host_len--;
+  }
+
+  // Return false if host's length is less than domain's length.
+  if (host_len < domain_len)
+    return false;
+
+  // Compare this url whether belong specific domain.
+  const char* start_pos = host + host_len - domain_len;
+
+  if (!LowerCaseEqualsASCII(start_pos,
+                            last_pos + 1,
+                            lower_ascii_domain,
+                            lower_ascii_domain + domain_len))
+    return false;
+
+  // Check whether host has right domain start with dot, make sure we got
+  // right domain range. For example www.google.com has domain
+  // "google.com" but www.iamnotgoogle.com does not.
+  if ('.' != lower_ascii_domain[0] && host_len > domain_len &&
+      '.' != *(start_pos - 1))
+    return false;
+
+  return true;
+}
+
+uint64_t HashSpec(const char* spec, int spec_len) {
+  SpecHasher hasher(spec_len);
+  hasher.Update(spec, spec_len);
+  return hasher.Finish();
+}
+
+bool FingerprintURL(const char* spec,
+                    int spec_len,
+                    const FingerprintOptions& options,
+                    url_canon::CharsetConverter* charset_converter,
+                    uint64_t* fingerprint) {
+  return DoFingerprintURL(spec, spec_len, options, charset_converter,
+                          fingerprint);
+}
+
+bool FingerprintURL(const char16* spec,
+                    int spec_len,
+                    const FingerprintOptions& options,
+                    url_canon::CharsetConverter* charset_converter,
+                    uint64_t* fingerprint) {
+  return DoFingerprintURL(spec, spec_len, options, charset_converter,
+                          fingerprint);
+}
+
+void DecodeURLEscapeSequencesToUTF8(const char* input, int length,
+                                     url_canon::CanonOutput* output) {
+  int i = 0;
+  while (i < length) {
+    // Everything up to the next percent is copied unchanged.
+    int percent = i + url_canon::FindPercent(&input[i], length - i);
+    output->Append(&input[i], percent - i);
+    if (percent == length)
+      break;
+
+    i = percent;
+    unsigned char ch;
+    if (url_canon::DecodeEscaped(input, &i, length, &ch)) {
+      output->push_back(ch);
     } else {
-      // Regular non-escaped 8-bit character.
-      unescaped_chars.push_back(input[i]);
+      // Invalid escape sequence, copy the percent literal.
+      output->push_back('%');
     }
+    i++;
   }
+}
+
+void DecodeURLEscapeSequences(const char* input, int length,
+                              url_canon::CanonOutputW* output) {
+  url_canon::RawCanonOutputT<char> unescaped_chars;
+  DecodeURLEscapeSequencesToUTF8(input, length, &unescaped_chars);
 
   // Convert that 8-bit to UTF-16. It's not clear IE does this at all to
   // JavaScript URLs, but Firefox and Safari do.
@@ -577,12 +1389,15 @@ void DecodeURLEscapeSequences(const char* input, int length,
 
 void EncodeURIComponent(const char* input, int length,
                         url_canon::CanonOutput* output) {
-  for (int i = 0; i < length; ++i) {
-    unsigned char c = static_cast<unsigned char>(input[i]);
-    if (url_canon::IsComponentChar(c))
-      output->push_back(c);
-    else
-      AppendEscapedChar(c, output);
+  int i = 0;
+  while (i < length) {
+    // Runs of component characters are copied unchanged.
+    int special = i + url_canon::FindNonComponentChar(&input[i], length - i);
+    output->Append(&input[i], special - i);
+    if (special == length)
+      break;
+    AppendEscapedChar(static_cast<unsigned char>(input[special]), output);
+    i = special + 1;
   }
 }
 
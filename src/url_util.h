@@ -30,6 +30,7 @@
 #ifndef GOOGLEURL_SRC_URL_UTIL_H__
 #define GOOGLEURL_SRC_URL_UTIL_H__
 
+#include <stdint.h>
 #include <string>
 
 #include "googleurl/base/string16.h"
@@ -42,11 +43,8 @@ namespace url_util {
 // Init ------------------------------------------------------------------------
 
 // Initialization is NOT required, it will be implicitly initialized when first
-// used. However, this implicit initialization is NOT threadsafe. If you are
-// using this library in a threaded environment and don't have a consistent
-// "first call" (an example might be calling "AddStandardScheme" with your
-// special application-specific schemes) then you will want to call initialize
-// before spawning any threads.
+// used. The implicit initialization is threadsafe, so calling this is only a
+// way of doing the (small) setup work at a time of your choosing.
 //
 // It is OK to call this function more than once, subsequent calls will simply
 // "noop", unless Shutdown() was called in the mean time. This will also be a
@@ -57,29 +55,29 @@ GURL_API void Initialize();
 // Cleanup is not required, except some strings may leak. For most user
 // applications, this is fine. If you're using it in a library that may get
 // loaded and unloaded, you'll want to unload to properly clean up your
-// library.
+// library. This is NOT threadsafe: no other url_util function may be running
+// or be called concurrently.
 GURL_API void Shutdown();
 
 // Schemes --------------------------------------------------------------------
 
 // Adds an application-defined scheme to the internal list of "standard" URL
-// schemes. This function is not threadsafe and can not be called concurrently
-// with any other url_util function. It will assert if the list of standard
-// schemes has been locked (see LockStandardSchemes).
+// schemes. This function is threadsafe and may be called concurrently with
+// any other url_util function except Shutdown. Readers never lock: each
+// addition publishes an updated copy of the scheme list, so it is relatively
+// expensive and meant for configuration time rather than per-URL use. It will
+// assert if the list of standard schemes has been locked (see
+// LockStandardSchemes).
 GURL_API void AddStandardScheme(const char* new_scheme);
 
 // Sets a flag to prevent future calls to AddStandardScheme from succeeding.
 //
-// This is designed to help prevent errors for multithreaded applications.
-// Normal usage would be to call AddStandardScheme for your custom schemes at
-// the beginning of program initialization, and then LockStandardSchemes. This
-// prevents future callers from mistakenly calling AddStandardScheme when the
-// program is running with multiple threads, where such usage would be
-// dangerous.
-//
-// We could have had AddStandardScheme use a lock instead, but that would add
-// some platform-specific dependencies we don't otherwise have now, and is
-// overkill considering the normal usage is so simple.
+// This is designed to help catch schemes being registered later than an
+// application intends. Normal usage would be to call AddStandardScheme for
+// your custom schemes during program initialization, and then
+// LockStandardSchemes. A GURL created before its scheme was registered will
+// not see the registration, so late registration can give inconsistent
+// results even though it is safe.
 GURL_API void LockStandardSchemes();
 
 // Locates the scheme in the given string and places it into |found_scheme|,
@@ -116,6 +114,38 @@ GURL_API bool IsStandard(const char* spec,
 GURL_API bool IsStandard(const char16* spec,
                          const url_parse::Component& scheme);
 
+// Interned identifiers for registered schemes. The built-in schemes have the
+// fixed values below; schemes added with AddStandardScheme get the following
+// values in the order they are added. Comparing IDs is much cheaper than
+// comparing scheme strings, so callers that dispatch on the scheme repeatedly
+// should look it up once with FindSchemeID.
+enum SchemeID {
+  SCHEME_UNKNOWN = 0,  // Not a registered scheme.
+  SCHEME_HTTP,
+  SCHEME_HTTPS,
+  SCHEME_FILE,
+  SCHEME_FTP,
+  SCHEME_GOPHER,
+  SCHEME_WS,
+  SCHEME_WSS,
+  SCHEME_FILESYSTEM,
+  SCHEME_MAILTO,
+  SCHEME_FIRST_CUSTOM,  // The first ID given to an added scheme.
+  SCHEME_MAX = 0xffff,
+};
+
+// Returns the ID of the scheme identified by |scheme| within |spec|, or
+// SCHEME_UNKNOWN if it is not registered. The comparison is ASCII case
+// insensitive and takes one hash table lookup regardless of how many schemes
+// have been registered.
+GURL_API SchemeID FindSchemeID(const char* spec,
+                               const url_parse::Component& scheme);
+GURL_API SchemeID FindSchemeID(const char16* spec,
+                               const url_parse::Component& scheme);
+
+// Returns true if the given scheme ID is one of the "standard" schemes.
+GURL_API bool IsStandardSchemeID(SchemeID id);
+
 // TODO(brettw) remove this. This is a temporary compatibility hack to avoid
 // breaking the WebKit build when this version is synced via Chrome.
 inline bool IsStandard(const char* spec, int spec_len,
@@ -146,6 +176,94 @@ GURL_API bool Canonicalize(const char16* spec,
                            url_canon::CanonOutput* output,
                            url_parse::Parsed* output_parsed);
 
+// Returns true if Canonicalize would succeed and produce exactly |spec|, in
+// which case |*parsed| is filled in for |spec| itself and nothing is copied.
+// This is meant for URLs that are usually stored in canonical form already;
+// see url_canon::IsCanonicalStandardURL for the (conservative) rules. Only
+// standard, file and path URLs are recognized, others always return false.
+GURL_API bool IsCanonical(const char* spec,
+                          int spec_len,
+                          url_parse::Parsed* parsed);
+
+// Like Canonicalize, but when |spec| is already canonical (see IsCanonical)
+// nothing is written to |output|, |*output_parsed| refers to |spec| and
+// |*already_canonical| is set to true. Otherwise the URL is canonicalized into
+// |output| as usual and |*already_canonical| is set to false.
+GURL_API bool CanonicalizeIfNeeded(
+    const char* spec,
+    int spec_len,
+    url_canon::CharsetConverter* charset_converter,
+    url_canon::CanonOutput* output,
+    url_parse::Parsed* output_parsed,
+    bool* already_canonical);
+
+// Bounds on the work CanonicalizeWithLimits may do for one URL, for callers
+// handling untrusted input that may be megabytes long. A limit of 0 means
+// no limit.
+struct CanonLimits {
+  CanonLimits() : max_input_len(0), max_output_len(0), max_component_len(0) {
+  }
+
+  // The longest spec accepted. This is checked before anything else is done.
+  int max_input_len;
+
+  // The most characters the call may append to the output. The output buffer
+  // is not grown past this, so canonicalization stops writing once it is hit.
+  int max_output_len;
+
+  // The longest parsed component (host, path, query, etc.) that will be
+  // canonicalized. The components of the inner URL of a filesystem: URL are
+  // checked as well. This is checked after parsing, before any output is
+  // written.
+  int max_component_len;
+};
+
+// The outcome of CanonicalizeWithLimits.
+enum CanonResult {
+  CANON_VALID,      // Same as Canonicalize returning true.
+  CANON_INVALID,    // Same as Canonicalize returning false.
+  CANON_TOO_LARGE,  // A limit was hit; see CanonicalizeWithLimits.
+};
+
+// Like Canonicalize, but gives up with CANON_TOO_LARGE as soon as one of the
+// given |limits| is exceeded. In that case |output| is restored to the length
+// it had on entry and |*output_parsed| is cleared, since a partial result is
+// not a usable URL. Otherwise the output is the same as Canonicalize's.
+GURL_API CanonResult CanonicalizeWithLimits(
+    const char* spec,
+    int spec_len,
+    const CanonLimits& limits,
+    url_canon::CharsetConverter* charset_converter,
+    url_canon::CanonOutput* output,
+    url_parse::Parsed* output_parsed);
+GURL_API CanonResult CanonicalizeWithLimits(
+    const char16* spec,
+    int spec_len,
+    const CanonLimits& limits,
+    url_canon::CharsetConverter* charset_converter,
+    url_canon::CanonOutput* output,
+    url_parse::Parsed* output_parsed);
+
+// Like Canonicalize, but also removes the query parameters |filter| rejects,
+// adjusting the query and ref of |*output_parsed| to match. The filter is
+// applied to the canonical query in place, so this costs one more scan of
+// the query rather than re-parsing and rebuilding the URL. Whether the URL is
+// valid does not depend on the filter.
+GURL_API bool CanonicalizeWithQueryFilter(
+    const char* spec,
+    int spec_len,
+    const url_canon::QueryFilter& filter,
+    url_canon::CharsetConverter* charset_converter,
+    url_canon::CanonOutput* output,
+    url_parse::Parsed* output_parsed);
+GURL_API bool CanonicalizeWithQueryFilter(
+    const char16* spec,
+    int spec_len,
+    const url_canon::QueryFilter& filter,
+    url_canon::CharsetConverter* charset_converter,
+    url_canon::CanonOutput* output,
+    url_parse::Parsed* output_parsed);
+
 // Resolves a potentially relative URL relative to the given parsed base URL.
 // The base MUST be valid. The resulting canonical URL and parsed information
 // will be placed in to the given out variables.
@@ -173,6 +291,57 @@ GURL_API bool ResolveRelative(const char* base_spec,
                               url_canon::CanonOutput* output,
                               url_parse::Parsed* output_parsed);
 
+// A base URL prepared for resolving many relative URLs against it, such as
+// all the links in one document. Init does once what ResolveRelative would
+// otherwise redo for every relative URL: classifying the base scheme and
+// finding where the directory part of its path ends. Resolving then only
+// costs the work for the relative URL itself.
+//
+// Resolve gives the same results as ResolveRelative with the same base. The
+// base spec is not copied and must stay alive and unchanged while this object
+// is used. Like for ResolveRelative, the base MUST be valid.
+class ResolvedBase {
+ public:
+  // Creates an object with an empty base. Call Init before resolving.
+  GURL_API ResolvedBase();
+
+  // Creates an object for the given base, see Init.
+  GURL_API ResolvedBase(const char* base_spec, int base_spec_len,
+                        const url_parse::Parsed& base_parsed);
+
+  // Prepares for resolving against the given canonical base URL.
+  GURL_API void Init(const char* base_spec, int base_spec_len,
+                     const url_parse::Parsed& base_parsed);
+
+  // The length of the base spec given to Init.
+  int base_spec_len() const {
+    return base_spec_len_;
+  }
+
+  // The registered scheme of the base, SCHEME_UNKNOWN if there is none.
+  SchemeID scheme_id() const {
+    return scheme_id_;
+  }
+
+  // Resolves |relative| against the base. The arguments and return value are
+  // the same as for ResolveRelative.
+  GURL_API bool Resolve(const char* relative,
+                        int relative_length,
+                        url_canon::CharsetConverter* charset_converter,
+                        url_canon::CanonOutput* output,
+                        url_parse::Parsed* output_parsed) const;
+  GURL_API bool Resolve(const char16* relative,
+                        int relative_length,
+                        url_canon::CharsetConverter* charset_converter,
+                        url_canon::CanonOutput* output,
+                        url_parse::Parsed* output_parsed) const;
+
+ private:
+  url_canon::RelativeBase base_;
+  int base_spec_len_;
+  SchemeID scheme_id_;
+};
+
 // Replaces components in the given VALID input url. The new canonical URL info
 // is written to output and out_parsed.
 //
@@ -194,6 +363,48 @@ GURL_API bool ReplaceComponents(
     url_canon::CanonOutput* output,
     url_parse::Parsed* out_parsed);
 
+// Batch canonicalization ----------------------------------------------------
+
+// One input to CanonicalizeBatch: the spec to canonicalize and its length.
+// The spec is not copied and need not be NULL terminated.
+template<typename CHAR>
+struct BatchInputT {
+  const CHAR* spec;
+  int spec_len;
+};
+typedef BatchInputT<char> BatchInput;
+typedef BatchInputT<char16> BatchInput16;
+
+// The result of canonicalizing one input of a batch. |spec| is the range of
+// the canonical URL within the shared output, and |parsed| identifies its
+// components. Note that, as with all canonicalizer output, the components
+// in |parsed| are offsets from the beginning of the output buffer, not from
+// the beginning of |spec|.
+struct BatchResult {
+  url_parse::Component spec;
+  url_parse::Parsed parsed;
+  bool is_valid;
+};
+
+// Canonicalizes |input_count| URLs, appending the canonical form of each, one
+// after the other, to the single |output| and filling in the corresponding
+// element of |results|, which must have room for |input_count| entries. This
+// produces the same URLs as calling Canonicalize() on each input, but avoids
+// the per-call setup of the scratch buffers. See Canonicalize() for more
+// about the charset_converter.
+//
+// Returns the number of inputs that produced a valid URL.
+GURL_API int CanonicalizeBatch(const BatchInput* inputs,
+                               int input_count,
+                               url_canon::CharsetConverter* charset_converter,
+                               url_canon::CanonOutput* output,
+                               BatchResult* results);
+GURL_API int CanonicalizeBatch(const BatchInput16* inputs,
+                               int input_count,
+                               url_canon::CharsetConverter* charset_converter,
+                               url_canon::CanonOutput* output,
+                               BatchResult* results);
+
 // String helper functions ----------------------------------------------------
 
 // Compare the lower-case form of the given string against the given ASCII
@@ -213,10 +424,112 @@ GURL_API bool LowerCaseEqualsASCII(const char16* a_begin,
                                    const char16* a_end,
                                    const char* b);
 
+// Returns true if the canonicalized |host| (which need not be NULL terminated)
+// matches or is in the same domain as the given lower-case ASCII domain. For
+// example "www.google.com" matches "com", "google.com" and "www.google.com".
+// A trailing dot on the host is ignored unless the domain also ends with one.
+// This is the backend for GURL::DomainIs.
+GURL_API bool DomainIs(const char* host,
+                       int host_len,
+                       const char* lower_ascii_domain,
+                       int domain_len);
+
+// Returns a 64-bit hash of the given canonical spec or part of a spec. The
+// hash only depends on the bytes, so it is the same in every process and on
+// every platform and can be stored. This is the hash GURL caches.
+GURL_API uint64_t HashSpec(const char* spec, int spec_len);
+
+// Normalizations FingerprintURL can apply on top of canonicalization, so
+// that URLs a caller considers the same get the same fingerprint. There is no
+// option for default ports since canonicalization already removes them.
+struct FingerprintOptions {
+  FingerprintOptions() : sort_query(false), strip_ref(false) {
+  }
+
+  // Orders the '&'-separated pieces of the query by key. Pieces with the same
+  // key keep their relative order.
+  bool sort_query;
+
+  // Leaves out the ref and its '#'.
+  bool strip_ref;
+};
+
+// Computes a 64-bit fingerprint of the canonical form of the given URL, for
+// deduplication and sketches that never need the URL itself. With the
+// default options this is the HashSpec of what Canonicalize produces, which
+// is also GURL::hash(); otherwise it is the HashSpec of the canonical spec
+// with the normalizations in |options| applied. The canonical form is built
+// in a stack buffer and is not returned, so nothing is allocated for URLs of
+// ordinary size. See Canonicalize() for the charset_converter.
+//
+// Returns what Canonicalize would: whether the URL is valid. The fingerprint
+// is filled in either way.
+GURL_API bool FingerprintURL(const char* spec,
+                             int spec_len,
+                             const FingerprintOptions& options,
+                             url_canon::CharsetConverter* charset_converter,
+                             uint64_t* fingerprint);
+GURL_API bool FingerprintURL(const char16* spec,
+                             int spec_len,
+                             const FingerprintOptions& options,
+                             url_canon::CharsetConverter* charset_converter,
+                             uint64_t* fingerprint);
+
+// A fixed-size stand-in for an origin (scheme, host and port), for comparing
+// and hashing origins without building or comparing their strings. The port
+// is the effective one, so an explicit default port matches an omitted one.
+// The host is kept only as its HashSpec, so two different hosts have the same
+// key only if their 64-bit hashes collide. The default key represents the
+// empty origin of invalid and non-standard URLs. See GURL::origin_key.
+struct OriginKey {
+  OriginKey()
+      : scheme_id(SCHEME_UNKNOWN),
+        port(url_parse::PORT_UNSPECIFIED),
+        host_hash(0) {
+  }
+  OriginKey(SchemeID scheme_id, uint64_t host_hash, int port)
+      : scheme_id(scheme_id),
+        port(port),
+        host_hash(host_hash) {
+  }
+
+  bool operator==(const OriginKey& other) const {
+    return host_hash == other.host_hash && scheme_id == other.scheme_id &&
+        port == other.port;
+  }
+  bool operator!=(const OriginKey& other) const {
+    return !(*this == other);
+  }
+  bool operator<(const OriginKey& other) const {
+    if (host_hash != other.host_hash)
+      return host_hash < other.host_hash;
+    if (scheme_id != other.scheme_id)
+      return scheme_id < other.scheme_id;
+    return port < other.port;
+  }
+
+  // Folds the scheme and port into the host hash.
+  uint64_t hash() const {
+    uint64_t scheme_and_port = (static_cast<uint64_t>(scheme_id) << 32) |
+        static_cast<uint32_t>(port);
+    return host_hash ^ (scheme_and_port * 0x9e3779b97f4a7c15ULL);
+  }
+
+  SchemeID scheme_id;
+  int port;
+  uint64_t host_hash;
+};
+
 // Unescapes the given string using URL escaping rules.
 GURL_API void DecodeURLEscapeSequences(const char* input, int length,
                                        url_canon::CanonOutputW* output);
 
+// Same as DecodeURLEscapeSequences, but writes the unescaped bytes directly
+// instead of converting them to UTF-16. The output is UTF-8 when the escaped
+// input is, and invalid sequences are passed through unchanged.
+GURL_API void DecodeURLEscapeSequencesToUTF8(const char* input, int length,
+                                             url_canon::CanonOutput* output);
+
 // Escapes the given string as defined by the JS method encodeURIComponent.  See
 // https://developer.mozilla.org/en/JavaScript/Reference/Global_Objects/encodeURIComponent
 GURL_API void EncodeURIComponent(const char* input, int length,
@@ -30,7 +30,11 @@
 #ifndef GOOGLEURL_SRC_URL_UTIL_INTERNAL_H__
 #define GOOGLEURL_SRC_URL_UTIL_INTERNAL_H__
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <string>
+#include <vector>
 
 #include "googleurl/base/string16.h"
 #include "googleurl/src/url_common.h"
@@ -51,6 +55,123 @@ bool CompareSchemeComponent(const char16* spec,
                             const url_parse::Component& component,
                             const char* compare_to);
 
+// FNV-1a hashing, which the hash tables below are keyed with. The hashes are
+// built one character at a time so that callers can hash in whichever order
+// suits them, for example from the end of a host so that the hashes of all
+// of its suffixes come out of a single scan.
+const uint64_t kFNVBasis = 0xcbf29ce484222325ULL;
+const uint64_t kFNVPrime = 0x100000001b3ULL;
+const uint32_t kFNVBasis32 = 0x811c9dc5;
+const uint32_t kFNVPrime32 = 0x01000193;
+
+inline uint64_t FNVHashStep(uint64_t hash, char ch) {
+  return (hash ^ static_cast<unsigned char>(ch)) * kFNVPrime;
+}
+inline uint32_t FNVHashStep32(uint32_t hash, char ch) {
+  return (hash ^ static_cast<unsigned char>(ch)) * kFNVPrime32;
+}
+
+// Hashes |len| characters forwards, starting from |hash|.
+inline uint64_t FNVHash(uint64_t hash, const char* str, int len) {
+  for (int i = 0; i < len; i++)
+    hash = FNVHashStep(hash, str[i]);
+  return hash;
+}
+
+// A vector of entries with an open-addressed hash table over them. Entry is a
+// struct with a |hash| member; entries are never removed, so their indices
+// stay valid. The table holds indices into the vector plus one, zero for an
+// empty bucket, and its size is a power of two, at most half full.
+//
+// What makes two entries equal is up to the caller, who walks the entries
+// with a given hash with a Probe:
+//
+//   for (HashTable<Entry>::Probe probe(table, hash); !probe.done();
+//        probe.Next()) {
+//     if (Matches(probe.entry()))
+//       return probe.index();
+//   }
+template<typename Entry>
+class HashTable {
+ public:
+  class Probe {
+   public:
+    Probe(const HashTable& table, uint64_t hash)
+        : table_(table),
+          hash_(hash),
+          mask_(table.buckets_.size() - 1),
+          bucket_(static_cast<size_t>(hash) & mask_) {
+      Skip();
+    }
+
+    bool done() const {
+      return table_.buckets_.empty() || !table_.buckets_[bucket_];
+    }
+    int index() const { return table_.buckets_[bucket_] - 1; }
+    const Entry& entry() const { return table_.entries_[index()]; }
+
+    void Next() {
+      bucket_ = (bucket_ + 1) & mask_;
+      Skip();
+    }
+
+   private:
+    // Moves on to the next bucket holding an entry with the hash.
+    void Skip() {
+      while (!done() && entry().hash != hash_)
+        bucket_ = (bucket_ + 1) & mask_;
+    }
+
+    const HashTable& table_;
+    uint64_t hash_;
+    size_t mask_;
+    size_t bucket_;
+  };
+
+  bool empty() const { return entries_.empty(); }
+  size_t size() const { return entries_.size(); }
+
+  const Entry& entry(int index) const { return entries_[index]; }
+  Entry& entry(int index) { return entries_[index]; }
+
+  // Sizes the table for |count| entries so that adding them doesn't rehash.
+  void Reserve(size_t count) {
+    size_t bucket_count = buckets_.empty() ? 16 : buckets_.size();
+    while (bucket_count < count * 2)
+      bucket_count *= 2;
+    if (bucket_count != buckets_.size())
+      Rehash(bucket_count);
+  }
+
+  // Adds |entry| and returns its index. Callers check that it isn't already
+  // there first.
+  int Add(const Entry& entry) {
+    if ((entries_.size() + 1) * 2 > buckets_.size())
+      Rehash(buckets_.empty() ? 16 : buckets_.size() * 2);
+    entries_.push_back(entry);
+    Insert(entry.hash, static_cast<int>(entries_.size()));
+    return static_cast<int>(entries_.size()) - 1;
+  }
+
+ private:
+  void Insert(uint64_t hash, int bucket_value) {
+    size_t mask = buckets_.size() - 1;
+    size_t bucket = static_cast<size_t>(hash) & mask;
+    while (buckets_[bucket])
+      bucket = (bucket + 1) & mask;
+    buckets_[bucket] = bucket_value;
+  }
+
+  void Rehash(size_t bucket_count) {
+    buckets_.assign(bucket_count, 0);
+    for (size_t i = 0; i < entries_.size(); i++)
+      Insert(entries_[i].hash, static_cast<int>(i) + 1);
+  }
+
+  std::vector<Entry> entries_;
+  std::vector<int> buckets_;
+};
+
 }  // namespace url_util
 
 #endif  // GOOGLEURL_SRC_URL_UTIL_INTERNAL_H__